@@ -134,16 +134,32 @@ uLong ZEXPORT adler32_combine(adler1, adler2, len2)
     unsigned long sum2;
     unsigned rem;
 
+    /* fast paths: nothing appended, or no division needed */
+    if (len2 == 0)
+        return adler1;
+    rem = len2 < (z_off_t)BASE ? (unsigned)len2 : (unsigned)(len2 % BASE);
+
     /* the derivation of this formula is left as an exercise for the reader */
-    rem = (unsigned)(len2 % BASE);
     sum1 = adler1 & 0xffff;
     sum2 = rem * sum1;
     MOD(sum2);
     sum1 += (adler2 & 0xffff) + BASE - 1;
     sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + BASE - rem;
-    if (sum1 > BASE) sum1 -= BASE;
-    if (sum1 > BASE) sum1 -= BASE;
-    if (sum2 > (BASE << 1)) sum2 -= (BASE << 1);
-    if (sum2 > BASE) sum2 -= BASE;
+    if (sum1 >= BASE) sum1 -= BASE;
+    if (sum1 >= BASE) sum1 -= BASE;
+    if (sum2 >= (BASE << 1)) sum2 -= (BASE << 1);
+    if (sum2 >= BASE) sum2 -= BASE;
     return sum1 | (sum2 << 16);
 }
+
+/* ========================================================================= */
+uLong ZEXPORT adler32_combine_multi(adler, adlers, lens, n)
+    uLong adler;
+    const uLongf *adlers;
+    const z_off_t FAR *lens;
+    unsigned n;
+{
+    for (; n; n--, adlers++, lens++)
+        adler = adler32_combine(adler, *adlers, *lens);
+    return adler;
+}
@@ -6,7 +6,7 @@
 /* @(#) $Id$ */
 
 #define ZLIB_INTERNAL
-#include "zlib.h"
+#include "deflate.h"
 
 /* ===========================================================================
      Compresses the source buffer into the destination buffer. The level
@@ -77,3 +77,145 @@ uLong ZEXPORT compressBound (sourceLen)
 {
     return sourceLen + (sourceLen >> 12) + (sourceLen >> 14) + 11;
 }
+
+/* ===========================================================================
+     Memory for compressArena() is carved from the caller's arena, aligned
+   for any use. Nothing is freed; the whole arena is free again on return.
+ */
+#define ARENA_ALIGN 16
+#define ARENA_ROUND(n) (((n) + (ARENA_ALIGN - 1)) & ~(ulg)(ARENA_ALIGN - 1))
+
+typedef struct {
+    Bytef *next;        /* next free byte */
+    ulg left;           /* bytes left after next */
+} arena_state;
+
+local voidpf arena_alloc OF((voidpf opaque, uInt items, uInt size));
+local void arena_free OF((voidpf opaque, voidpf address));
+local void arena_params OF((uLong sourceLen, int *windowBits,
+                            int *memLevel));
+
+local voidpf arena_alloc(opaque, items, size)
+    voidpf opaque;
+    uInt items;
+    uInt size;
+{
+    arena_state *a = (arena_state *)opaque;
+    ulg len = ARENA_ROUND((ulg)items * size);
+    voidpf p;
+
+    if (len > a->left) return Z_NULL;
+    p = (voidpf)a->next;
+    a->next += len;
+    a->left -= len;
+    return p;
+}
+
+local void arena_free(opaque, address)
+    voidpf opaque;
+    voidpf address;
+{
+    /* the arena is given back as a whole by its owner */
+    if (opaque || address) return; /* make compiler happy */
+}
+
+/* ===========================================================================
+     Size the window and the tables to the input. Up to 16K or so, the window
+   holds the whole input with MIN_LOOKAHEAD to spare and the symbol buffer
+   is larger than the input, so the output is a single block and fits in
+   compressBound(). Longer inputs get the deflateInit() defaults.
+ */
+local void arena_params(sourceLen, windowBits, memLevel)
+    uLong sourceLen;
+    int *windowBits;
+    int *memLevel;
+{
+    *windowBits = 9;
+    while (*windowBits < MAX_WBITS &&
+           (1UL << *windowBits) <= sourceLen + MIN_LOOKAHEAD)
+        (*windowBits)++;
+    *memLevel = 1;
+    while (*memLevel < DEF_MEM_LEVEL &&
+           (1UL << (*memLevel + 6)) <= sourceLen + 1)
+        (*memLevel)++;
+}
+
+/* ===========================================================================
+ */
+uLong ZEXPORT compressArenaSize (sourceLen)
+    uLong sourceLen;
+{
+    int windowBits, memLevel;
+
+    arena_params(sourceLen, &windowBits, &memLevel);
+    return (ARENA_ALIGN - 1) +
+           ARENA_ROUND(sizeof(deflate_state)) +
+           ARENA_ROUND((ulg)2 << windowBits) +                 /* window */
+           ARENA_ROUND((ulg)sizeof(Pos) << windowBits) +       /* prev */
+           ARENA_ROUND((ulg)sizeof(Pos) << (memLevel + 7)) +   /* head */
+           ARENA_ROUND((ulg)(sizeof(ush)+2) << (memLevel + 6));   /* pending */
+}
+
+/* ===========================================================================
+     Like compress2(), with the memory taken from arena, and with the window
+   and tables sized to the input. When dest has room for compressBound()
+   bytes, the whole compressed data is written straight into it.
+ */
+int ZEXPORT compressArena (dest, destLen, source, sourceLen, level, arena,
+                           arenaLen)
+    Bytef *dest;
+    uLongf *destLen;
+    const Bytef *source;
+    uLong sourceLen;
+    int level;
+    voidpf arena;
+    uLong arenaLen;
+{
+    z_stream stream;
+    arena_state a;
+    ulg skip;
+    int windowBits, memLevel;
+    int err;
+
+    stream.next_in = (Bytef*)source;
+    stream.avail_in = (uInt)sourceLen;
+    if ((uLong)stream.avail_in != sourceLen) return Z_BUF_ERROR;
+    stream.next_out = dest;
+    stream.avail_out = (uInt)*destLen;
+    if ((uLong)stream.avail_out != *destLen) return Z_BUF_ERROR;
+
+    if (arena != Z_NULL) {
+        a.next = (Bytef *)arena;
+        skip = (ulg)(-(ptrdiff_t)a.next) & (ARENA_ALIGN - 1);
+        if (skip > arenaLen) return Z_MEM_ERROR;
+        a.next += skip;
+        a.left = arenaLen - skip;
+        stream.zalloc = arena_alloc;
+        stream.zfree = arena_free;
+        stream.opaque = (voidpf)&a;
+    }
+    else {
+        stream.zalloc = (alloc_func)0;
+        stream.zfree = (free_func)0;
+        stream.opaque = (voidpf)0;
+    }
+
+    arena_params(sourceLen, &windowBits, &memLevel);
+    err = deflateInit2(&stream, level, Z_DEFLATED, windowBits, memLevel,
+                       Z_DEFAULT_STRATEGY);
+    if (err != Z_OK) return err;
+
+    /* a single block needs at most five bytes more than the input */
+    if (sourceLen + 1 < ((deflate_state *)stream.state)->lit_bufsize)
+        ((deflate_state *)stream.state)->direct_room = sourceLen + 5;
+
+    err = deflate(&stream, Z_FINISH);
+    if (err != Z_STREAM_END) {
+        deflateEnd(&stream);
+        return err == Z_OK ? Z_BUF_ERROR : err;
+    }
+    *destLen = stream.total_out;
+
+    err = deflateEnd(&stream);
+    return err;
+}
@@ -0,0 +1,185 @@
+#ifndef UZCORO__H
+#define UZCORO__H
+
+/*
+ * uzcoro.h - C++20 coroutine interface to uzinflate
+ *
+ * uzinflate_chunks() turns the inflate() loop of uztest.c inside out: it is
+ * a coroutine that co_awaits its compressed input from a source and hands
+ * back decompressed chunks to a consumer that co_awaits them, so any number
+ * of streams can be pipelined on one thread without a callback state
+ * machine per protocol:
+ *
+ *     uzchunks out = uzinflate_chunks(z, read_socket);
+ *     while (co_await out.next())
+ *         consume(out.chunk());
+ *     if (out.status() != Z_OK) ...
+ *
+ * next() resumes the decoder from inside the consumer's co_await and the
+ * decoder just suspends back to it with the next chunk, so the two take
+ * turns on the consumer's stack without nesting, however many chunks pass.
+ * Only when source() suspends and later resumes the decoder from elsewhere
+ * does the decoder resume the consumer itself, on that thread, once per
+ * such suspension.
+ */
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <span>
+#include <utility>
+#include <vector>
+#include "uzstream.h"
+
+//  ----------------------------- uzchunks -----------------------------
+
+class uzchunks
+{
+    public:
+        struct promise_type
+        {
+            /* Who passes the next chunk to the consumer: while next() is
+             * running the decoder, the decoder just suspends back into it;
+             * once next() has left the decoder waiting on its source, the
+             * decoder resumes the consumer.
+             */
+            enum { idle, running, ready, detached };
+
+            std::span<const std::byte> value;
+            int status = Z_STREAM_ERROR;
+            std::coroutine_handle<> consumer;
+            std::exception_ptr error;
+            std::atomic<int> handoff{idle};
+
+            /* Hands control back to the consumer waiting in next().
+             */
+            struct transfer
+            {
+                bool await_ready() noexcept { return false; }
+                std::coroutine_handle<>
+                await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                    promise_type& p = h.promise();
+                    int was = running;
+                    if (p.handoff.compare_exchange_strong(was, ready))
+                        return std::noop_coroutine();
+                    return p.consumer;
+                }
+                void await_resume() noexcept {}
+            };
+
+            uzchunks get_return_object() {
+                return uzchunks(
+                    std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            transfer final_suspend() noexcept { return {}; }
+            transfer yield_value(std::span<const std::byte> chunk) noexcept {
+                value = chunk;
+                return {};
+            }
+            void return_value(int r) noexcept { value = {}; status = r; }
+            void unhandled_exception() noexcept {
+                error = std::current_exception();
+                value = {};
+            }
+        };
+
+        /* What co_await next() suspends on.
+         */
+        struct awaiter
+        {
+            std::coroutine_handle<promise_type> gen;
+
+            bool await_ready() noexcept { return !gen || gen.done(); }
+            bool await_suspend(std::coroutine_handle<> consumer) noexcept {
+                promise_type& p = gen.promise();
+                int was = promise_type::running;
+                p.consumer = consumer;
+                p.handoff.store(promise_type::running);
+                gen.resume();
+                /* suspend only if the decoder is still waiting for input */
+                return p.handoff.compare_exchange_strong(was,
+                                                         promise_type::detached);
+            }
+            bool await_resume() {
+                if (!gen) return false;
+                if (gen.promise().error)
+                    std::rethrow_exception(gen.promise().error);
+                return !gen.done();
+            }
+        };
+
+        uzchunks(uzchunks&& other) noexcept
+            : m_gen(std::exchange(other.m_gen, nullptr)) {}
+        uzchunks& operator=(uzchunks&& other) noexcept {
+            if (this != &other) {
+                if (m_gen) m_gen.destroy();
+                m_gen = std::exchange(other.m_gen, nullptr);
+            }
+            return *this;
+        }
+        uzchunks(const uzchunks&) = delete;
+        uzchunks& operator=(const uzchunks&) = delete;
+        ~uzchunks() { if (m_gen) m_gen.destroy(); }
+
+        /* Runs the decoder until it has a chunk, true, or has finished,
+         * false.  Only one consumer may wait at a time.
+         */
+        awaiter next() { return awaiter{m_gen}; }
+
+        /* The last chunk, valid until next() is awaited again.
+         */
+        std::span<const std::byte> chunk() const {
+            return m_gen ? m_gen.promise().value : std::span<const std::byte>();
+        }
+
+        /* Once next() has returned false: Z_OK if the stream ended
+         * properly, Z_DATA_ERROR if it was corrupt or the source ran dry
+         * first, or another error from inflate().
+         */
+        int status() const {
+            return m_gen && m_gen.done() ? m_gen.promise().status
+                                         : Z_STREAM_ERROR;
+        }
+
+    private:
+        explicit uzchunks(std::coroutine_handle<promise_type> gen)
+            : m_gen(gen) {}
+
+        std::coroutine_handle<promise_type> m_gen;
+};
+
+/*
+ * Decompresses one stream with z, which is reset first.  Whenever inflate()
+ * has used up its input the decoder suspends on co_await source(), which
+ * must produce the next piece of input as something convertible to
+ * std::span<const std::byte>; an empty piece means end of input.  That
+ * piece must stay valid until source() is called again.  Output goes
+ * through a buffer of size bytes that is reused for every chunk.  z and
+ * source are referenced and must outlive the returned uzchunks.
+ */
+template <class Source>
+uzchunks
+uzinflate_chunks(uzinflater& z, Source& source, std::size_t size = 65536)
+{
+    std::vector<std::byte> buf(size);
+    std::size_t len;
+    int r = z.reset();
+
+    if (r != Z_OK) co_return r;
+    for (;;) {
+        if (z.pending().empty()) {
+            std::span<const std::byte> in = co_await source();
+            if (in.empty()) co_return Z_DATA_ERROR;
+            z.input(in);
+        }
+        r = z.inflate(buf, len);
+        if (len) co_yield std::span<const std::byte>(buf.data(), len);
+        if (r == Z_STREAM_END) co_return Z_OK;
+        if (r == Z_NEED_DICT) co_return Z_DATA_ERROR;
+        if (r != Z_OK && r != Z_BUF_ERROR) co_return r;
+    }
+}
+
+#endif
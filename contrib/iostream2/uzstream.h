@@ -0,0 +1,306 @@
+#ifndef UZSTREAM__H
+#define UZSTREAM__H
+
+/*
+ * uzstream.h - C++20 in-memory interface to uzinflate
+ *
+ * izstream reads through a gzFile, so a payload that is already in memory
+ * has to go through a file.  uzinflater decompresses straight from a span
+ * or string_view, which is referenced and never copied, into a buffer of
+ * the caller's or one taken from a uzbuffer_pool.  The z_stream is kept
+ * between messages and only reset, so a steady stream of messages costs no
+ * allocation once the window and buffers have reached their working size.
+ */
+
+#include <climits>
+#include <cstddef>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "uzlib.h"
+
+class uzbuffer_pool;
+
+//  ----------------------------- uzbuffer -----------------------------
+
+class uzbuffer
+{
+    public:
+        uzbuffer() : m_len(0), m_pool(0) {}
+        uzbuffer(uzbuffer&& other) noexcept
+            : m_data(std::move(other.m_data)), m_len(other.m_len),
+              m_pool(other.m_pool) {
+            other.m_len = 0; other.m_pool = 0;
+        }
+        uzbuffer& operator=(uzbuffer&& other) noexcept {
+            if (this != &other) {
+                release();
+                m_data = std::move(other.m_data); m_len = other.m_len;
+                m_pool = other.m_pool;
+                other.m_len = 0; other.m_pool = 0;
+            }
+            return *this;
+        }
+        uzbuffer(const uzbuffer&) = delete;
+        uzbuffer& operator=(const uzbuffer&) = delete;
+        ~uzbuffer() { release(); }
+
+        /* The bytes produced so far.
+         */
+        std::span<const std::byte> data() const {
+            return std::span<const std::byte>(m_data.data(), m_len);
+        }
+        std::string_view view() const {
+            return std::string_view((const char*) m_data.data(), m_len);
+        }
+        std::size_t size() const { return m_len; }
+        std::size_t capacity() const { return m_data.size(); }
+
+        /* Forgets the contents but keeps the memory.
+         */
+        void clear() { m_len = 0; }
+
+    private:
+        friend class uzbuffer_pool;
+        friend class uzinflater;
+
+        /* The unused part of the buffer, at least min bytes long.  The
+         * vector is always kept at its full size so that reusing it never
+         * writes zeros over memory that inflate() is about to fill.
+         */
+        std::span<std::byte> room(std::size_t min) {
+            if (m_data.size() - m_len < min) {
+                std::size_t size = m_data.size() ? m_data.size() : min;
+                while (size - m_len < min) size <<= 1;
+                m_data.resize(size);
+            }
+            return std::span<std::byte>(m_data.data() + m_len,
+                                        m_data.size() - m_len);
+        }
+
+        inline void release();
+
+        std::vector<std::byte> m_data;
+        std::size_t m_len;
+        uzbuffer_pool* m_pool;
+};
+
+//  --------------------------- uzbuffer_pool ---------------------------
+
+class uzbuffer_pool
+{
+    public:
+        /* Buffers start at size bytes and grow as needed; up to keep of
+         * them are held for reuse when they are released.
+         */
+        explicit uzbuffer_pool(std::size_t size = 65536, std::size_t keep = 16)
+            : m_size(size), m_keep(keep) {}
+        uzbuffer_pool(const uzbuffer_pool&) = delete;
+        uzbuffer_pool& operator=(const uzbuffer_pool&) = delete;
+
+        /* Hands out an empty buffer, which goes back to the pool when it is
+         * destroyed.  The pool must outlive its buffers.
+         */
+        uzbuffer get() {
+            uzbuffer buf;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                if (!m_free.empty()) {
+                    buf.m_data = std::move(m_free.back());
+                    m_free.pop_back();
+                }
+            }
+            if (buf.m_data.empty()) buf.m_data.resize(m_size);
+            buf.m_pool = this;
+            return buf;
+        }
+
+    private:
+        friend class uzbuffer;
+
+        void put(std::vector<std::byte>&& data) {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_free.size() < m_keep) m_free.push_back(std::move(data));
+        }
+
+        std::size_t m_size;
+        std::size_t m_keep;
+        std::mutex m_lock;
+        std::vector<std::vector<std::byte> > m_free;
+};
+
+inline void uzbuffer::release() {
+    if (m_pool && !m_data.empty()) m_pool->put(std::move(m_data));
+    m_data = std::vector<std::byte>();
+    m_len = 0; m_pool = 0;
+}
+
+//  ---------------------------- uzinflater ----------------------------
+
+class uzinflater
+{
+    public:
+        /* Sets up a stream using the default allocator.  Check error()
+         * for Z_MEM_ERROR before use.
+         */
+        uzinflater() : m_next(0), m_left(0) {
+            m_z.next_in = Z_NULL; m_z.avail_in = 0;
+            m_z.zalloc = (alloc_func) 0; m_z.zfree = (free_func) 0;
+            m_z.opaque = (voidp) 0;
+            m_err = ::inflateInit(&m_z);
+            if (m_err != Z_OK) m_z.state = 0;
+        }
+
+        /* The stream has no pointers back into the z_stream, so moving
+         * just takes the structure over.
+         */
+        uzinflater(uzinflater&& other) noexcept
+            : m_z(other.m_z), m_err(other.m_err),
+              m_next(other.m_next), m_left(other.m_left) {
+            other.m_z.state = 0; other.m_err = Z_STREAM_ERROR;
+            other.m_next = 0; other.m_left = 0;
+        }
+        uzinflater& operator=(uzinflater&& other) noexcept {
+            if (this != &other) {
+                if (m_z.state) ::inflateEnd(&m_z);
+                m_z = other.m_z; m_err = other.m_err;
+                m_next = other.m_next; m_left = other.m_left;
+                other.m_z.state = 0; other.m_err = Z_STREAM_ERROR;
+                other.m_next = 0; other.m_left = 0;
+            }
+            return *this;
+        }
+        uzinflater(const uzinflater&) = delete;
+        uzinflater& operator=(const uzinflater&) = delete;
+        ~uzinflater() { if (m_z.state) ::inflateEnd(&m_z); }
+
+        /* Z_OK if the stream could be set up, else the error from
+         * inflateInit(); Z_STREAM_ERROR once moved from.
+         */
+        int error() const { return m_err; }
+        const char* msg() const { return m_z.msg; }
+
+        /* Starts over for a new stream, keeping the window and the
+         * dictionary table.  Any input not yet consumed is dropped.
+         */
+        int reset() {
+            m_next = 0; m_left = 0;
+            if (m_z.state == 0) return m_err;
+            return ::inflateReset(&m_z);
+        }
+
+        /* Gives the stream a table of shared dictionaries, see
+         * inflateUseDictionaries().  The table is referenced, not copied.
+         */
+        int use_dictionaries(std::span<const z_dictionary> dicts) {
+            if (m_z.state == 0) return m_err;
+            return ::inflateUseDictionaries(&m_z, dicts.data(),
+                                            (unsigned) dicts.size());
+        }
+
+        /* Points the stream at the next piece of compressed input, which
+         * must stay valid until it has been consumed or reset() is called.
+         */
+        void input(std::span<const std::byte> in) {
+            m_next = (const Bytef*) in.data(); m_left = in.size();
+        }
+        void input(std::string_view in) {
+            m_next = (const Bytef*) in.data(); m_left = in.size();
+        }
+
+        /* Compressed bytes not consumed yet.  After Z_STREAM_END these are
+         * whatever followed the stream.
+         */
+        std::span<const std::byte> pending() const {
+            return std::span<const std::byte>((const std::byte*) m_next,
+                                              m_left);
+        }
+
+        std::size_t total_in() const { return m_z.total_in; }
+        std::size_t total_out() const { return m_z.total_out; }
+
+        /* Decompresses pending input into out and stores the number of
+         * bytes written in len.  Returns as inflate() does; spans larger
+         * than uInt are fed to it in pieces.
+         */
+        int inflate(std::span<std::byte> out, std::size_t& len,
+                    int flush = Z_NO_FLUSH) {
+            std::size_t room = out.size();
+            int r = Z_BUF_ERROR;
+
+            len = 0;
+            if (m_z.state == 0) return m_err;
+            do {
+                std::size_t in = m_left < UINT_MAX ? m_left : UINT_MAX;
+                std::size_t put = room - len < UINT_MAX ? room - len : UINT_MAX;
+                bool last = in == m_left && put == room - len;
+                m_z.next_in = (Bytef*) m_next;
+                m_z.avail_in = (uInt) in;
+                m_z.next_out = (Bytef*) out.data() + len;
+                m_z.avail_out = (uInt) put;
+                r = ::inflate(&m_z, last ? flush : Z_NO_FLUSH);
+                m_next = m_z.next_in; m_left -= in - m_z.avail_in;
+                len += put - m_z.avail_out;
+                if (r != Z_OK) break;
+            } while (m_left && len < room);
+            return r;
+        }
+
+        /* Decompresses a whole stream from in into out.  Returns Z_OK with
+         * the size in len, Z_BUF_ERROR if out is too small, Z_DATA_ERROR
+         * if in is corrupt or incomplete, or Z_MEM_ERROR.
+         */
+        int decompress(std::span<const std::byte> in, std::span<std::byte> out,
+                       std::size_t& len) {
+            int r = reset();
+            if (r != Z_OK) { len = 0; return r; }
+            input(in);
+            r = inflate(out, len, Z_FINISH);
+            return finish(r, len == out.size());
+        }
+        int decompress(std::string_view in, std::span<std::byte> out,
+                       std::size_t& len) {
+            return decompress(std::as_bytes(std::span<const char>(in)), out, len);
+        }
+
+        /* Decompresses a whole stream from in, appending to out, which
+         * grows as needed.  Use a buffer from a uzbuffer_pool, or keep one
+         * around, to avoid allocating for every message.
+         */
+        int decompress(std::span<const std::byte> in, uzbuffer& out) {
+            int r = reset();
+            if (r != Z_OK) return r;
+            input(in);
+            for (;;) {
+                std::span<std::byte> room = out.room(in.size() > 4096 ? in.size() : 4096);
+                std::size_t len;
+                r = inflate(room, len);
+                out.m_len += len;
+                if (r != Z_OK || len < room.size()) break;
+            }
+            return finish(r, false);
+        }
+        int decompress(std::string_view in, uzbuffer& out) {
+            return decompress(std::as_bytes(std::span<const char>(in)), out);
+        }
+
+    private:
+        /* Maps the last inflate() status of a one-shot decompression to
+         * the result, as uncompress() does.
+         */
+        int finish(int r, bool full) const {
+            if (r == Z_STREAM_END) return Z_OK;
+            if (r == Z_NEED_DICT || ((r == Z_BUF_ERROR || r == Z_OK) && !full))
+                return Z_DATA_ERROR;
+            return r == Z_OK ? Z_BUF_ERROR : r;
+        }
+
+        z_stream m_z;
+        int m_err;
+        const Bytef* m_next;
+        std::size_t m_left;
+};
+
+#endif
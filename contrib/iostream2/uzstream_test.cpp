@@ -0,0 +1,238 @@
+/*
+ * uzstream_test.cpp - checks uzstream.h and uzcoro.h
+ *
+ * Build from the top directory with
+ *
+ *     gcc -c uzinflate.c
+ *     g++ -std=c++20 -I. contrib/iostream2/uzstream_test.cpp uzinflate.o
+ *
+ * and run without arguments; it prints "ok" or what failed.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "uzstream.h"
+#include "uzcoro.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    if (!ok) {
+        std::printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+/* "hello, hello! " 500 times, compressed at level 9 */
+static const unsigned char hello[] = {
+    0x78, 0xda, 0xed, 0xc7, 0xb1, 0x09, 0x00, 0x20, 0x0c, 0x00, 0xb0, 0x57,
+    0xec, 0xee, 0x5b, 0x42, 0x87, 0x42, 0xff, 0xdf, 0x8a, 0xb8, 0x79, 0x43,
+    0xa6, 0x90, 0x3c, 0x55, 0xbd, 0x57, 0x5e, 0xe2, 0x61, 0x66, 0x66, 0x66,
+    0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0xdf, 0x06,
+    0x7e, 0xaa, 0x32, 0x0c
+};
+
+/* "hello, hello! hello!" with "hello, hello! " as preset dictionary */
+static const unsigned char hello_dict[] = {
+    0x78, 0xf9, 0x26, 0x26, 0x04, 0xb6, 0xcb, 0xc0, 0xe4, 0x29, 0x02, 0x00,
+    0x4a, 0xc6, 0x06, 0xeb
+};
+
+static std::string hellos() {
+    std::string s;
+    for (int i = 0; i < 500; i++) s += "hello, hello! ";
+    return s;
+}
+
+static std::span<const std::byte> bytes(const unsigned char* p, std::size_t n) {
+    return std::span<const std::byte>((const std::byte*) p, n);
+}
+
+/* Wraps data in a zlib stream of stored blocks, so that a large stream
+ * needs no compressor.
+ */
+static std::vector<std::byte> stored(const std::vector<std::byte>& data) {
+    std::vector<std::byte> z;
+    unsigned long a = 1, b = 0;
+    std::size_t pos = 0;
+
+    z.push_back(std::byte(0x78)); z.push_back(std::byte(0x01));
+    do {
+        std::size_t n = data.size() - pos < 65535 ? data.size() - pos : 65535;
+        z.push_back(std::byte(pos + n == data.size()));
+        z.push_back(std::byte(n & 0xff)); z.push_back(std::byte(n >> 8));
+        z.push_back(std::byte(~n & 0xff)); z.push_back(std::byte((~n >> 8) & 0xff));
+        z.insert(z.end(), data.begin() + pos, data.begin() + pos + n);
+        pos += n;
+    } while (pos < data.size());
+    for (std::byte c : data) {
+        a = (a + (unsigned char) c) % 65521;
+        b = (b + a) % 65521;
+    }
+    for (int shift = 24; shift >= 0; shift -= 8)
+        z.push_back(std::byte((((b << 16) | a) >> shift) & 0xff));
+    return z;
+}
+
+//  --------------------------- uzinflater ---------------------------
+
+static void test_inflater() {
+    std::string want = hellos();
+    std::vector<std::byte> out(want.size());
+    std::size_t len;
+    uzinflater z;
+
+    check(z.error() == Z_OK, "uzinflater()");
+    check(z.decompress(bytes(hello, sizeof(hello)), out, len) == Z_OK &&
+          len == want.size() && !std::memcmp(out.data(), want.data(), len),
+          "decompress into a span");
+    check(z.decompress(bytes(hello, sizeof(hello)),
+                       std::span<std::byte>(out).first(100), len) == Z_BUF_ERROR,
+          "decompress into a short span");
+    std::vector<std::byte> more(want.size() + 64);
+    check(z.decompress(bytes(hello, sizeof(hello) - 3), more, len) == Z_DATA_ERROR,
+          "decompress truncated input");
+
+    /* again, to see the stream is reset in between */
+    uzbuffer buf;
+    check(z.decompress(bytes(hello, sizeof(hello)), buf) == Z_OK &&
+          buf.view() == want, "decompress into a uzbuffer");
+
+    const char text[] = "hello, hello! ";
+    z_dictionary dict;
+    inflateDictionaryInit(&dict, (const Bytef*) text, sizeof(text) - 1);
+    check(z.decompress(bytes(hello_dict, sizeof(hello_dict)), out, len) ==
+          Z_DATA_ERROR, "decompress without the dictionary");
+    check(z.use_dictionaries(std::span<const z_dictionary>(&dict, 1)) == Z_OK &&
+          z.decompress(bytes(hello_dict, sizeof(hello_dict)), out, len) == Z_OK &&
+          std::string_view((const char*) out.data(), len) == "hello, hello! hello!",
+          "decompress with a shared dictionary");
+
+    uzinflater moved(std::move(z));
+    check(z.error() == Z_STREAM_ERROR && moved.error() == Z_OK,
+          "moving a uzinflater");
+    check(moved.decompress(bytes(hello, sizeof(hello)), out, len) == Z_OK &&
+          len == want.size(), "decompress after a move");
+}
+
+static void test_pool() {
+    uzbuffer_pool pool(1024, 2);
+    uzinflater z;
+    const std::byte* first;
+
+    {
+        uzbuffer buf = pool.get();
+        check(buf.capacity() == 1024 && buf.size() == 0, "uzbuffer_pool::get");
+        check(z.decompress(bytes(hello, sizeof(hello)), buf) == Z_OK &&
+              buf.view() == hellos(), "decompress into a pooled buffer");
+        first = buf.data().data();
+    }
+    uzbuffer again = pool.get();
+    check(again.data().data() == first && again.capacity() >= hellos().size() &&
+          again.size() == 0, "buffer returned to the pool and reused");
+}
+
+//  --------------------------- uzchunks ---------------------------
+
+/* A consumer coroutine that runs as soon as it is called. */
+struct task {
+    struct promise_type {
+        task get_return_object() {
+            return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() { std::terminate(); }
+    };
+    std::coroutine_handle<promise_type> h;
+    task(task&& other) noexcept : h(std::exchange(other.h, nullptr)) {}
+    explicit task(std::coroutine_handle<promise_type> h) : h(h) {}
+    ~task() { if (h) h.destroy(); }
+    bool done() const { return h.done(); }
+};
+
+/* Hands out data in pieces of a fixed size.  With later set, every piece
+ * is only delivered once the main loop resumes the waiting decoder, as an
+ * event loop would.
+ */
+struct pieces {
+    std::span<const std::byte> data;
+    std::size_t size;
+    bool later;
+    std::coroutine_handle<> waiting;
+
+    struct awaiter {
+        pieces& src;
+        bool await_ready() noexcept { return !src.later; }
+        void await_suspend(std::coroutine_handle<> h) noexcept { src.waiting = h; }
+        std::span<const std::byte> await_resume() noexcept {
+            std::size_t n = src.data.size() < src.size ? src.data.size() : src.size;
+            std::span<const std::byte> piece = src.data.first(n);
+            src.data = src.data.subspan(n);
+            return piece;
+        }
+    };
+    awaiter operator()() { return awaiter{*this}; }
+};
+
+static task consume(uzchunks& chunks, std::vector<std::byte>& out,
+                    std::size_t& count) {
+    while (co_await chunks.next()) {
+        std::span<const std::byte> c = chunks.chunk();
+        out.insert(out.end(), c.begin(), c.end());
+        count++;
+    }
+}
+
+/* Decompresses 8M in chunks of 100 bytes from pieces of 1000, some
+ * 80000 round trips between consumer and decoder.
+ */
+static void test_chunks(bool later) {
+    std::vector<std::byte> data(8 << 20), out;
+    unsigned long x = 1;
+    std::size_t count = 0;
+
+    for (std::byte& c : data) {
+        x = x * 1103515245 + 12345;
+        c = std::byte(x >> 16);
+    }
+    std::vector<std::byte> z = stored(data);
+    pieces src{z, 1000, later, nullptr};
+    uzinflater zs;
+    uzchunks chunks = uzinflate_chunks(zs, src, 100);
+
+    task t = consume(chunks, out, count);
+    while (!t.done() && src.waiting) {
+        std::coroutine_handle<> h = std::exchange(src.waiting, nullptr);
+        h.resume();
+    }
+    check(t.done() && chunks.status() == Z_OK, later ?
+          "uzinflate_chunks with a suspending source" : "uzinflate_chunks");
+    check(out == data && count >= data.size() / 100,
+          "uzinflate_chunks output");
+}
+
+static void test_chunks_truncated() {
+    std::vector<std::byte> out;
+    std::size_t count = 0;
+    pieces src{bytes(hello, sizeof(hello) - 3), 7, false, nullptr};
+    uzinflater z;
+    uzchunks chunks = uzinflate_chunks(z, src, 64);
+
+    task t = consume(chunks, out, count);
+    check(t.done() && chunks.status() == Z_DATA_ERROR,
+          "uzinflate_chunks with truncated input");
+}
+
+int main() {
+    test_inflater();
+    test_pool();
+    test_chunks(false);
+    test_chunks(true);
+    test_chunks_truncated();
+    std::printf("%s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
@@ -10,6 +10,9 @@
 #include "zfstream.h"
 #include <cstring>          // for strcpy, strcat, strlen (mode strings)
 #include <cstdio>           // for BUFSIZ
+#include <climits>          // for INT_MAX
+#include <algorithm>        // for std::min
+#include <pthread.h>        // for read-ahead thread
 
 // Internal buffer sizes (default and "unbuffered" versions)
 #define BIGBUFSIZE BUFSIZ
@@ -17,10 +20,76 @@
 
 /*****************************************************************************/
 
+// State shared by gzfilebuf and its read-ahead thread
+struct gzreadahead
+{
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;      // Broadcast whenever any field below changes
+  gzFile file;
+  int nbufs;
+  unsigned size;
+  char** bufs;              // Ring of buffers
+  int* counts;              // Result of gzread for each filled buffer
+  int take;                 // Next filled buffer for reader
+  int fill;                 // Next buffer for worker to fill
+  int ready;                // Number of filled buffers not yet taken
+  bool busy;                // Reader's get area is in buffer before take
+  bool done;                // Worker has stopped
+  bool started;             // Worker thread was created (must be joined)
+  bool stop;                // Reader asks worker to stop
+};
+
+// Read-ahead thread: keep decompressing into free buffers of the ring
+extern "C" void*
+gzreadahead_run(void* arg)
+{
+  gzreadahead* ra = static_cast<gzreadahead*>(arg);
+  pthread_mutex_lock(&ra->lock);
+  while (!ra->stop)
+  {
+    // Wait until reader releases a buffer
+    if (ra->ready + int(ra->busy) == ra->nbufs)
+    {
+      pthread_cond_wait(&ra->cond, &ra->lock);
+      continue;
+    }
+    // Decompress without holding the lock (reader never touches this buffer)
+    int slot = ra->fill;
+    pthread_mutex_unlock(&ra->lock);
+    int bytes_read = gzread(ra->file, ra->bufs[slot], ra->size);
+    pthread_mutex_lock(&ra->lock);
+    ra->counts[slot] = bytes_read;
+    ra->fill = (slot + 1) % ra->nbufs;
+    ra->ready++;
+    pthread_cond_broadcast(&ra->cond);
+    // Error or EOF stays in ring as last buffer
+    if (bytes_read <= 0)
+      break;
+  }
+  ra->done = true;
+  pthread_cond_broadcast(&ra->cond);
+  pthread_mutex_unlock(&ra->lock);
+  return NULL;
+}
+
+// Output function for parallel stream: append to file
+extern "C" int
+gzfilebuf_pzout(voidp opaque, const Bytef* buf, unsigned len)
+{
+  FILE* out = static_cast<FILE*>(opaque);
+  return fwrite(buf, 1, len, out) != len;
+}
+
+/*****************************************************************************/
+
 // Default constructor
 gzfilebuf::gzfilebuf()
 : file(NULL), io_mode(std::ios_base::openmode(0)), own_fd(false),
-  buffer(NULL), buffer_size(BIGBUFSIZE), own_buffer(true)
+  buffer(NULL), buffer_size(BIGBUFSIZE), own_buffer(true),
+  ahead_bufs(0), ahead_size(1 << 20), ahead(NULL),
+  pz_threads(1), pz_block(0), pz_level(Z_DEFAULT_COMPRESSION),
+  pz_file(NULL), pz(NULL)
 {
   // No buffers to start with
   this->disable_buffer();
@@ -29,6 +98,8 @@ gzfilebuf::gzfilebuf()
 // Destructor
 gzfilebuf::~gzfilebuf()
 {
+  // Worker thread must not outlive the object
+  this->stop_readahead();
   // Sync output buffer and close only if responsible for file
   // (i.e. attached streams should be left open at this stage)
   this->sync();
@@ -43,6 +114,15 @@ int
 gzfilebuf::setcompression(int comp_level,
                           int comp_strategy)
 {
+  // Parallel stream takes level when opened on first write
+  if (pz_file)
+  {
+    if (pz || comp_strategy != Z_DEFAULT_STRATEGY ||
+        comp_level < Z_DEFAULT_COMPRESSION || comp_level > 9)
+      return Z_STREAM_ERROR;
+    pz_level = comp_level;
+    return Z_OK;
+  }
   return gzsetparams(file, comp_level, comp_strategy);
 }
 
@@ -63,14 +143,22 @@ gzfilebuf::open(const char *name,
   if (!this->open_mode(mode, char_mode))
     return NULL;
 
-  // Attempt to open file
-  if ((file = gzopen(name, char_mode)) == NULL)
+  // Attempt to open file (as plain file for parallel compression)
+  if (pz_threads != 1 && (mode & std::ios_base::out))
+  {
+    if ((pz_file = fopen(name, char_mode)) == NULL)
+      return NULL;
+    pz_level = Z_DEFAULT_COMPRESSION;
+  }
+  else if ((file = gzopen(name, char_mode)) == NULL)
     return NULL;
 
   // On success, allocate internal buffer and set flags
   this->enable_buffer();
   io_mode = mode;
   own_fd = true;
+  // Reading still works synchronously if the thread can't be started
+  this->start_readahead();
   return this;
 }
 
@@ -91,14 +179,22 @@ gzfilebuf::attach(int fd,
   if (!this->open_mode(mode, char_mode))
     return NULL;
 
-  // Attempt to attach to file
-  if ((file = gzdopen(fd, char_mode)) == NULL)
+  // Attempt to attach to file (as plain file for parallel compression)
+  if (pz_threads != 1 && (mode & std::ios_base::out))
+  {
+    if ((pz_file = fdopen(fd, char_mode)) == NULL)
+      return NULL;
+    pz_level = Z_DEFAULT_COMPRESSION;
+  }
+  else if ((file = gzdopen(fd, char_mode)) == NULL)
     return NULL;
 
   // On success, allocate internal buffer and set flags
   this->enable_buffer();
   io_mode = mode;
   own_fd = false;
+  // Reading still works synchronously if the thread can't be started
+  this->start_readahead();
   return this;
 }
 
@@ -111,10 +207,24 @@ gzfilebuf::close()
     return NULL;
   // Assume success
   gzfilebuf* retval = this;
+  // Worker thread must be done with file before it goes
+  this->stop_readahead();
   // Attempt to sync and close gzipped file
   if (this->sync() == -1)
     retval = NULL;
-  if (gzclose(file) < 0)
+  if (pz_file)
+  {
+    // Even an empty file needs a gzip header and trailer
+    if (!pz)
+      pz = pzopen(gzfilebuf_pzout, pz_file, pz_level, 31, pz_threads, pz_block);
+    if (!pz || pzclose(pz) != Z_OK)
+      retval = NULL;
+    if (fclose(pz_file) != 0)
+      retval = NULL;
+    pz = NULL;
+    pz_file = NULL;
+  }
+  else if (gzclose(file) < 0)
     retval = NULL;
   // File is now gone anyway (postcondition [27.8.1.3.8])
   file = NULL;
@@ -174,6 +284,21 @@ gzfilebuf::showmanyc()
   // Make sure get area is in use
   if (this->gptr() && (this->gptr() < this->egptr()))
     return std::streamsize(this->egptr() - this->gptr());
+  // With read-ahead, next filled buffer is available too
+  if (ahead)
+  {
+    pthread_mutex_lock(&ahead->lock);
+    std::streamsize avail = 0;
+    if (ahead->ready)
+      avail = ahead->counts[ahead->take] > 0 ? ahead->counts[ahead->take] : -1;
+    else if (ahead->done)
+      avail = -1;
+    pthread_mutex_unlock(&ahead->lock);
+    return avail;
+  }
+  // Nothing more will come once gzread has hit the end of the file
+  else if (gzeof(file))
+    return -1;
   else
     return 0;
 }
@@ -192,6 +317,38 @@ gzfilebuf::underflow()
   if (!this->is_open() || !(io_mode & std::ios_base::in))
     return traits_type::eof();
 
+  // With read-ahead, release current buffer and move on to next one
+  if (ahead)
+  {
+    pthread_mutex_lock(&ahead->lock);
+    if (ahead->busy)
+    {
+      ahead->busy = false;
+      pthread_cond_broadcast(&ahead->cond);
+    }
+    while (!ahead->ready && !ahead->done)
+      pthread_cond_wait(&ahead->cond, &ahead->lock);
+    char_type* next = NULL;
+    int bytes_read = 0;
+    // Error or EOF buffer is left in ring, so that it is seen again
+    if (ahead->ready && ahead->counts[ahead->take] > 0)
+    {
+      next = ahead->bufs[ahead->take];
+      bytes_read = ahead->counts[ahead->take];
+      ahead->take = (ahead->take + 1) % ahead->nbufs;
+      ahead->ready--;
+      ahead->busy = true;
+    }
+    pthread_mutex_unlock(&ahead->lock);
+    if (!next)
+    {
+      this->setg(buffer, buffer, buffer);
+      return traits_type::eof();
+    }
+    this->setg(next, next, next + bytes_read);
+    return traits_type::to_int_type(*(this->gptr()));
+  }
+
   // Attempt to fill internal buffer from gzipped file
   // (buffer must be guaranteed to exist...)
   int bytes_read = gzread(file, buffer, buffer_size);
@@ -209,6 +366,43 @@ gzfilebuf::underflow()
   return traits_type::to_int_type(*(this->gptr()));
 }
 
+// Read block of characters, bypassing get area for large requests
+std::streamsize
+gzfilebuf::xsgetn(char_type* s,
+                  std::streamsize n)
+{
+  std::streamsize done = 0;
+  // First drain whatever is left in the get area
+  if (this->gptr() && (this->gptr() < this->egptr()))
+  {
+    done = std::min(n, std::streamsize(this->egptr() - this->gptr()));
+    traits_type::copy(s, this->gptr(), done);
+    this->gbump(done);
+  }
+  // Small requests are best served from a refilled get area, and
+  // with read-ahead only the worker thread may call gzread
+  if (ahead || n - done < buffer_size)
+    return done + std::streambuf::xsgetn(s + done, n - done);
+
+  // If the file hasn't been opened for reading, produce error
+  if (!this->is_open() || !(io_mode & std::ios_base::in))
+    return done;
+  // Decompress straight into caller's array (gzread takes an unsigned
+  // count but returns an int, so go in chunks of at most INT_MAX/2)
+  while (done < n)
+  {
+    std::streamsize chunk = std::min(n - done, std::streamsize(INT_MAX / 2));
+    int bytes_read = gzread(file, s + done, unsigned(chunk));
+    // Indicates error or EOF
+    if (bytes_read <= 0)
+      break;
+    done += bytes_read;
+  }
+  // Get area is now empty (no putback available across a direct read)
+  this->setg(buffer, buffer, buffer);
+  return done;
+}
+
 // Write put area to gzipped file
 gzfilebuf::int_type
 gzfilebuf::overflow(int_type c)
@@ -234,7 +428,7 @@ gzfilebuf::overflow(int_type c)
       if (!this->is_open() || !(io_mode & std::ios_base::out))
         return traits_type::eof();
       // If gzipped file won't accept all bytes written to it, fail
-      if (gzwrite(file, this->pbase(), bytes_to_write) != bytes_to_write)
+      if (this->compress(this->pbase(), bytes_to_write) != bytes_to_write)
         return traits_type::eof();
       // Reset next pointer to point to pbase on success
       this->pbump(-bytes_to_write);
@@ -249,7 +443,7 @@ gzfilebuf::overflow(int_type c)
     // Impromptu char buffer (allows "unbuffered" output)
     char_type last_char = traits_type::to_char_type(c);
     // If gzipped file won't accept this character, fail
-    if (gzwrite(file, &last_char, 1) != 1)
+    if (this->compress(&last_char, 1) != 1)
       return traits_type::eof();
   }
 
@@ -261,6 +455,34 @@ gzfilebuf::overflow(int_type c)
     return c;
 }
 
+// Write block of characters, bypassing put area for large requests
+std::streamsize
+gzfilebuf::xsputn(const char_type* s,
+                  std::streamsize n)
+{
+  // Requests that fit in the put area are simply buffered
+  if (this->pbase() && (n < this->epptr() - this->pptr()))
+    return std::streambuf::xsputn(s, n);
+
+  // If the file hasn't been opened for writing, produce error
+  if (!this->is_open() || !(io_mode & std::ios_base::out))
+    return 0;
+  // Empty put area first to keep characters in order
+  if (this->sync() == -1)
+    return 0;
+  // Compress straight from caller's array, in chunks that fit an int
+  std::streamsize done = 0;
+  while (done < n)
+  {
+    std::streamsize chunk = std::min(n - done, std::streamsize(INT_MAX / 2));
+    // If gzipped file won't accept all bytes written to it, fail
+    if (this->compress(s + done, int(chunk)) != int(chunk))
+      break;
+    done += chunk;
+  }
+  return done;
+}
+
 // Assign new buffer
 std::streambuf*
 gzfilebuf::setbuf(char_type* p,
@@ -301,8 +523,106 @@ gzfilebuf::sync()
   return traits_type::eq_int_type(this->overflow(), traits_type::eof()) ? -1 : 0;
 }
 
+// Set up read-ahead ring
+gzfilebuf*
+gzfilebuf::setreadahead(int nbufs,
+                        std::streamsize size)
+{
+  // Ring can't be swapped under a running worker
+  if (ahead || nbufs < 0 || size <= 0 || size > INT_MAX)
+    return NULL;
+  ahead_bufs = nbufs;
+  ahead_size = size;
+  return this->start_readahead() ? this : NULL;
+}
+
+// Set up parallel compression
+gzfilebuf*
+gzfilebuf::setthreads(int threads,
+                      unsigned long block)
+{
+  // Choice of compressor is made when file is opened
+  if (this->is_open() || threads < 0)
+    return NULL;
+  pz_threads = threads;
+  pz_block = block;
+  return this;
+}
+
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 
+// Compress characters to file
+int
+gzfilebuf::compress(const char_type* s,
+                    int n)
+{
+  if (!pz_file)
+    return gzwrite(file, s, unsigned(n));
+  // Open parallel stream on first write, with level set by then
+  if (!pz)
+  {
+    pz = pzopen(gzfilebuf_pzout, pz_file, pz_level, 31, pz_threads, pz_block);
+    if (!pz)
+      return 0;
+  }
+  return pzwrite(pz, s, unsigned(n));
+}
+
+// Start read-ahead thread
+bool
+gzfilebuf::start_readahead()
+{
+  // Only needed for files open for reading
+  if (ahead || ahead_bufs <= 0 ||
+      !this->is_open() || !(io_mode & std::ios_base::in))
+    return true;
+
+  gzreadahead* ra = new gzreadahead;
+  ra->file = file;
+  ra->nbufs = ahead_bufs;
+  ra->size = unsigned(ahead_size);
+  ra->bufs = new char*[ra->nbufs];
+  ra->counts = new int[ra->nbufs];
+  for (int i = 0; i < ra->nbufs; ++i)
+    ra->bufs[i] = new char_type[ra->size];
+  ra->take = ra->fill = ra->ready = 0;
+  ra->busy = ra->done = ra->stop = false;
+  pthread_mutex_init(&ra->lock, NULL);
+  pthread_cond_init(&ra->cond, NULL);
+  ahead = ra;
+  bool started = pthread_create(&ra->thread, NULL, gzreadahead_run, ra) == 0;
+  ra->started = started;
+  if (!started)
+    this->stop_readahead();
+  return started;
+}
+
+// Stop read-ahead thread
+void
+gzfilebuf::stop_readahead()
+{
+  if (!ahead)
+    return;
+  gzreadahead* ra = ahead;
+  pthread_mutex_lock(&ra->lock);
+  ra->stop = true;
+  pthread_cond_broadcast(&ra->cond);
+  pthread_mutex_unlock(&ra->lock);
+  // Thread has to be joined even if it finished by itself
+  if (ra->started)
+    pthread_join(ra->thread, NULL);
+  pthread_cond_destroy(&ra->cond);
+  pthread_mutex_destroy(&ra->lock);
+  for (int i = 0; i < ra->nbufs; ++i)
+    delete[] ra->bufs[i];
+  delete[] ra->bufs;
+  delete[] ra->counts;
+  delete ra;
+  ahead = NULL;
+  // Get area may point into a ring buffer that is now gone
+  this->setg(buffer, buffer, buffer);
+}
+
 // Allocate internal buffer
 void
 gzfilebuf::enable_buffer()
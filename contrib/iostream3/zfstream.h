@@ -12,8 +12,12 @@
 
 #include <istream>  // not iostream, since we don't need cin/cout
 #include <ostream>
+#include <cstdio>   // for FILE
 #include "zlib.h"
 
+// State of the read-ahead thread (defined in zfstream.cc)
+struct gzreadahead;
+
 /*****************************************************************************/
 
 /**
@@ -44,6 +48,9 @@ public:
    *  previous zfstream version assumed. Since the strategy is seldom changed,
    *  it can default and setcompression(level) then becomes like the old
    *  setcompressionlevel(level).
+   *
+   *  With parallel compression (see setthreads), only the level can be set,
+   *  and only before anything is written to the file.
   */
   int
   setcompression(int comp_level,
@@ -54,7 +61,7 @@ public:
    *  @return  True if file is open.
   */
   bool
-  is_open() const { return (file != NULL); }
+  is_open() const { return (file != NULL || pz_file != NULL); }
 
   /**
    *  @brief  Open gzipped file.
@@ -83,6 +90,39 @@ public:
   gzfilebuf*
   close();
 
+  /**
+   *  @brief  Decompress ahead of the reader in a background thread.
+   *  @param  nbufs  Number of buffers in ring (0 turns read-ahead off).
+   *  @param  size  Size of each buffer.
+   *  @return  @c this on success, NULL on failure.
+   *
+   *  While a file is open for reading, a worker thread fills a ring of
+   *  @a nbufs buffers with gzread, and underflow just moves the get area to
+   *  the next filled buffer, so parsing and inflating overlap on two cores.
+   *  The setting applies to the open file (if any) and to files opened
+   *  later, but cannot be changed while a read-ahead thread is running.
+   *  At least two buffers are needed for any overlap.
+  */
+  gzfilebuf*
+  setreadahead(int nbufs,
+               std::streamsize size = 1 << 20);
+
+  /**
+   *  @brief  Compress output on several threads.
+   *  @param  threads  Number of threads (0 for one per processor, 1 for none).
+   *  @param  block  Input bytes per block (0 for pzopen default).
+   *  @return  @c this on success, NULL on failure.
+   *
+   *  Files opened for writing afterwards are compressed with pzopen from
+   *  pdeflate.c, which cuts the output into blocks compressed in parallel,
+   *  each with the end of the previous one as dictionary, and writes them
+   *  in order as a single ordinary gzip stream. Cannot be changed while a
+   *  file is open.
+  */
+  gzfilebuf*
+  setthreads(int threads,
+             unsigned long block = 0);
+
 protected:
   /**
    *  @brief  Convert ios open mode int to mode string used by zlib.
@@ -98,6 +138,8 @@ protected:
    *
    *  This indicates number of characters in get area of stream buffer.
    *  These characters can be read without accessing the gzipped file.
+   *  Returns -1 once the get area is empty and the end of the file has
+   *  been reached.
   */
   virtual std::streamsize
   showmanyc();
@@ -112,6 +154,20 @@ protected:
   virtual int_type
   underflow();
 
+  /**
+   *  @brief  Read characters from gzipped file.
+   *  @param  s  Destination character array.
+   *  @param  n  Number of characters to read.
+   *  @return  Number of characters read.
+   *
+   *  Characters in the get area are copied first. Requests at least as
+   *  large as the stream buffer are then decompressed straight into
+   *  @a s by gzread, bypassing the stream buffer.
+  */
+  virtual std::streamsize
+  xsgetn(char_type* s,
+         std::streamsize n);
+
   /**
    *  @brief  Write put area to gzipped file.
    *  @param  c  Extra character to add to buffer contents.
@@ -124,6 +180,19 @@ protected:
   virtual int_type
   overflow(int_type c = traits_type::eof());
 
+  /**
+   *  @brief  Write characters to gzipped file.
+   *  @param  s  Source character array.
+   *  @param  n  Number of characters to write.
+   *  @return  Number of characters written.
+   *
+   *  Requests that fit in the put area are buffered as usual. Larger
+   *  ones flush the put area and are handed straight to gzwrite.
+  */
+  virtual std::streamsize
+  xsputn(const char_type* s,
+         std::streamsize n);
+
   /**
    *  @brief  Installs external stream buffer.
    *  @param  p  Pointer to char buffer.
@@ -180,6 +249,35 @@ private:
   void
   disable_buffer();
 
+  /**
+   *  @brief  Start read-ahead thread on open file, if requested.
+   *  @return  True on success or if no read-ahead is requested.
+  */
+  bool
+  start_readahead();
+
+  /**
+   *  @brief  Stop read-ahead thread and free its buffers.
+   *
+   *  This function is safe to call multiple times. Characters already
+   *  decompressed ahead but not yet consumed are lost.
+  */
+  void
+  stop_readahead();
+
+  /**
+   *  @brief  Compress characters to file.
+   *  @param  s  Characters to compress.
+   *  @param  n  Number of characters.
+   *  @return  Number of characters compressed, 0 on error.
+   *
+   *  This goes to gzwrite, or to pzwrite with parallel compression, in
+   *  which case the parallel stream is opened on first use.
+  */
+  int
+  compress(const char_type* s,
+           int n);
+
   /**
    *  Underlying file pointer.
   */
@@ -221,6 +319,33 @@ private:
    *  upon destruction.
   */
   bool own_buffer;
+
+  /**
+   *  Number and size of read-ahead buffers (0 buffers if disabled).
+  */
+  int ahead_bufs;
+  std::streamsize ahead_size;
+
+  /**
+   *  Read-ahead thread state, or NULL if not running.
+  */
+  gzreadahead* ahead;
+
+  /**
+   *  Parallel compression settings (1 thread if disabled).
+  */
+  int pz_threads;
+  unsigned long pz_block;
+  int pz_level;
+
+  /**
+   *  @brief  Output file and parallel stream with parallel compression.
+   *
+   *  The stream is NULL until something is written, so that the
+   *  compression level can still be set.
+  */
+  FILE* pz_file;
+  pzStream pz;
 };
 
 /*****************************************************************************/
@@ -51,6 +51,26 @@
 #  endif /* STDC */
 #endif /* !NOBYFOUR */
 
+/* On little-endian machines, do sixteen bytes at a time with twelve more
+   tables.  This is about twice as fast again as four bytes at a time. */
+#if defined(BYFOUR) && !defined(NOBYSIXTEEN)
+#  define BYSIXTEEN
+#endif
+
+/* On x86-64 processors with carry-less multiplication, fold sixty-four bytes
+   at a time as described in Intel's "Fast CRC Computation for Generic
+   Polynomials Using PCLMULQDQ Instruction".  Whether the processor has it is
+   found when the library is loaded. */
+#if defined(__GNUC__) && defined(__x86_64__) && defined(BYFOUR) && \
+    !defined(NOPCLMUL)
+#  define PCLMUL
+#  include <immintrin.h>
+   local unsigned long crc32_pclmul OF((unsigned long,
+                        const unsigned char FAR *, unsigned));
+   local void crc32_cpu_init OF((void)) __attribute__((constructor));
+   local int have_pclmul = 0;
+#endif
+
 /* Definitions for doing the crc four data bytes at a time. */
 #ifdef BYFOUR
 #  define REV(w) (((w)>>24)+(((w)>>8)&0xff00)+ \
@@ -59,23 +79,27 @@
                         const unsigned char FAR *, unsigned));
    local unsigned long crc32_big OF((unsigned long,
                         const unsigned char FAR *, unsigned));
-#  define TBLS 8
+#  ifdef BYSIXTEEN
+#    define TBLS 20
+#  else
+#    define TBLS 8
+#  endif
 #else
 #  define TBLS 1
 #endif /* BYFOUR */
 
 /* Local functions for crc concatenation */
-local unsigned long gf2_matrix_times OF((unsigned long *mat,
-                                         unsigned long vec));
-local void gf2_matrix_square OF((unsigned long *square, unsigned long *mat));
+local unsigned long multmodp OF((unsigned long a, unsigned long b));
+local unsigned long x2nmodp OF((z_off_t n, unsigned k));
 
 #ifdef DYNAMIC_CRC_TABLE
 
 local volatile int crc_table_empty = 1;
 local unsigned long FAR crc_table[TBLS][256];
+local unsigned long FAR x2n_table[32];
 local void make_crc_table OF((void));
 #ifdef MAKECRCH
-   local void write_table OF((FILE *, const unsigned long FAR *));
+   local void write_table OF((FILE *, const unsigned long FAR *, int));
 #endif /* MAKECRCH */
 /*
   Generate tables for a byte-wise 32-bit CRC calculation on the polynomial:
@@ -101,7 +125,12 @@ local void make_crc_table OF((void));
   all the information needed to generate CRCs on data a byte at a time for all
   combinations of CRC register values and incoming bytes.  The remaining tables
   allow for word-at-a-time CRC calculation for both big-endian and little-
-  endian machines, where a word is four bytes.
+  endian machines, where a word is four bytes.  With BYSIXTEEN there are
+  twelve more little-endian tables, for a byte followed by four to fifteen
+  zeros, to process four words at a time.
+
+  Last, x2n_table[] holds x^2^n mod p for n = 0..31, which crc32_combine()
+  multiplies together to get the operator that appends any number of zeros.
 */
 local void make_crc_table()
 {
@@ -145,6 +174,23 @@ local void make_crc_table()
         }
 #endif /* BYFOUR */
 
+#ifdef BYSIXTEEN
+        /* generate crc for each value followed by four to fifteen zeros */
+        for (n = 0; n < 256; n++) {
+            c = crc_table[3][n];
+            for (k = 8; k < 20; k++) {
+                c = crc_table[0][c & 0xff] ^ (c >> 8);
+                crc_table[k][n] = c;
+            }
+        }
+#endif /* BYSIXTEEN */
+
+        /* generate powers of x by repeated squaring, starting with x^1 */
+        c = 1UL << 30;
+        x2n_table[0] = c;
+        for (n = 1; n < 32; n++)
+            x2n_table[n] = c = multmodp(c, c);
+
         crc_table_empty = 0;
     }
     else {      /* not first */
@@ -164,31 +210,44 @@ local void make_crc_table()
         fprintf(out, " * Generated automatically by crc32.c\n */\n\n");
         fprintf(out, "local const unsigned long FAR ");
         fprintf(out, "crc_table[TBLS][256] =\n{\n  {\n");
-        write_table(out, crc_table[0]);
+        write_table(out, crc_table[0], 256);
 #  ifdef BYFOUR
         fprintf(out, "#ifdef BYFOUR\n");
         for (k = 1; k < 8; k++) {
             fprintf(out, "  },\n  {\n");
-            write_table(out, crc_table[k]);
+            write_table(out, crc_table[k], 256);
+        }
+#    ifdef BYSIXTEEN
+        fprintf(out, "#ifdef BYSIXTEEN\n");
+        for (k = 8; k < 20; k++) {
+            fprintf(out, "  },\n  {\n");
+            write_table(out, crc_table[k], 256);
         }
         fprintf(out, "#endif\n");
+#    endif /* BYSIXTEEN */
+        fprintf(out, "#endif\n");
 #  endif /* BYFOUR */
-        fprintf(out, "  }\n};\n");
+        fprintf(out, "  }\n};\n\n");
+        fprintf(out, "local const unsigned long FAR ");
+        fprintf(out, "x2n_table[32] =\n{\n");
+        write_table(out, x2n_table, 32);
+        fprintf(out, "};\n");
         fclose(out);
     }
 #endif /* MAKECRCH */
 }
 
 #ifdef MAKECRCH
-local void write_table(out, table)
+local void write_table(out, table, k)
     FILE *out;
     const unsigned long FAR *table;
+    int k;
 {
     int n;
 
-    for (n = 0; n < 256; n++)
+    for (n = 0; n < k; n++)
         fprintf(out, "%s0x%08lxUL%s", n % 5 ? "" : "    ", table[n],
-                n == 255 ? "\n" : (n % 5 == 4 ? ",\n" : ", "));
+                n == k - 1 ? "\n" : (n % 5 == 4 ? ",\n" : ", "));
 }
 #endif /* MAKECRCH */
 
@@ -233,8 +292,13 @@ unsigned long ZEXPORT crc32(crc, buf, len)
         u4 endian;
 
         endian = 1;
-        if (*((unsigned char *)(&endian)))
+        if (*((unsigned char *)(&endian))) {
+#ifdef PCLMUL
+            if (have_pclmul && len >= 64)
+                return crc32_pclmul(crc, buf, len);
+#endif /* PCLMUL */
             return crc32_little(crc, buf, len);
+        }
         else
             return crc32_big(crc, buf, len);
     }
@@ -257,6 +321,23 @@ unsigned long ZEXPORT crc32(crc, buf, len)
         c = crc_table[3][c & 0xff] ^ crc_table[2][(c >> 8) & 0xff] ^ \
             crc_table[1][(c >> 16) & 0xff] ^ crc_table[0][c >> 24]
 #define DOLIT32 DOLIT4; DOLIT4; DOLIT4; DOLIT4; DOLIT4; DOLIT4; DOLIT4; DOLIT4
+#define DOLIT16 c ^= buf4[0]; \
+        c = crc_table[19][c & 0xff] ^ crc_table[18][(c >> 8) & 0xff] ^ \
+            crc_table[17][(c >> 16) & 0xff] ^ crc_table[16][c >> 24] ^ \
+            crc_table[15][buf4[1] & 0xff] ^ \
+            crc_table[14][(buf4[1] >> 8) & 0xff] ^ \
+            crc_table[13][(buf4[1] >> 16) & 0xff] ^ \
+            crc_table[12][buf4[1] >> 24] ^ \
+            crc_table[11][buf4[2] & 0xff] ^ \
+            crc_table[10][(buf4[2] >> 8) & 0xff] ^ \
+            crc_table[9][(buf4[2] >> 16) & 0xff] ^ \
+            crc_table[8][buf4[2] >> 24] ^ \
+            crc_table[3][buf4[3] & 0xff] ^ \
+            crc_table[2][(buf4[3] >> 8) & 0xff] ^ \
+            crc_table[1][(buf4[3] >> 16) & 0xff] ^ \
+            crc_table[0][buf4[3] >> 24]; \
+        buf4 += 4
+#define DOLIT64 DOLIT16; DOLIT16; DOLIT16; DOLIT16
 
 /* ========================================================================= */
 local unsigned long crc32_little(crc, buf, len)
@@ -275,10 +356,21 @@ local unsigned long crc32_little(crc, buf, len)
     }
 
     buf4 = (const u4 FAR *)(const void FAR *)buf;
+#ifdef BYSIXTEEN
+    while (len >= 64) {
+        DOLIT64;
+        len -= 64;
+    }
+    while (len >= 16) {
+        DOLIT16;
+        len -= 16;
+    }
+#else /* !BYSIXTEEN */
     while (len >= 32) {
         DOLIT32;
         len -= 32;
     }
+#endif /* BYSIXTEEN */
     while (len >= 4) {
         DOLIT4;
         len -= 4;
@@ -336,88 +428,188 @@ local unsigned long crc32_big(crc, buf, len)
 
 #endif /* BYFOUR */
 
-#define GF2_DIM 32      /* dimension of GF(2) vectors (length of CRC) */
+#ifdef PCLMUL
 
 /* ========================================================================= */
-local unsigned long gf2_matrix_times(mat, vec)
-    unsigned long *mat;
-    unsigned long vec;
+local void crc32_cpu_init()
+{
+    __builtin_cpu_init();
+    have_pclmul = __builtin_cpu_supports("pclmul") &&
+                  __builtin_cpu_supports("sse4.1");
+}
+
+/* Fold a 128-bit lane forward over 128 bits (or 512 with the other k),
+   the low and high halves each multiplied by their own x^n mod p */
+#define FOLD(x, k) _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00), \
+                                 _mm_clmulepi64_si128(x, k, 0x11))
+
+/* =========================================================================
+ * CRC a multiple of sixteen bytes, at least sixty-four, in four 128-bit lanes
+ * that are folded forward by 512 bits for each 64 bytes, then into one lane,
+ * which is reduced to 32 bits by a Barrett reduction.  The constants are the
+ * bit-reflected x^n mod p for the folds, and mu and p for the reduction.
+ * Any bytes after the last multiple of sixteen are done by crc32_little().
+ */
+__attribute__((target("pclmul,sse4.1")))
+local unsigned long crc32_pclmul(crc, buf, len)
+    unsigned long crc;
+    const unsigned char FAR *buf;
+    unsigned len;
 {
-    unsigned long sum;
-
-    sum = 0;
-    while (vec) {
-        if (vec & 1)
-            sum ^= *mat;
-        vec >>= 1;
-        mat++;
+    unsigned n;
+    __m128i x0, x1, x2, x3, k, t;
+    const __m128i mask32 = _mm_setr_epi32(-1, 0, 0, 0);
+
+    x0 = _mm_loadu_si128((const __m128i *)buf);
+    x1 = _mm_loadu_si128((const __m128i *)(buf + 16));
+    x2 = _mm_loadu_si128((const __m128i *)(buf + 32));
+    x3 = _mm_loadu_si128((const __m128i *)(buf + 48));
+    x0 = _mm_xor_si128(x0, _mm_cvtsi32_si128((int)(u4)~crc));
+    n = (len & ~15U) - 64;
+    buf += 64;
+
+    /* fold 64 bytes at a time, k = x^(512+32) and x^(512-32) mod p */
+    k = _mm_set_epi64x(0x1c6e41596LL, 0x154442bd4LL);
+    while (n >= 64) {
+        x0 = _mm_xor_si128(FOLD(x0, k), _mm_loadu_si128((const __m128i *)buf));
+        x1 = _mm_xor_si128(FOLD(x1, k),
+                           _mm_loadu_si128((const __m128i *)(buf + 16)));
+        x2 = _mm_xor_si128(FOLD(x2, k),
+                           _mm_loadu_si128((const __m128i *)(buf + 32)));
+        x3 = _mm_xor_si128(FOLD(x3, k),
+                           _mm_loadu_si128((const __m128i *)(buf + 48)));
+        buf += 64;
+        n -= 64;
+    }
+
+    /* fold the four lanes into one, then the rest 16 bytes at a time */
+    k = _mm_set_epi64x(0x0ccaa009eLL, 0x1751997d0LL);
+    x0 = _mm_xor_si128(FOLD(x0, k), x1);
+    x0 = _mm_xor_si128(FOLD(x0, k), x2);
+    x0 = _mm_xor_si128(FOLD(x0, k), x3);
+    while (n >= 16) {
+        x0 = _mm_xor_si128(FOLD(x0, k), _mm_loadu_si128((const __m128i *)buf));
+        buf += 16;
+        n -= 16;
     }
-    return sum;
+
+    /* fold 128 bits to 64, appending the 32 zeros of the crc */
+    t = _mm_clmulepi64_si128(k, x0, 0x01);
+    x0 = _mm_xor_si128(_mm_srli_si128(x0, 8), t);
+    t = _mm_srli_si128(x0, 4);
+    x0 = _mm_and_si128(x0, mask32);
+    x0 = _mm_clmulepi64_si128(x0, _mm_cvtsi64_si128(0x163cd6124LL), 0x00);
+    x0 = _mm_xor_si128(x0, t);
+
+    /* Barrett reduction from 64 bits to 32 */
+    k = _mm_set_epi64x(0x1f7011641LL, 0x1db710641LL);
+    t = x0;
+    x0 = _mm_and_si128(x0, mask32);
+    x0 = _mm_clmulepi64_si128(x0, k, 0x10);
+    x0 = _mm_and_si128(x0, mask32);
+    x0 = _mm_clmulepi64_si128(x0, k, 0x00);
+    x0 = _mm_xor_si128(x0, t);
+    crc = (unsigned long)(u4)~_mm_extract_epi32(x0, 1);
+
+    return crc32_little(crc, buf, len & 15);
 }
 
-/* ========================================================================= */
-local void gf2_matrix_square(square, mat)
-    unsigned long *square;
-    unsigned long *mat;
+#endif /* PCLMUL */
+
+#define POLY 0xedb88320UL     /* p(x) reflected, with x^32 implied */
+
+/* =========================================================================
+ * Return a(x) multiplied by b(x) modulo p(x), where p(x) is the CRC
+ * polynomial, reflected.  For speed, this requires that a not be zero.
+ */
+local unsigned long multmodp(a, b)
+    unsigned long a;
+    unsigned long b;
 {
-    int n;
+    unsigned long m, p;
+
+    m = 1UL << 31;
+    p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ POLY : b >> 1;
+    }
+    return p;
+}
 
-    for (n = 0; n < GF2_DIM; n++)
-        square[n] = gf2_matrix_times(mat, mat[n]);
+/* =========================================================================
+ * Return x^(n * 2^k) modulo p(x), from the powers in x2n_table[].
+ */
+local unsigned long x2nmodp(n, k)
+    z_off_t n;
+    unsigned k;
+{
+    unsigned long p;
+
+    p = 1UL << 31;              /* x^0 == 1 */
+    while (n) {
+        if (n & 1)
+            p = multmodp(x2n_table[k & 31], p);
+        n >>= 1;
+        k++;
+    }
+    return p;
 }
 
-/* ========================================================================= */
+/* =========================================================================
+ * Appending len2 bytes to the first sequence multiplies its crc by x^(8*len2)
+ * modulo p(x).  That costs one multiplication per bit set in len2, instead
+ * of the matrix squarings this used to take.
+ */
 uLong ZEXPORT crc32_combine(crc1, crc2, len2)
     uLong crc1;
     uLong crc2;
     z_off_t len2;
 {
-    int n;
-    unsigned long row;
-    unsigned long even[GF2_DIM];    /* even-power-of-two zeros operator */
-    unsigned long odd[GF2_DIM];     /* odd-power-of-two zeros operator */
-
     /* degenerate case */
     if (len2 == 0)
         return crc1;
 
-    /* put operator for one zero bit in odd */
-    odd[0] = 0xedb88320L;           /* CRC-32 polynomial */
-    row = 1;
-    for (n = 1; n < GF2_DIM; n++) {
-        odd[n] = row;
-        row <<= 1;
-    }
+#ifdef DYNAMIC_CRC_TABLE
+    if (crc_table_empty)
+        make_crc_table();
+#endif /* DYNAMIC_CRC_TABLE */
+    return multmodp(x2nmodp(len2, 3), crc1 & 0xffffffffUL) ^ crc2;
+}
 
-    /* put operator for two zero bits in even */
-    gf2_matrix_square(even, odd);
-
-    /* put operator for four zero bits in odd */
-    gf2_matrix_square(odd, even);
-
-    /* apply len2 zeros to crc1 (first square will put the operator for one
-       zero byte, eight zero bits, in even) */
-    do {
-        /* apply zeros operator for this bit of len2 */
-        gf2_matrix_square(even, odd);
-        if (len2 & 1)
-            crc1 = gf2_matrix_times(even, crc1);
-        len2 >>= 1;
-
-        /* if no more bits set, then done */
-        if (len2 == 0)
-            break;
-
-        /* another iteration of the loop with odd and even swapped */
-        gf2_matrix_square(odd, even);
-        if (len2 & 1)
-            crc1 = gf2_matrix_times(odd, crc1);
-        len2 >>= 1;
-
-        /* if no more bits set, then done */
-    } while (len2 != 0);
-
-    /* return combined crc */
-    crc1 ^= crc2;
-    return crc1;
+/* =========================================================================
+ * Combine n crcs of consecutive pieces, of lengths lens[], onto crc, the
+ * crc of what precedes them.  Pieces of the same length as the one before
+ * reuse its operator, so splitting a stream into equal chunks costs one
+ * multiplication per chunk.
+ */
+uLong ZEXPORT crc32_combine_multi(crc, crcs, lens, n)
+    uLong crc;
+    const uLongf *crcs;
+    const z_off_t FAR *lens;
+    unsigned n;
+{
+    unsigned long op = 0;
+    z_off_t last = 0;
+
+#ifdef DYNAMIC_CRC_TABLE
+    if (crc_table_empty)
+        make_crc_table();
+#endif /* DYNAMIC_CRC_TABLE */
+    crc &= 0xffffffffUL;
+    for (; n; n--, crcs++, lens++) {
+        if (*lens == 0)
+            continue;
+        if (*lens != last) {
+            last = *lens;
+            op = x2nmodp(last, 3);
+        }
+        crc = multmodp(op, crc) ^ *crcs;
+    }
+    return crc;
 }
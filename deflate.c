@@ -51,6 +51,17 @@
 
 #include "deflate.h"
 
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#  include <arm_neon.h>
+#endif
+
+#if !defined(NO_DEFLATE_POOL) && (defined(__unix__) || defined(__APPLE__))
+#  define DEFLATE_POOL
+#  include <pthread.h>
+#endif
+
 const char deflate_copyright[] =
    " deflate 1.2.3 Copyright 1995-2005 Jean-loup Gailly ";
 /*
@@ -76,10 +87,22 @@ typedef block_state (*compress_func) OF((deflate_state *s, int flush));
 local void fill_window    OF((deflate_state *s));
 local block_state deflate_stored OF((deflate_state *s, int flush));
 local block_state deflate_fast   OF((deflate_state *s, int flush));
+local block_state deflate_quick  OF((deflate_state *s, int flush));
 #ifndef FASTEST
 local block_state deflate_slow   OF((deflate_state *s, int flush));
 #endif
+local block_state deflate_rle    OF((deflate_state *s, int flush));
+local block_state deflate_huff   OF((deflate_state *s, int flush));
+local void slide_hash     OF((deflate_state *s));
+local void slide_table    OF((Posf *table, unsigned n, uInt wsize));
 local void lm_init        OF((deflate_state *s));
+local void lm_restart     OF((deflate_state *s));
+#ifdef DEFLATE_POOL
+local void pool_key_make  OF((void));
+local void pool_free_list OF((void *list));
+local int  pool_attach    OF((deflate_state *s));
+local void pool_detach    OF((deflate_state *s));
+#endif
 local void putShortMSB    OF((deflate_state *s, uInt b));
 local void flush_pending  OF((z_streamp strm));
 local int read_buf        OF((z_streamp strm, Bytef *buf, unsigned size));
@@ -93,6 +116,38 @@ local uInt longest_match  OF((deflate_state *s, IPos cur_match));
 #endif
 local uInt longest_match_fast OF((deflate_state *s, IPos cur_match));
 
+/* Compare a word (or a vector) at a time when matching strings, on
+ * compilers that can tell where the first difference is. This replaces
+ * the byte at a time comparison; builds that define UNALIGNED_OK keep
+ * their own code instead.
+ */
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && !defined(UNALIGNED_OK) && \
+    !defined(NO_COMPARE256)
+#  if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#    define COMPARE256
+#  endif
+#endif
+#if defined(COMPARE256) && (defined(__x86_64__) || defined(__i386__))
+#  define COMPARE256_X86
+#  include <immintrin.h>
+#endif
+
+#ifdef COMPARE256
+typedef unsigned (*compare_func) OF((const Bytef *a, const Bytef *b));
+local unsigned compare256_word  OF((const Bytef *a, const Bytef *b));
+#ifdef COMPARE256_X86
+local unsigned compare256_sse2  OF((const Bytef *a, const Bytef *b));
+local unsigned compare256_avx2  OF((const Bytef *a, const Bytef *b));
+#endif
+local void compare256_init OF((void)) __attribute__((constructor));
+
+/* Number of equal leading bytes in a[0..255] and b[0..255], using the
+ * fastest version this processor supports. It is selected when the library
+ * is loaded, before any thread can be compressing.
+ */
+local compare_func compare256 = compare256_word;
+#endif
+
 #ifdef DEBUG
 local  void check_match OF((deflate_state *s, IPos start, IPos match,
                             int length));
@@ -154,6 +209,22 @@ local const config configuration_table[10] = {
  * meaning.
  */
 
+/* The compression function for the given level and strategy. Z_HUFFMAN_ONLY,
+ * Z_RLE and Z_QUICK have their own at every level but 0.
+ */
+#define COMPRESS_FUNC(level, strategy) \
+   ((level) == 0 ? deflate_stored : \
+    (strategy) == Z_HUFFMAN_ONLY ? deflate_huff : \
+    (strategy) == Z_RLE ? deflate_rle : \
+    (strategy) == Z_QUICK ? deflate_quick : \
+    configuration_table[level].func)
+
+/* True if the strategy does not use the hash table, which then need not be
+ * slid, and must be cleared before another strategy uses it.
+ */
+#define NO_HASH(strategy) \
+   ((strategy) == Z_HUFFMAN_ONLY || (strategy) == Z_RLE)
+
 #define EQUAL 0
 /* result of memcmp for equal strings */
 
@@ -169,6 +240,56 @@ struct static_tree_desc_s {int dummy;}; /* for buggy compilers */
  */
 #define UPDATE_HASH(s,h,c) (h = (((h)<<s->hash_shift) ^ (c)) & s->hash_mask)
 
+/* ===========================================================================
+ * Hash the four bytes at p, for the methods other than Z_HASH_DEFAULT.
+ * The bytes are taken little-endian so that the compressed data is the same
+ * on every machine. The multiplier is Knuth's, 2^32 divided by the golden
+ * ratio; the top bits of the product depend on all four bytes.
+ */
+#ifdef COMPARE256
+/* Little-endian with unaligned loads, see above: one load does */
+local ulg load32 OF((const Bytef *p));
+
+local ulg load32(p)
+    const Bytef *p;
+{
+    unsigned v;
+
+    zmemcpy(&v, p, sizeof(v));
+    return (ulg)v;
+}
+#  define LOAD32(p) load32(p)
+#else
+#  define LOAD32(p) ((ulg)(p)[0] | ((ulg)(p)[1] << 8) | \
+                     ((ulg)(p)[2] << 16) | ((ulg)(p)[3] << 24))
+#endif
+#define MULTIPLY_HASH(s,p) \
+   ((uInt)(((LOAD32(p) * 2654435761UL) & 0xffffffffUL) >> (32 - s->hash_bits)))
+
+#if defined(__SSE4_2__)
+#  include <nmmintrin.h>
+#  define CRC32C_HASH(s,p) \
+     ((uInt)_mm_crc32_u32(0, (unsigned)LOAD32(p)) & s->hash_mask)
+#elif defined(__ARM_FEATURE_CRC32)
+#  include <arm_acle.h>
+#  define CRC32C_HASH(s,p) \
+     ((uInt)__crc32cw(0, (unsigned)LOAD32(p)) & s->hash_mask)
+#else
+#  define CRC32C_HASH(s,p) MULTIPLY_HASH(s,p)
+#endif
+
+/* ===========================================================================
+ * Set ins_h to the hash of the string str with the stream's hash method.
+ * For the rolling hash this is an update with the last byte of the string,
+ * so the same assertion as for UPDATE_HASH holds.
+ */
+#define STRING_HASH(s, str) \
+   (s->hash_method == Z_HASH_DEFAULT ? \
+      UPDATE_HASH(s, s->ins_h, s->window[(str) + (MIN_MATCH-1)]) : \
+    s->hash_method == Z_HASH_MULTIPLY ? \
+      (s->ins_h = MULTIPLY_HASH(s, s->window + (str))) : \
+      (s->ins_h = CRC32C_HASH(s, s->window + (str))))
+
 
 /* ===========================================================================
  * Insert string str in the dictionary and set match_head to the previous head
@@ -182,16 +303,25 @@ struct static_tree_desc_s {int dummy;}; /* for buggy compilers */
  */
 #ifdef FASTEST
 #define INSERT_STRING(s, str, match_head) \
-   (UPDATE_HASH(s, s->ins_h, s->window[(str) + (MIN_MATCH-1)]), \
+   (STRING_HASH(s, str), \
     match_head = s->head[s->ins_h], \
     s->head[s->ins_h] = (Pos)(str))
 #else
 #define INSERT_STRING(s, str, match_head) \
-   (UPDATE_HASH(s, s->ins_h, s->window[(str) + (MIN_MATCH-1)]), \
+   (STRING_HASH(s, str), \
     match_head = s->prev[(str) & s->w_mask] = s->head[s->ins_h], \
     s->head[s->ins_h] = (Pos)(str))
 #endif
 
+/* ===========================================================================
+ * Insert string str for Z_QUICK, which hashes four bytes and keeps no chains.
+ * match_head is set to the previous string with the same hash.
+ */
+#define QUICK_INSERT(s, str, match_head) \
+   (s->ins_h = MULTIPLY_HASH(s, s->window + (str)), \
+    match_head = s->head[s->ins_h], \
+    s->head[s->ins_h] = (Pos)(str))
+
 /* ===========================================================================
  * Initialize the hash table (avoiding 64K overflow for 16 bit systems).
  * prev[] will be initialized on the fly.
@@ -264,7 +394,7 @@ int ZEXPORT deflateInit2_(strm, level, method, windowBits, memLevel, strategy,
 #endif
     if (memLevel < 1 || memLevel > MAX_MEM_LEVEL || method != Z_DEFLATED ||
         windowBits < 8 || windowBits > 15 || level < 0 || level > 9 ||
-        strategy < 0 || strategy > Z_FIXED) {
+        strategy < 0 || strategy > Z_QUICK) {
         return Z_STREAM_ERROR;
     }
     if (windowBits == 8) windowBits = 9;  /* until 256-byte window bug fixed */
@@ -283,6 +413,7 @@ int ZEXPORT deflateInit2_(strm, level, method, windowBits, memLevel, strategy,
     s->hash_size = 1 << s->hash_bits;
     s->hash_mask = s->hash_size - 1;
     s->hash_shift =  ((s->hash_bits+MIN_MATCH-1)/MIN_MATCH);
+    s->hash_method = Z_HASH_DEFAULT;
 
     s->window = (Bytef *) ZALLOC(strm, s->w_size, 2*sizeof(Byte));
     s->prev   = (Posf *)  ZALLOC(strm, s->w_size, sizeof(Pos));
@@ -293,6 +424,10 @@ int ZEXPORT deflateInit2_(strm, level, method, windowBits, memLevel, strategy,
     overlay = (ushf *) ZALLOC(strm, s->lit_bufsize, sizeof(ush)+2);
     s->pending_buf = (uchf *) overlay;
     s->pending_buf_size = (ulg)s->lit_bufsize * (sizeof(ush)+2L);
+    s->pending_stage = s->pending_buf;
+    s->direct_room = s->pending_buf_size;
+    s->pooled = 0;
+    s->pool_set = Z_NULL;
 
     if (s->window == Z_NULL || s->prev == Z_NULL || s->head == Z_NULL ||
         s->pending_buf == Z_NULL) {
@@ -323,7 +458,7 @@ int ZEXPORT deflateSetDictionary (strm, dictionary, dictLength)
     IPos hash_head = 0;
 
     if (strm == Z_NULL || strm->state == Z_NULL || dictionary == Z_NULL ||
-        strm->state->wrap == 2 ||
+        strm->state->wrap == 2 || strm->state->pooled ||
         (strm->state->wrap == 1 && strm->state->status != INIT_STATE))
         return Z_STREAM_ERROR;
 
@@ -340,6 +475,13 @@ int ZEXPORT deflateSetDictionary (strm, dictionary, dictLength)
     s->strstart = length;
     s->block_start = (long)length;
 
+    if (s->strategy == Z_QUICK) {
+        for (n = 0; n + MIN_MATCH < length; n++) {
+            QUICK_INSERT(s, n, hash_head);
+        }
+        return Z_OK;
+    }
+
     /* Insert all strings in the hash table (except for the last two bytes).
      * s->lookahead stays null, so s->ins_h will be recomputed at the next
      * call of fill_window.
@@ -369,6 +511,9 @@ int ZEXPORT deflateReset (strm)
     strm->data_type = Z_UNKNOWN;
 
     s = (deflate_state *)strm->state;
+#ifdef DEFLATE_POOL
+    pool_detach(s);
+#endif
     s->pending = 0;
     s->pending_out = s->pending_buf;
 
@@ -382,6 +527,7 @@ int ZEXPORT deflateReset (strm)
 #endif
         adler32(0L, Z_NULL, 0);
     s->last_flush = Z_NO_FLUSH;
+    s->quick_open = 0;
 
     _tr_init(s);
     lm_init(s);
@@ -408,7 +554,7 @@ int ZEXPORT deflatePrime (strm, bits, value)
 {
     if (strm == Z_NULL || strm->state == Z_NULL) return Z_STREAM_ERROR;
     strm->state->bi_valid = bits;
-    strm->state->bi_buf = (ush)(value & ((1 << bits) - 1));
+    strm->state->bi_buf = (bitbuf)(value & ((1 << bits) - 1));
     return Z_OK;
 }
 
@@ -430,14 +576,24 @@ int ZEXPORT deflateParams(strm, level, strategy)
 #else
     if (level == Z_DEFAULT_COMPRESSION) level = 6;
 #endif
-    if (level < 0 || level > 9 || strategy < 0 || strategy > Z_FIXED) {
+    if (level < 0 || level > 9 || strategy < 0 || strategy > Z_QUICK) {
         return Z_STREAM_ERROR;
     }
-    func = configuration_table[s->level].func;
+    func = COMPRESS_FUNC(s->level, s->strategy);
 
-    if (func != configuration_table[level].func && strm->total_in != 0) {
+    if (func != COMPRESS_FUNC(level, strategy) && strm->total_in != 0) {
         /* Flush the last buffer: */
         err = deflate(strm, Z_PARTIAL_FLUSH);
+        /* a block of deflate_quick() left open for want of output room
+         * cannot be continued by another function */
+        if (s->quick_open) return Z_BUF_ERROR;
+    }
+    if ((s->strategy == Z_QUICK || NO_HASH(s->strategy)) &&
+        strategy != s->strategy && s->head != Z_NULL) {
+        /* Z_QUICK hashes differently and does not link prev[], and
+         * Z_HUFFMAN_ONLY and Z_RLE do not maintain the hash table at all
+         */
+        CLEAR_HASH(s);
     }
     if (s->level != level) {
         s->level = level;
@@ -469,6 +625,59 @@ int ZEXPORT deflateTune(strm, good_length, max_lazy, nice_length, max_chain)
     return Z_OK;
 }
 
+/* ========================================================================= */
+int ZEXPORT deflateHash(strm, method)
+    z_streamp strm;
+    int method;
+{
+    deflate_state *s;
+
+    if (strm == Z_NULL || strm->state == Z_NULL) return Z_STREAM_ERROR;
+    s = strm->state;
+    if (method < Z_HASH_DEFAULT || method > Z_HASH_CRC32C ||
+        s->strstart != 0 || s->lookahead != 0) return Z_STREAM_ERROR;
+
+    /* The four byte hashes look one byte past the last MIN_MATCH bytes of
+     * the input. Clear the window so that those bytes, and therefore the
+     * compressed data, do not depend on uninitialized memory.
+     */
+    if (method != Z_HASH_DEFAULT && s->hash_method == Z_HASH_DEFAULT &&
+        s->window != Z_NULL)
+        zmemzero(s->window, (unsigned)s->window_size);
+    s->hash_method = method;
+    return Z_OK;
+}
+
+/* ========================================================================= */
+int ZEXPORT deflatePooled(strm)
+    z_streamp strm;
+{
+    deflate_state *s;
+
+    if (strm == Z_NULL || strm->state == Z_NULL) return Z_STREAM_ERROR;
+    s = strm->state;
+#ifdef DEFLATE_POOL
+    if (s->pooled) return Z_OK;
+    if (s->strstart != 0 || s->lookahead != 0 || s->pending != 0)
+        return Z_STREAM_ERROR;
+
+    /* Deallocate in reverse order of allocations: */
+    TRY_FREE(strm, s->pending_buf);
+    TRY_FREE(strm, s->head);
+    TRY_FREE(strm, s->prev);
+    TRY_FREE(strm, s->window);
+    s->window = Z_NULL;
+    s->prev = s->head = Z_NULL;
+    s->pending_buf = s->pending_stage = s->pending_out = Z_NULL;
+    s->d_buf = Z_NULL;
+    s->l_buf = Z_NULL;
+    s->pooled = 1;
+    return Z_OK;
+#else
+    return Z_STREAM_ERROR;
+#endif
+}
+
 /* =========================================================================
  * For the default windowBits of 15 and memLevel of 8, this function returns
  * a close to exact, as well as small, upper bound on the compressed size.
@@ -501,9 +710,10 @@ uLong ZEXPORT deflateBound(strm, sourceLen)
     if (strm == Z_NULL || strm->state == Z_NULL)
         return destLen;
 
-    /* if not default parameters, return conservative bound */
+    /* if not default parameters, return conservative bound; Z_QUICK never
+     * falls back to stored blocks and needs it too */
     s = strm->state;
-    if (s->w_bits != 15 || s->hash_bits != 8 + 7)
+    if (s->w_bits != 15 || s->hash_bits != 8 + 7 || s->strategy == Z_QUICK)
         return destLen;
 
     /* default settings: return tight bound for that case */
@@ -528,23 +738,38 @@ local void putShortMSB (s, b)
  * through this function so some applications may wish to modify it
  * to avoid allocating a large strm->next_out buffer and copying into it.
  * (See also read_buf()).
+ *
+ * While strm->avail_out is at least direct_room, deflate() points pending_buf
+ * at next_out so that the blocks are written in place. Then there is nothing
+ * to copy, pending_buf just moves along with next_out, and it goes back to
+ * pending_stage once the room left is too small for another block.
  */
 local void flush_pending(strm)
     z_streamp strm;
 {
-    unsigned len = strm->state->pending;
+    deflate_state *s = strm->state;
+    unsigned len = s->pending;
 
     if (len > strm->avail_out) len = strm->avail_out;
     if (len == 0) return;
 
-    zmemcpy(strm->next_out, strm->state->pending_out, len);
+    if (s->pending_buf != s->pending_stage) {
+        Assert(len == s->pending, "direct output overflow");
+        s->pending_buf += len;
+    }
+    else
+        zmemcpy(strm->next_out, s->pending_out, len);
     strm->next_out  += len;
-    strm->state->pending_out  += len;
+    s->pending_out  += len;
     strm->total_out += len;
     strm->avail_out  -= len;
-    strm->state->pending -= len;
-    if (strm->state->pending == 0) {
-        strm->state->pending_out = strm->state->pending_buf;
+    s->pending -= len;
+    if (s->pending_buf != s->pending_stage &&
+        (ulg)strm->avail_out < s->direct_room) {
+        s->pending_buf = s->pending_stage;
+    }
+    if (s->pending == 0) {
+        s->pending_out = s->pending_buf;
     }
 }
 
@@ -569,6 +794,19 @@ int ZEXPORT deflate (strm, flush)
     }
     if (strm->avail_out == 0) ERR_RETURN(strm, Z_BUF_ERROR);
 
+#ifdef DEFLATE_POOL
+    /* A pooled stream starts each message with tables from the pool. They
+     * are taken here if there is a header to write, else only below, once
+     * there is a block to compress, so that a call with nothing to do does
+     * not hold on to them.
+     */
+    if (s->pooled && s->pool_set == Z_NULL &&
+        s->status != BUSY_STATE && s->status != FINISH_STATE) {
+        if (pool_attach(s) != Z_OK) ERR_RETURN(strm, Z_MEM_ERROR);
+        lm_restart(s);
+    }
+#endif
+
     s->strm = strm; /* just in case */
     old_flush = s->last_flush;
     s->last_flush = flush;
@@ -787,7 +1025,25 @@ int ZEXPORT deflate (strm, flush)
         (flush != Z_NO_FLUSH && s->status != FINISH_STATE)) {
         block_state bstate;
 
-        bstate = (*(configuration_table[s->level].func))(s, flush);
+#ifdef DEFLATE_POOL
+        if (s->pooled && s->pool_set == Z_NULL) {
+            if (pool_attach(s) != Z_OK) {
+                s->last_flush = old_flush;
+                ERR_RETURN(strm, Z_MEM_ERROR);
+            }
+            lm_restart(s);
+        }
+#endif
+        /* With room for a whole block, write the blocks in place */
+        if (s->pending == 0 && (ulg)strm->avail_out >= s->direct_room)
+            s->pending_buf = s->pending_out = strm->next_out;
+
+        bstate = (*(COMPRESS_FUNC(s->level, s->strategy)))(s, flush);
+
+        if (s->pending_buf != s->pending_stage) {
+            Assert(s->pending == 0, "direct output left pending");
+            s->pending_buf = s->pending_out = s->pending_stage;
+        }
 
         if (bstate == finish_started || bstate == finish_done) {
             s->status = FINISH_STATE;
@@ -815,6 +1071,12 @@ int ZEXPORT deflate (strm, flush)
                  */
                 if (flush == Z_FULL_FLUSH) {
                     CLEAR_HASH(s);             /* forget history */
+                    if (s->lookahead == 0) {
+                        /* deflate_rle() looks back one byte without the
+                         * hash, so also move the window start to here */
+                        s->strstart = 0;
+                        s->block_start = 0L;
+                    }
                 }
             }
             flush_pending(strm);
@@ -826,6 +1088,14 @@ int ZEXPORT deflate (strm, flush)
     }
     Assert(strm->avail_out > 0, "bug2");
 
+#ifdef DEFLATE_POOL
+    /* Here a sync, full or finish flush is complete with nothing left in
+     * the window or the pending buffer, which is the end of a message for a
+     * pooled stream. It gives back its tables, and with them its history.
+     */
+    if (flush >= Z_SYNC_FLUSH && (flush != Z_FINISH || s->wrap <= 0))
+        pool_detach(s);
+#endif
     if (flush != Z_FINISH) return Z_OK;
     if (s->wrap <= 0) return Z_STREAM_END;
 
@@ -852,6 +1122,10 @@ int ZEXPORT deflate (strm, flush)
      * to flush the rest.
      */
     if (s->wrap > 0) s->wrap = -s->wrap; /* write the trailer only once! */
+#ifdef DEFLATE_POOL
+    if (s->pending == 0)
+        pool_detach(s);
+#endif
     return s->pending != 0 ? Z_OK : Z_STREAM_END;
 }
 
@@ -874,6 +1148,9 @@ int ZEXPORT deflateEnd (strm)
       return Z_STREAM_ERROR;
     }
 
+#ifdef DEFLATE_POOL
+    pool_detach(strm->state);
+#endif
     /* Deallocate in reverse order of allocations: */
     TRY_FREE(strm, strm->state->pending_buf);
     TRY_FREE(strm, strm->state->head);
@@ -917,16 +1194,33 @@ int ZEXPORT deflateCopy (dest, source)
     zmemcpy(ds, ss, sizeof(deflate_state));
     ds->strm = dest;
 
-    ds->window = (Bytef *) ZALLOC(dest, ds->w_size, 2*sizeof(Byte));
-    ds->prev   = (Posf *)  ZALLOC(dest, ds->w_size, sizeof(Pos));
-    ds->head   = (Posf *)  ZALLOC(dest, ds->hash_size, sizeof(Pos));
-    overlay = (ushf *) ZALLOC(dest, ds->lit_bufsize, sizeof(ush)+2);
-    ds->pending_buf = (uchf *) overlay;
-
-    if (ds->window == Z_NULL || ds->prev == Z_NULL || ds->head == Z_NULL ||
-        ds->pending_buf == Z_NULL) {
-        deflateEnd (dest);
-        return Z_MEM_ERROR;
+#ifdef DEFLATE_POOL
+    if (ss->pooled) {
+        /* between messages there is nothing to copy, else borrow tables */
+        ds->pool_set = Z_NULL;
+        if (ss->pool_set == Z_NULL) return Z_OK;
+        if (pool_attach(ds) != Z_OK) {
+            ZFREE(dest, ds);
+            dest->state = Z_NULL;
+            return Z_MEM_ERROR;
+        }
+        overlay = (ushf *)ds->pending_buf;
+    }
+    else
+#endif
+    {
+        ds->window = (Bytef *) ZALLOC(dest, ds->w_size, 2*sizeof(Byte));
+        ds->prev   = (Posf *)  ZALLOC(dest, ds->w_size, sizeof(Pos));
+        ds->head   = (Posf *)  ZALLOC(dest, ds->hash_size, sizeof(Pos));
+        overlay = (ushf *) ZALLOC(dest, ds->lit_bufsize, sizeof(ush)+2);
+        ds->pending_buf = (uchf *) overlay;
+        ds->pending_stage = ds->pending_buf;
+
+        if (ds->window == Z_NULL || ds->prev == Z_NULL ||
+            ds->head == Z_NULL || ds->pending_buf == Z_NULL) {
+            deflateEnd (dest);
+            return Z_MEM_ERROR;
+        }
     }
     /* following zmemcpy do not work for 16-bit MSDOS */
     zmemcpy(ds->window, ss->window, ds->w_size * 2 * sizeof(Byte));
@@ -988,8 +1282,6 @@ local void lm_init (s)
 {
     s->window_size = (ulg)2L*s->w_size;
 
-    CLEAR_HASH(s);
-
     /* Set the default configuration parameters:
      */
     s->max_lazy_match   = configuration_table[s->level].max_lazy;
@@ -997,18 +1289,233 @@ local void lm_init (s)
     s->nice_match       = configuration_table[s->level].nice_length;
     s->max_chain_length = configuration_table[s->level].max_chain;
 
+    /* a pooled stream between messages has no tables, see deflate() */
+    if (s->head != Z_NULL)
+        lm_restart(s);
+#ifndef FASTEST
+#ifdef ASMV
+    match_init(); /* initialize the asm code */
+#endif
+#endif
+}
+
+/* ===========================================================================
+ * Forget the history: empty the window and the hash table.
+ */
+local void lm_restart (s)
+    deflate_state *s;
+{
+    CLEAR_HASH(s);
+
     s->strstart = 0;
     s->block_start = 0L;
     s->lookahead = 0;
     s->match_length = s->prev_length = MIN_MATCH-1;
     s->match_available = 0;
     s->ins_h = 0;
-#ifndef FASTEST
-#ifdef ASMV
-    match_init(); /* initialize the asm code */
-#endif
+}
+
+#ifdef DEFLATE_POOL
+/* ===========================================================================
+ * The pool of a thread is a list of the tables given back by pooled streams,
+ * one allocation each, with this header in front. Up to POOL_MAX are kept,
+ * and they are freed when the thread exits.
+ */
+typedef struct pool_set_s {
+    struct pool_set_s FAR *next;
+    uInt w_bits;                /* window and hash sizes they are for */
+    uInt hash_bits;
+} FAR pool_set;
+
+#define POOL_HEAD 64            /* room for the header, aligns the tables */
+#define POOL_MAX 4
+
+local pthread_key_t pool_key;
+local pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+local void pool_key_make()
+{
+    pthread_key_create(&pool_key, pool_free_list);
+}
+
+local void pool_free_list(list)
+    void *list;
+{
+    pool_set *set = (pool_set *)list, *next;
+
+    while (set != Z_NULL) {
+        next = set->next;
+        zcfree((voidpf)0, (voidpf)set);
+        set = next;
+    }
+}
+
+/* ===========================================================================
+ * Give s a window, hash tables and pending buffer from the pool of this
+ * thread, or newly allocated ones if there are none of its sizes. Their
+ * contents are left as they are.
+ */
+local int pool_attach(s)
+    deflate_state *s;
+{
+    pool_set *set, *prev = Z_NULL;
+    Bytef *mem;
+
+    pthread_once(&pool_once, pool_key_make);
+    set = (pool_set *)pthread_getspecific(pool_key);
+    while (set != Z_NULL &&
+           (set->w_bits != s->w_bits || set->hash_bits != s->hash_bits)) {
+        prev = set;
+        set = set->next;
+    }
+    if (set != Z_NULL) {
+        if (prev != Z_NULL)
+            prev->next = set->next;
+        else
+            pthread_setspecific(pool_key, (void *)set->next);
+    }
+    else {
+        set = (pool_set *)zcalloc((voidpf)0, 1, POOL_HEAD +
+                                  s->w_size * (2*sizeof(Byte) + sizeof(Pos)) +
+                                  s->hash_size * sizeof(Pos) +
+                                  s->lit_bufsize * (sizeof(ush)+2));
+        if (set == Z_NULL) return Z_MEM_ERROR;
+        set->w_bits = s->w_bits;
+        set->hash_bits = s->hash_bits;
+    }
+
+    mem = (Bytef *)set + POOL_HEAD;
+    s->window = mem;
+    mem += s->w_size * 2*sizeof(Byte);
+    s->prev = (Posf *)mem;
+    mem += s->w_size * sizeof(Pos);
+    s->head = (Posf *)mem;
+    mem += s->hash_size * sizeof(Pos);
+    s->pending_buf = s->pending_stage = s->pending_out = mem;
+    s->d_buf = (ushf *)mem + s->lit_bufsize/sizeof(ush);
+    s->l_buf = mem + (1+sizeof(ush))*s->lit_bufsize;
+    s->pool_set = (voidpf)set;
+    return Z_OK;
+}
+
+/* ===========================================================================
+ * Give the tables of s, if it has borrowed any, back to the pool of this
+ * thread.
+ */
+local void pool_detach(s)
+    deflate_state *s;
+{
+    pool_set *set = (pool_set *)s->pool_set, *list;
+    int n = 0;
+
+    if (set == Z_NULL) return;
+    list = (pool_set *)pthread_getspecific(pool_key);
+    for (set->next = list; list != Z_NULL; list = list->next)
+        n++;
+    if (n < POOL_MAX)
+        pthread_setspecific(pool_key, (void *)set);
+    else
+        zcfree((voidpf)0, (voidpf)set);
+
+    s->window = Z_NULL;
+    s->prev = s->head = Z_NULL;
+    s->pending_buf = s->pending_stage = s->pending_out = Z_NULL;
+    s->d_buf = Z_NULL;
+    s->l_buf = Z_NULL;
+    s->pool_set = Z_NULL;
+}
+#endif /* DEFLATE_POOL */
+
+#ifdef COMPARE256
+/* ===========================================================================
+ * Compare 256 bytes, eight at a time. The lowest set bit of the exclusive or
+ * of two little-endian words is in the first byte that differs. The reads
+ * never go past a[255] and b[255], so the window needs no extra guard bytes:
+ * called with scan+2, the last byte read is at strstart+257.
+ */
+local unsigned compare256_word(a, b)
+    const Bytef *a;
+    const Bytef *b;
+{
+    unsigned len = 0;
+    unsigned long x, y;
+
+    do {
+        zmemcpy(&x, a + len, sizeof(x));
+        zmemcpy(&y, b + len, sizeof(y));
+        x ^= y;
+        if (x != 0)
+            return len + ((unsigned)__builtin_ctzl(x) >> 3);
+        len += sizeof(x);
+    } while (len < 256);
+    return 256;
+}
+
+#ifdef COMPARE256_X86
+/* ===========================================================================
+ * Compare 256 bytes sixteen at a time. movemask gives one bit per byte,
+ * set where the bytes are equal.
+ */
+__attribute__((target("sse2")))
+local unsigned compare256_sse2(a, b)
+    const Bytef *a;
+    const Bytef *b;
+{
+    unsigned len = 0;
+    unsigned mask;
+    __m128i x, y;
+
+    do {
+        x = _mm_loadu_si128((const __m128i *)(a + len));
+        y = _mm_loadu_si128((const __m128i *)(b + len));
+        mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y));
+        if (mask != 0xffff)
+            return len + (unsigned)__builtin_ctz(~mask);
+        len += 16;
+    } while (len < 256);
+    return 256;
+}
+
+/* ===========================================================================
+ * Same, thirty-two bytes at a time.
+ */
+__attribute__((target("avx2")))
+local unsigned compare256_avx2(a, b)
+    const Bytef *a;
+    const Bytef *b;
+{
+    unsigned len = 0;
+    unsigned mask;
+    __m256i x, y;
+
+    do {
+        x = _mm256_loadu_si256((const __m256i *)(a + len));
+        y = _mm256_loadu_si256((const __m256i *)(b + len));
+        mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+        if (mask != 0xffffffffU)
+            return len + (unsigned)__builtin_ctz(~mask);
+        len += 32;
+    } while (len < 256);
+    return 256;
+}
+#endif /* COMPARE256_X86 */
+
+/* ===========================================================================
+ * Select the compare function for this processor.
+ */
+local void compare256_init()
+{
+#ifdef COMPARE256_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        compare256 = compare256_avx2;
+    else if (__builtin_cpu_supports("sse2"))
+        compare256 = compare256_sse2;
+    else
 #endif
+        compare256 = compare256_word;
 }
+#endif /* COMPARE256 */
 
 #ifndef FASTEST
 /* ===========================================================================
@@ -1050,7 +1557,9 @@ local uInt longest_match(s, cur_match)
     register ush scan_start = *(ushf*)scan;
     register ush scan_end   = *(ushf*)(scan+best_len-1);
 #else
+#ifndef COMPARE256
     register Bytef *strend = s->window + s->strstart + MAX_MATCH;
+#endif
     register Byte scan_end1  = scan[best_len-1];
     register Byte scan_end   = scan[best_len];
 #endif
@@ -1090,6 +1599,11 @@ local uInt longest_match(s, cur_match)
         if (*(ushf*)(match+best_len-1) != scan_end ||
             *(ushf*)match != scan_start) continue;
 
+        /* The four byte hashes can collide on strings that differ in
+         * their third byte.
+         */
+        if (s->hash_method != Z_HASH_DEFAULT && scan[2] != match[2]) continue;
+
         /* It is not necessary to compare scan[2] and match[2] since they are
          * always equal when the other bytes match, given that the hash keys
          * are equal and that HASH_BITS >= 8. Compare 2 bytes at a time at
@@ -1116,6 +1630,18 @@ local uInt longest_match(s, cur_match)
         len = (MAX_MATCH - 1) - (int)(strend-scan);
         scan = strend - (MAX_MATCH-1);
 
+#elif defined(COMPARE256)
+
+        if (match[best_len]   != scan_end  ||
+            match[best_len-1] != scan_end1 ||
+            match[0]          != scan[0]   ||
+            match[1]          != scan[1])      continue;
+
+        /* Compare from scan[2]: with the rolling hash it is known to equal
+         * match[2], but not with the four byte hashes.
+         */
+        len = 2 + (int)compare256(scan + 2, match + 2);
+
 #else /* UNALIGNED_OK */
 
         if (match[best_len]   != scan_end  ||
@@ -1123,6 +1649,11 @@ local uInt longest_match(s, cur_match)
             *match            != *scan     ||
             *++match          != scan[1])      continue;
 
+        /* The four byte hashes can collide on strings that differ in
+         * their third byte.
+         */
+        if (s->hash_method != Z_HASH_DEFAULT && match[1] != scan[2]) continue;
+
         /* The check at best_len-1 can be removed because it will be made
          * again later. (This heuristic is not always a win.)
          * It is not necessary to compare scan[2] and match[2] since they
@@ -1170,7 +1701,7 @@ local uInt longest_match(s, cur_match)
 #endif /* FASTEST */
 
 /* ---------------------------------------------------------------------------
- * Optimized version for level == 1 or strategy == Z_RLE only
+ * Optimized version for FASTEST and Z_QUICK, which try a single candidate
  */
 local uInt longest_match_fast(s, cur_match)
     deflate_state *s;
@@ -1179,7 +1710,9 @@ local uInt longest_match_fast(s, cur_match)
     register Bytef *scan = s->window + s->strstart; /* current string */
     register Bytef *match;                       /* matched string */
     register int len;                           /* length of current match */
+#ifndef COMPARE256
     register Bytef *strend = s->window + s->strstart + MAX_MATCH;
+#endif
 
     /* The code is optimized for HASH_BITS >= 8 and MAX_MATCH-2 multiple of 16.
      * It is easy to get rid of this optimization if necessary.
@@ -1196,6 +1729,12 @@ local uInt longest_match_fast(s, cur_match)
      */
     if (match[0] != scan[0] || match[1] != scan[1]) return MIN_MATCH-1;
 
+#ifdef COMPARE256
+    len = 2 + (int)compare256(scan + 2, match + 2);
+#else
+    if (s->hash_method != Z_HASH_DEFAULT && match[2] != scan[2])
+        return MIN_MATCH-1;
+
     /* The check at best_len-1 can be removed because it will be made
      * again later. (This heuristic is not always a win.)
      * It is not necessary to compare scan[2] and match[2] since they
@@ -1218,6 +1757,7 @@ local uInt longest_match_fast(s, cur_match)
     Assert(scan <= s->window+(unsigned)(s->window_size-1), "wild scan");
 
     len = MAX_MATCH - (int)(strend - scan);
+#endif
 
     if (len < MIN_MATCH) return MIN_MATCH - 1;
 
@@ -1253,6 +1793,51 @@ local void check_match(s, start, match, length)
 #  define check_match(s, start, match, length)
 #endif /* DEBUG */
 
+/* ===========================================================================
+ * Subtract wsize from the n positions in table, positions that are no longer
+ * in the window becoming NIL. This is a saturating subtraction, done eight
+ * positions at a time with SSE2 or NEON.
+ */
+local void slide_table(table, n, wsize)
+    Posf *table;
+    unsigned n;
+    uInt wsize;
+{
+    unsigned m;
+#if defined(__SSE2__)
+    __m128i w = _mm_set1_epi16((short)wsize);
+
+    for (; n >= 8; n -= 8, table += 8)
+        _mm_storeu_si128((__m128i *)table,
+                         _mm_subs_epu16(_mm_loadu_si128((__m128i *)table), w));
+#elif defined(__ARM_NEON)
+    uint16x8_t w = vdupq_n_u16((uint16_t)wsize);
+
+    for (; n >= 8; n -= 8, table += 8)
+        vst1q_u16(table, vqsubq_u16(vld1q_u16(table), w));
+#endif
+    for (; n != 0; n--, table++) {
+        m = *table;
+        *table = (Pos)(m >= wsize ? m-wsize : NIL);
+    }
+}
+
+/* ===========================================================================
+ * Slide the hash table after the window moved down by w_size bytes.
+ */
+local void slide_hash(s)
+    deflate_state *s;
+{
+    slide_table(s->head, s->hash_size, s->w_size);
+#ifndef FASTEST
+    /* If n is not on any hash chain, prev[n] is garbage but its value will
+     * never be used. Z_QUICK keeps no chains.
+     */
+    if (s->strategy != Z_QUICK)
+        slide_table(s->prev, s->w_size, s->w_size);
+#endif
+}
+
 /* ===========================================================================
  * Fill the window when the lookahead becomes insufficient.
  * Updates strstart and lookahead.
@@ -1266,8 +1851,7 @@ local void check_match(s, start, match, length)
 local void fill_window(s)
     deflate_state *s;
 {
-    register unsigned n, m;
-    register Posf *p;
+    register unsigned n;
     unsigned more;    /* Amount of free space at the end of the window. */
     uInt wsize = s->w_size;
 
@@ -1302,26 +1886,11 @@ local void fill_window(s)
                to keep the hash table consistent if we switch back to level > 0
                later. (Using level 0 permanently is not an optimal usage of
                zlib, so we don't care about this pathological case.)
+               Z_HUFFMAN_ONLY and Z_RLE do not use the table; it is cleared
+               if the strategy changes.
              */
-            /* %%% avoid this when Z_RLE */
-            n = s->hash_size;
-            p = &s->head[n];
-            do {
-                m = *--p;
-                *p = (Pos)(m >= wsize ? m-wsize : NIL);
-            } while (--n);
-
-            n = wsize;
-#ifndef FASTEST
-            p = &s->prev[n];
-            do {
-                m = *--p;
-                *p = (Pos)(m >= wsize ? m-wsize : NIL);
-                /* If n is not on any hash chain, prev[n] is garbage but
-                 * its value will never be used.
-                 */
-            } while (--n);
-#endif
+            if (!NO_HASH(s->strategy))
+                slide_hash(s);
             more += wsize;
         }
         if (s->strm->avail_in == 0) return;
@@ -1482,16 +2051,9 @@ local block_state deflate_fast(s, flush)
              * of the string with itself at the start of the input file).
              */
 #ifdef FASTEST
-            if ((s->strategy != Z_HUFFMAN_ONLY && s->strategy != Z_RLE) ||
-                (s->strategy == Z_RLE && s->strstart - hash_head == 1)) {
-                s->match_length = longest_match_fast (s, hash_head);
-            }
+            s->match_length = longest_match_fast (s, hash_head);
 #else
-            if (s->strategy != Z_HUFFMAN_ONLY && s->strategy != Z_RLE) {
-                s->match_length = longest_match (s, hash_head);
-            } else if (s->strategy == Z_RLE && s->strstart - hash_head == 1) {
-                s->match_length = longest_match_fast (s, hash_head);
-            }
+            s->match_length = longest_match (s, hash_head);
 #endif
             /* longest_match() or longest_match_fast() sets match_start */
         }
@@ -1591,12 +2153,8 @@ local block_state deflate_slow(s, flush)
              * of window index 0 (in particular we have to avoid a match
              * of the string with itself at the start of the input file).
              */
-            if (s->strategy != Z_HUFFMAN_ONLY && s->strategy != Z_RLE) {
-                s->match_length = longest_match (s, hash_head);
-            } else if (s->strategy == Z_RLE && s->strstart - hash_head == 1) {
-                s->match_length = longest_match_fast (s, hash_head);
-            }
-            /* longest_match() or longest_match_fast() sets match_start */
+            s->match_length = longest_match (s, hash_head);
+            /* longest_match() sets match_start */
 
             if (s->match_length <= 5 && (s->strategy == Z_FILTERED
 #if TOO_FAR <= 32767
@@ -1674,7 +2232,174 @@ local block_state deflate_slow(s, flush)
 }
 #endif /* FASTEST */
 
-#if 0
+/* ===========================================================================
+ * Compress as fast as possible, for strategy Z_QUICK. Each string is looked
+ * up once in the hash table, which has no chains, and a match of at least
+ * four bytes, if any, is taken at once. The symbols are sent with the fixed
+ * codes as they are found, so nothing is tallied and no block is ever
+ * weighed: a fixed block is opened when there is input and closed only by a
+ * flush. quick_open tells whether one is open and whether it is the last.
+ *
+ * The bit buffer and the output position are kept in locals: a byte stored
+ * through pending_buf could be any field of s as far as the compiler knows,
+ * so with s->bi_buf every symbol would reload the state.
+ */
+#define QUICK_ROOM 64
+/* Room kept free in pending_buf for a symbol, a block end and a start */
+
+/* send_bits() on the locals bi_buf, bi_valid and out */
+#define quick_put(value, length) { \
+    int len_ = (length); \
+    bitbuf val_ = (bitbuf)(value); \
+    if (bi_valid >= (int)BITBUF_BITS - len_) { \
+        bi_buf |= val_ << bi_valid; \
+        put_word(out, bi_buf); \
+        out += BITBUF_BITS / 8; \
+        bi_buf = val_ >> (BITBUF_BITS - bi_valid); \
+        bi_valid += len_ - BITBUF_BITS; \
+    } else { \
+        bi_buf |= val_ << bi_valid; \
+        bi_valid += len_; \
+    } \
+  }
+
+#ifdef DEBUG
+#  define quick_bits(s, value, length) { \
+    s->compressed_len += (ulg)(length); \
+    s->bits_sent += (ulg)(length); \
+    quick_put(value, length); \
+  }
+#else
+#  define quick_bits(s, value, length) quick_put(value, length)
+#endif
+
+/* Write the locals back to s */
+#define quick_save(s) { \
+    s->bi_buf = bi_buf; \
+    s->bi_valid = bi_valid; \
+    s->pending = (uInt)(out - s->pending_buf); \
+  }
+
+local block_state deflate_quick(s, flush)
+    deflate_state *s;
+    int flush;
+{
+    const ct_data FAR *ltree = _tr_quick.ltree;
+    const ct_data FAR *dtree = _tr_quick.dtree;
+    Bytef *window = s->window;
+    bitbuf bi_buf = s->bi_buf;
+    int bi_valid = s->bi_valid;
+    Bytef *out = s->pending_buf + s->pending;
+    Bytef *end;           /* where the room left is QUICK_ROOM */
+    IPos hash_head;       /* previous string with the same hash */
+    uInt str, left;       /* strstart and lookahead */
+    uInt stop;            /* lookahead to stop at for more input */
+    unsigned len, dist, code;
+    int extra;
+    int last = flush == Z_FINISH;
+
+    for (;;) {
+        if (s->pending > s->pending_buf_size - QUICK_ROOM) {
+            flush_pending(s->strm);
+            if (s->pending != 0) return need_more;
+        }
+
+        /* Make sure that we always have enough lookahead, except
+         * at the end of the input file. We need MAX_MATCH bytes
+         * for the next match.
+         */
+        if (s->lookahead < MIN_LOOKAHEAD) {
+            fill_window(s);
+            if (s->lookahead < MIN_LOOKAHEAD && flush == Z_NO_FLUSH) {
+                flush_pending(s->strm);
+                return need_more;
+            }
+            if (s->lookahead == 0) break; /* close the current block */
+        }
+        stop = s->lookahead < MIN_LOOKAHEAD ? 0 : MIN_LOOKAHEAD - 1;
+
+        out = s->pending_buf + s->pending;
+        end = s->pending_buf + s->pending_buf_size - QUICK_ROOM;
+        if (s->quick_open != 1 + last) {
+            if (s->quick_open) quick_bits(s, ltree[END_BLOCK].Code,
+                                          ltree[END_BLOCK].Len);
+            quick_bits(s, (STATIC_TREES << 1) + last, 3);
+            s->quick_open = 1 + last;
+        }
+
+        str = s->strstart;
+        left = s->lookahead;
+        do {
+            /* The hash covers four bytes, so none is hashed past the
+             * input, and only a match of all four is tried.
+             */
+            len = 0;
+            if (left > MIN_MATCH) {
+                QUICK_INSERT(s, str, hash_head);
+                if (hash_head != NIL && str - hash_head <= MAX_DIST(s) &&
+                    LOAD32(window + hash_head) == LOAD32(window + str)) {
+                    s->strstart = str;
+                    s->lookahead = left;
+                    len = longest_match_fast (s, hash_head);
+                }
+            }
+            if (len > MIN_MATCH) {
+                check_match(s, str, s->match_start, len);
+                dist = str - s->match_start - 1;
+                str += len;
+                left -= len;
+
+                /* the mask is for length 258, which has no extra bits and
+                 * for which base_length[] is 0 */
+                len -= MIN_MATCH;
+                code = _length_code[len];
+                extra = _tr_quick.extra_lbits[code];
+                len = (len - _tr_quick.base_length[code]) & ((1 << extra) - 1);
+                quick_bits(s, ltree[code + LITERALS + 1].Code |
+                           ((ulg)len << ltree[code + LITERALS + 1].Len),
+                           ltree[code + LITERALS + 1].Len + extra);
+                code = d_code(dist);
+                quick_bits(s, dtree[code].Code |
+                           ((ulg)(dist - _tr_quick.base_dist[code]) <<
+                            dtree[code].Len),
+                           dtree[code].Len + _tr_quick.extra_dbits[code]);
+            } else {
+                /* No match, output a literal byte */
+                Tracevv((stderr,"%c", window[str]));
+                code = window[str];
+                quick_bits(s, ltree[code].Code, ltree[code].Len);
+                str++;
+                left--;
+            }
+        } while (left > stop && out <= end);
+        s->strstart = str;
+        s->lookahead = left;
+        quick_save(s);
+    }
+
+    /* All the input is in: close the block, after a last empty one if the
+     * open block is not the last
+     */
+    out = s->pending_buf + s->pending;
+    if (last && s->quick_open != 2) {
+        if (s->quick_open) quick_bits(s, ltree[END_BLOCK].Code,
+                                      ltree[END_BLOCK].Len);
+        quick_bits(s, (STATIC_TREES << 1) + 1, 3);
+        s->quick_open = 2;
+    }
+    if (s->quick_open) {
+        quick_bits(s, ltree[END_BLOCK].Code, ltree[END_BLOCK].Len);
+        s->last_eob_len = ltree[END_BLOCK].Len;
+        s->quick_open = 0;
+    }
+    quick_save(s);
+    if (last) _tr_windup(s);
+    s->block_start = s->strstart;
+    flush_pending(s->strm);
+    if (s->strm->avail_out == 0) return last ? finish_started : need_more;
+    return last ? finish_done : block_done;
+}
+
 /* ===========================================================================
  * For Z_RLE, simply look for runs of bytes, generate matches only of distance
  * one.  Do not maintain a hash table.  (It will be regenerated if this run of
@@ -1733,4 +2458,36 @@ local block_state deflate_rle(s, flush)
     FLUSH_BLOCK(s, flush == Z_FINISH);
     return flush == Z_FINISH ? finish_done : block_done;
 }
-#endif
+
+/* ===========================================================================
+ * For Z_HUFFMAN_ONLY, do not look for matches.  Do not maintain a hash table.
+ * (It will be regenerated if this run of deflate switches away from Huffman.)
+ */
+local block_state deflate_huff(s, flush)
+    deflate_state *s;
+    int flush;
+{
+    int bflush;             /* set if current block must be flushed */
+
+    for (;;) {
+        /* Make sure that we have a literal to write. */
+        if (s->lookahead == 0) {
+            fill_window(s);
+            if (s->lookahead == 0) {
+                if (flush == Z_NO_FLUSH)
+                    return need_more;
+                break;      /* flush the current block */
+            }
+        }
+
+        /* Output a literal byte */
+        s->match_length = 0;
+        Tracevv((stderr,"%c", s->window[s->strstart]));
+        _tr_tally_lit (s, s->window[s->strstart], bflush);
+        s->lookahead--;
+        s->strstart++;
+        if (bflush) FLUSH_BLOCK(s, 0);
+    }
+    FLUSH_BLOCK(s, flush == Z_FINISH);
+    return flush == Z_FINISH ? finish_done : block_done;
+}
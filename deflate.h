@@ -33,6 +33,9 @@
 #define LITERALS  256
 /* number of literal bytes 0..255 */
 
+#define END_BLOCK 256
+/* end of block literal code */
+
 #define L_CODES (LITERALS+1+LENGTH_CODES)
 /* number of Literal or Length codes, including the END_BLOCK code */
 
@@ -91,18 +94,37 @@ typedef unsigned IPos;
  * save space in the various tables. IPos is used only for parameter passing.
  */
 
+#if defined(_MSC_VER) && _MSC_VER >= 1200
+   typedef unsigned __int64 bitbuf;
+#  define BITBUF_BITS 64
+#elif defined(__GNUC__) || \
+      (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L)
+   typedef unsigned long long bitbuf;
+#  define BITBUF_BITS 64
+#else
+   typedef ulg bitbuf;
+#  define BITBUF_BITS 32
+#endif
+/* The bit buffer of trees.c: 64 bits where the compiler has them, else at
+ * least 32. It is written out only when full, a word at a time.
+ */
+
 typedef struct internal_state {
     z_streamp strm;      /* pointer back to this zlib stream */
     int   status;        /* as the name implies */
     Bytef *pending_buf;  /* output still pending */
     ulg   pending_buf_size; /* size of pending_buf */
     Bytef *pending_out;  /* next pending byte to output to the stream */
+    Bytef *pending_stage; /* the allocated pending_buf, see flush_pending() */
+    ulg   direct_room;   /* output room for writing blocks straight out */
     uInt   pending;      /* nb of bytes in the pending buffer */
     int   wrap;          /* bit 0 true for zlib, bit 1 true for gzip */
     gz_headerp  gzhead;  /* gzip header information to write */
     uInt   gzindex;      /* where in extra, name, or comment */
     Byte  method;        /* STORED (for zip only) or DEFLATED */
     int   last_flush;    /* value of flush param for previous deflate call */
+    int   pooled;        /* borrow the tables below for each message */
+    voidpf pool_set;     /* the borrowed tables, or Z_NULL between messages */
 
                 /* used by deflate.c: */
 
@@ -145,6 +167,11 @@ typedef struct internal_state {
      *   hash_shift * MIN_MATCH >= hash_bits
      */
 
+    int hash_method;
+    /* Z_HASH_DEFAULT for the rolling hash above, else ins_h is recomputed
+     * from the four bytes at each string inserted.
+     */
+
     long block_start;
     /* Window position at the beginning of the current output block. Gets
      * negative when the window is moved backwards.
@@ -245,13 +272,14 @@ typedef struct internal_state {
     ulg static_len;     /* bit length of current block with static trees */
     uInt matches;       /* number of string matches in current block */
     int last_eob_len;   /* bit length of EOB code for last block */
+    int quick_open;     /* deflate_quick(): 1 + last with a fixed block open */
 
 #ifdef DEBUG
     ulg compressed_len; /* total bit length of compressed file mod 2^32 */
     ulg bits_sent;      /* bit length of compressed data sent mod 2^32 */
 #endif
 
-    ush bi_buf;
+    bitbuf bi_buf;
     /* Output buffer. bits are inserted starting at the bottom (least
      * significant bits).
      */
@@ -267,6 +295,32 @@ typedef struct internal_state {
  */
 #define put_byte(s, c) {s->pending_buf[s->pending++] = (c);}
 
+/* Output the full bit buffer w at p, least significant byte first. The
+ * compiler turns the byte stores into one store where it can.
+ */
+#if BITBUF_BITS == 64
+#  define put_word(p, w) { \
+    (p)[0] = (Byte)(w); (p)[1] = (Byte)((w) >> 8); \
+    (p)[2] = (Byte)((w) >> 16); (p)[3] = (Byte)((w) >> 24); \
+    (p)[4] = (Byte)((w) >> 32); (p)[5] = (Byte)((w) >> 40); \
+    (p)[6] = (Byte)((w) >> 48); (p)[7] = (Byte)((w) >> 56); \
+  }
+#else
+#  define put_word(p, w) { \
+    (p)[0] = (Byte)(w); (p)[1] = (Byte)((w) >> 8); \
+    (p)[2] = (Byte)((w) >> 16); (p)[3] = (Byte)((w) >> 24); \
+  }
+#endif
+
+/* Output the full bit buffer on the stream.
+ * IN assertion: there is enough room in pending_buf.
+ */
+#define put_bitbuf(s, w) { \
+    Bytef *p = s->pending_buf + s->pending; \
+    put_word(p, w); \
+    s->pending += BITBUF_BITS / 8; \
+  }
+
 
 #define MIN_LOOKAHEAD (MAX_MATCH+MIN_MATCH+1)
 /* Minimum amount of lookahead, except at the end of the input file.
@@ -284,9 +338,24 @@ int  _tr_tally        OF((deflate_state *s, unsigned dist, unsigned lc));
 void _tr_flush_block  OF((deflate_state *s, charf *buf, ulg stored_len,
                           int eof));
 void _tr_align        OF((deflate_state *s));
+void _tr_windup       OF((deflate_state *s));
 void _tr_stored_block OF((deflate_state *s, charf *buf, ulg stored_len,
                           int eof));
 
+/* The fixed codes and the extra bits tables, for deflate_quick(), which
+ * sends its symbols as it finds them instead of tallying them.
+ */
+typedef struct quick_codes_s {
+    const ct_data FAR *ltree;       /* fixed literal/length codes */
+    const ct_data FAR *dtree;       /* fixed distance codes */
+    const intf *base_length;        /* first length - MIN_MATCH of each code */
+    const intf *base_dist;          /* first distance - 1 of each code */
+    const intf *extra_lbits;        /* extra bits of each length code */
+    const intf *extra_dbits;        /* extra bits of each distance code */
+} quick_codes;
+
+extern const quick_codes _tr_quick;
+
 #define d_code(dist) \
    ((dist) < 256 ? _dist_code[dist] : _dist_code[256+((dist)>>7)])
 /* Mapping from a distance to a distance code. dist is the distance - 1 and
@@ -294,9 +363,6 @@ void _tr_stored_block OF((deflate_state *s, charf *buf, ulg stored_len,
  * used.
  */
 
-#ifndef DEBUG
-/* Inline versions of _tr_tally for speed: */
-
 #if defined(GEN_TREES_H) || !defined(STDC)
   extern uch _length_code[];
   extern uch _dist_code[];
@@ -305,6 +371,9 @@ void _tr_stored_block OF((deflate_state *s, charf *buf, ulg stored_len,
   extern const uch _dist_code[];
 #endif
 
+#ifndef DEBUG
+/* Inline versions of _tr_tally for speed: */
+
 # define _tr_tally_lit(s, c, flush) \
   { uch cc = (c); \
     s->d_buf[s->last_lit] = 0; \
@@ -51,6 +51,24 @@ void test_sync          OF((Byte *compr, uLong comprLen,
 void test_dict_deflate  OF((Byte *compr, uLong comprLen));
 void test_dict_inflate  OF((Byte *compr, uLong comprLen,
                             Byte *uncompr, uLong uncomprLen));
+void test_rle_flush     OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_pdeflate      OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_quick         OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_hash          OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_combine       OF((Byte *data, uLong len));
+void test_arena         OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_pooled        OF((Byte *compr, uLong comprLen,
+                            Byte *uncompr, uLong uncomprLen));
+void test_getline       OF((const char *fname));
+void test_follow        OF((const char *fname));
+int  read_rest          OF((gzFile file, const Byte *data, uLong pos,
+                            uLong len));
+void test_index         OF((const char *fname));
 int  main               OF((int argc, char *argv[]));
 
 /* ===========================================================================
@@ -507,6 +525,839 @@ void test_dict_inflate(compr, comprLen, uncompr, uncomprLen)
     }
 }
 
+/* ===========================================================================
+ * Test that Z_RLE does not refer back across a full flush: the data after it
+ * must decompress on its own.
+ */
+void test_rle_flush(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    static const char run[] = "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx";
+    z_stream c_stream; /* compression stream */
+    z_stream d_stream; /* decompression stream */
+    uLong mark;
+    int err;
+
+    c_stream.zalloc = (alloc_func)0;
+    c_stream.zfree = (free_func)0;
+    c_stream.opaque = (voidpf)0;
+
+    err = deflateInit2(&c_stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                       MAX_WBITS, 8, Z_RLE);
+    CHECK_ERR(err, "deflateInit2");
+
+    c_stream.next_in  = (Bytef*)run;
+    c_stream.avail_in = (uInt)strlen(run);
+    c_stream.next_out = compr;
+    c_stream.avail_out = (uInt)comprLen;
+    err = deflate(&c_stream, Z_FULL_FLUSH);
+    CHECK_ERR(err, "deflate");
+    mark = c_stream.total_out;
+
+    c_stream.next_in  = (Bytef*)run;
+    c_stream.avail_in = (uInt)strlen(run)+1;
+    err = deflate(&c_stream, Z_FINISH);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "deflate should report Z_STREAM_END\n");
+        exit(1);
+    }
+    err = deflateEnd(&c_stream);
+    CHECK_ERR(err, "deflateEnd");
+
+    d_stream.zalloc = (alloc_func)0;
+    d_stream.zfree = (free_func)0;
+    d_stream.opaque = (voidpf)0;
+
+    d_stream.next_in  = compr + mark;
+    d_stream.avail_in = (uInt)(c_stream.total_out - mark);
+    err = inflateInit2(&d_stream, -MAX_WBITS);   /* no history, no header */
+    CHECK_ERR(err, "inflateInit2");
+
+    d_stream.next_out = uncompr;
+    d_stream.avail_out = (uInt)uncomprLen;
+    err = inflate(&d_stream, Z_SYNC_FLUSH);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "inflate after full flush: %d\n", err);
+        exit(1);
+    }
+    err = inflateEnd(&d_stream);
+    CHECK_ERR(err, "inflateEnd");
+
+    if (strcmp((char*)uncompr, run)) {
+        fprintf(stderr, "bad inflate after full flush\n");
+        exit(1);
+    } else {
+        printf("Z_RLE after full flush: OK\n");
+    }
+}
+
+/* ===========================================================================
+ * Test pzopen()/pzwrite()/pzclose() with zlib, gzip and raw output
+ */
+typedef struct {
+    Byte *buf;
+    uLong len, size;
+} pz_sink;
+
+int pz_collect OF((voidp opaque, const Bytef *buf, unsigned len));
+
+int pz_collect(opaque, buf, len)
+    voidp opaque;
+    const Bytef *buf;
+    unsigned len;
+{
+    pz_sink *sink = (pz_sink *)opaque;
+
+    if (len > sink->size - sink->len) return 1;
+    memcpy(sink->buf + sink->len, buf, len);
+    sink->len += len;
+    return 0;
+}
+
+void test_pdeflate(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    static const int wbits[3] = {15, 16 + 12, -9};
+    static const uLong block[3] = {0, 4096, 1000};
+    Byte *data;
+    uLong len = uncomprLen / 2, i;
+    pz_sink sink;
+    pzStream pz;
+    z_stream d_stream; /* decompression stream */
+    int err, k;
+
+    data = (Byte*)malloc((uInt)len);
+    if (data == Z_NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < len; i++)   /* compressible, but not too well */
+        data[i] = (Byte)(hello[i % 13] + ((i * i) >> 13) % 5);
+
+    for (k = 0; k < 3; k++) {
+        sink.buf = compr;
+        sink.len = 0;
+        sink.size = comprLen;
+        pz = pzopen(pz_collect, &sink, Z_DEFAULT_COMPRESSION, wbits[k], 4,
+                    block[k]);
+        if (pz == NULL) {
+            fprintf(stderr, "pzopen error\n");
+            exit(1);
+        }
+        for (i = 0; i < len; i += 777)  /* unaligned to the blocks */
+            if (pzwrite(pz, data + i, (unsigned)(len - i < 777 ? len - i : 777))
+                == 0) {
+                fprintf(stderr, "pzwrite error\n");
+                exit(1);
+            }
+        err = pzclose(pz);
+        CHECK_ERR(err, "pzclose");
+
+        d_stream.zalloc = (alloc_func)0;
+        d_stream.zfree = (free_func)0;
+        d_stream.opaque = (voidpf)0;
+        d_stream.next_in  = compr;
+        d_stream.avail_in = (uInt)sink.len;
+        err = inflateInit2(&d_stream, wbits[k]);
+        CHECK_ERR(err, "inflateInit2");
+        d_stream.next_out = uncompr;
+        d_stream.avail_out = (uInt)uncomprLen;
+        err = inflate(&d_stream, Z_FINISH);
+        if (err != Z_STREAM_END || d_stream.avail_in != 0) {
+            fprintf(stderr, "inflate of pdeflate output: %d\n", err);
+            exit(1);
+        }
+        err = inflateEnd(&d_stream);
+        CHECK_ERR(err, "inflateEnd");
+
+        if (d_stream.total_out != len || memcmp(uncompr, data, (size_t)len)) {
+            fprintf(stderr, "bad pdeflate, windowBits %d\n", wbits[k]);
+            exit(1);
+        }
+    }
+    free(data);
+    printf("pdeflate(): OK\n");
+}
+
+/* ===========================================================================
+ * Test Z_QUICK with small buffers, then switching away from it midway
+ */
+void test_quick(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    z_stream c_stream; /* compression stream */
+    z_stream d_stream; /* decompression stream */
+    int err;
+    uLong len = (uLong)strlen(hello)+1;
+
+    c_stream.zalloc = (alloc_func)0;
+    c_stream.zfree = (free_func)0;
+    c_stream.opaque = (voidpf)0;
+
+    err = deflateInit2(&c_stream, Z_BEST_SPEED, Z_DEFLATED, MAX_WBITS, 8,
+                       Z_QUICK);
+    CHECK_ERR(err, "deflateInit2");
+
+    c_stream.next_in  = (Bytef*)hello;
+    c_stream.next_out = compr;
+
+    while (c_stream.total_in != len && c_stream.total_out < comprLen) {
+        c_stream.avail_in = c_stream.avail_out = 1; /* force small buffers */
+        err = deflate(&c_stream, Z_NO_FLUSH);
+        CHECK_ERR(err, "deflate");
+    }
+
+    /* The fixed block left open must be ended before the switch: */
+    c_stream.avail_out = (uInt)(comprLen - c_stream.total_out);
+    err = deflateParams(&c_stream, Z_BEST_COMPRESSION, Z_DEFAULT_STRATEGY);
+    CHECK_ERR(err, "deflateParams");
+
+    c_stream.next_in  = (Bytef*)hello;
+    c_stream.avail_in = (uInt)len;
+    err = deflate(&c_stream, Z_FINISH);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "deflate should report Z_STREAM_END\n");
+        exit(1);
+    }
+    err = deflateEnd(&c_stream);
+    CHECK_ERR(err, "deflateEnd");
+
+    d_stream.zalloc = (alloc_func)0;
+    d_stream.zfree = (free_func)0;
+    d_stream.opaque = (voidpf)0;
+
+    d_stream.next_in  = compr;
+    d_stream.avail_in = (uInt)c_stream.total_out;
+    err = inflateInit(&d_stream);
+    CHECK_ERR(err, "inflateInit");
+
+    d_stream.next_out = uncompr;
+    d_stream.avail_out = (uInt)uncomprLen;
+    err = inflate(&d_stream, Z_FINISH);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "inflate of Z_QUICK data: %d\n", err);
+        exit(1);
+    }
+    err = inflateEnd(&d_stream);
+    CHECK_ERR(err, "inflateEnd");
+
+    if (d_stream.total_out != 2*len || strcmp((char*)uncompr, hello) ||
+        strcmp((char*)uncompr + len, hello)) {
+        fprintf(stderr, "bad inflate of Z_QUICK data\n");
+        exit(1);
+    } else {
+        printf("Z_QUICK: %s\n", (char *)uncompr);
+    }
+}
+
+/* ===========================================================================
+ * Test deflate() with each deflateHash() method
+ */
+void test_hash(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    Byte *data;
+    uLong len = uncomprLen / 2, i;
+    z_stream c_stream; /* compression stream */
+    z_stream d_stream; /* decompression stream */
+    int err, method;
+
+    data = (Byte*)malloc((uInt)len);
+    if (data == Z_NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < len; i++)
+        data[i] = (Byte)(hello[i % 13] + ((i * i) >> 13) % 5);
+
+    for (method = Z_HASH_DEFAULT; method <= Z_HASH_CRC32C; method++) {
+        c_stream.zalloc = (alloc_func)0;
+        c_stream.zfree = (free_func)0;
+        c_stream.opaque = (voidpf)0;
+
+        err = deflateInit(&c_stream, Z_DEFAULT_COMPRESSION);
+        CHECK_ERR(err, "deflateInit");
+        err = deflateHash(&c_stream, method);
+        CHECK_ERR(err, "deflateHash");
+
+        c_stream.next_in  = data;
+        c_stream.avail_in = (uInt)len;
+        c_stream.next_out = compr;
+        c_stream.avail_out = (uInt)comprLen;
+        err = deflate(&c_stream, Z_FINISH);
+        if (err != Z_STREAM_END) {
+            fprintf(stderr, "deflate should report Z_STREAM_END\n");
+            exit(1);
+        }
+        if (deflateHash(&c_stream, Z_HASH_DEFAULT) != Z_STREAM_ERROR) {
+            fprintf(stderr, "deflateHash should fail after deflate\n");
+            exit(1);
+        }
+        err = deflateEnd(&c_stream);
+        CHECK_ERR(err, "deflateEnd");
+
+        d_stream.zalloc = (alloc_func)0;
+        d_stream.zfree = (free_func)0;
+        d_stream.opaque = (voidpf)0;
+
+        d_stream.next_in  = compr;
+        d_stream.avail_in = (uInt)c_stream.total_out;
+        err = inflateInit(&d_stream);
+        CHECK_ERR(err, "inflateInit");
+
+        d_stream.next_out = uncompr;
+        d_stream.avail_out = (uInt)uncomprLen;
+        err = inflate(&d_stream, Z_FINISH);
+        if (err != Z_STREAM_END) {
+            fprintf(stderr, "inflate with hash %d: %d\n", method, err);
+            exit(1);
+        }
+        err = inflateEnd(&d_stream);
+        CHECK_ERR(err, "inflateEnd");
+
+        if (d_stream.total_out != len || memcmp(uncompr, data, (size_t)len)) {
+            fprintf(stderr, "bad inflate with hash %d\n", method);
+            exit(1);
+        }
+    }
+
+    c_stream.zalloc = (alloc_func)0;
+    c_stream.zfree = (free_func)0;
+    c_stream.opaque = (voidpf)0;
+
+    err = deflateInit(&c_stream, Z_DEFAULT_COMPRESSION);
+    CHECK_ERR(err, "deflateInit");
+    if (deflateHash(&c_stream, Z_HASH_CRC32C + 1) != Z_STREAM_ERROR ||
+        deflateHash(&c_stream, -1) != Z_STREAM_ERROR) {
+        fprintf(stderr, "deflateHash should reject an invalid method\n");
+        exit(1);
+    }
+    err = deflateEnd(&c_stream);
+    CHECK_ERR(err, "deflateEnd");
+
+    free(data);
+    printf("deflateHash(): OK\n");
+}
+
+/* ===========================================================================
+ * Test crc32_combine_multi() and adler32_combine_multi() against the check
+ * values of the whole data
+ */
+void test_combine(data, len)
+    Byte *data;
+    uLong len;
+{
+    static const z_off_t sizes[] = {1000, 1000, 1000, 0, 7, 4096, 4096, 1};
+    z_off_t lens[sizeof(sizes) / sizeof(sizes[0]) + 1];
+    uLong crcs[sizeof(lens) / sizeof(lens[0])];
+    uLong adlers[sizeof(lens) / sizeof(lens[0])];
+    uLong crc, adler, pos;
+    unsigned n;
+
+    for (pos = 0; pos < len; pos++)
+        data[pos] = (Byte)(hello[pos % 13] + ((pos * pos) >> 13) % 5);
+
+    /* a first piece of 100 bytes, then the others and what is left */
+    pos = 100;
+    for (n = 0; n < sizeof(lens) / sizeof(lens[0]); n++) {
+        lens[n] = n < sizeof(sizes) / sizeof(sizes[0]) ? sizes[n] :
+                  (z_off_t)(len - pos);
+        crcs[n] = crc32(crc32(0L, Z_NULL, 0), data + pos, (uInt)lens[n]);
+        adlers[n] = adler32(adler32(0L, Z_NULL, 0), data + pos,
+                            (uInt)lens[n]);
+        pos += lens[n];
+    }
+    crc = crc32(crc32(0L, Z_NULL, 0), data, 100);
+    adler = adler32(adler32(0L, Z_NULL, 0), data, 100);
+
+    if (crc32_combine_multi(crc, crcs, lens, 0) != crc ||
+        adler32_combine_multi(adler, adlers, lens, 0) != adler) {
+        fprintf(stderr, "combining no pieces should change nothing\n");
+        exit(1);
+    }
+    if (crc32_combine_multi(crc, crcs, lens, n) !=
+        crc32(crc32(0L, Z_NULL, 0), data, (uInt)len)) {
+        fprintf(stderr, "bad crc32_combine_multi\n");
+        exit(1);
+    }
+    if (adler32_combine_multi(adler, adlers, lens, n) !=
+        adler32(adler32(0L, Z_NULL, 0), data, (uInt)len)) {
+        fprintf(stderr, "bad adler32_combine_multi\n");
+        exit(1);
+    }
+    printf("crc32_combine_multi(), adler32_combine_multi(): OK\n");
+}
+
+/* ===========================================================================
+ * Test compressArena() for several sizes, with and without an arena
+ */
+void test_arena(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    static const uLong sizes[] = {0, 1, 100, 1000, 16000};
+    Byte *data, *arena;
+    uLong len, destLen, outLen, i;
+    unsigned k, pass;
+    int err;
+
+    data = (Byte*)malloc((uInt)uncomprLen);
+    arena = (Byte*)malloc((uInt)compressArenaSize(uncomprLen));
+    if (data == Z_NULL || arena == Z_NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < uncomprLen; i++)
+        data[i] = (Byte)(hello[i % 13] + ((i * i) >> 13) % 5);
+
+    for (k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++)
+        for (pass = 0; pass < 2; pass++) {  /* with an arena, then without */
+            len = sizes[k];
+            destLen = compressBound(len);
+            if (destLen > comprLen) {
+                fprintf(stderr, "compressBound(%lu) too large\n", len);
+                exit(1);
+            }
+            err = compressArena(compr, &destLen, data, len,
+                                Z_DEFAULT_COMPRESSION,
+                                pass ? Z_NULL : arena,
+                                pass ? 0 : compressArenaSize(len));
+            CHECK_ERR(err, "compressArena");
+
+            outLen = uncomprLen;
+            err = uncompress(uncompr, &outLen, compr, destLen);
+            CHECK_ERR(err, "uncompress");
+            if (outLen != len || memcmp(uncompr, data, (size_t)len)) {
+                fprintf(stderr, "bad compressArena of %lu bytes\n", len);
+                exit(1);
+            }
+
+            /* the same with a destination one byte short */
+            destLen--;
+            err = compressArena(compr, &destLen, data, len,
+                                Z_DEFAULT_COMPRESSION,
+                                pass ? Z_NULL : arena,
+                                pass ? 0 : compressArenaSize(len));
+            if (err != Z_BUF_ERROR) {
+                fprintf(stderr, "compressArena into %lu bytes: %d\n",
+                        destLen, err);
+                exit(1);
+            }
+        }
+
+    destLen = comprLen;
+    err = compressArena(compr, &destLen, data, 1000, Z_DEFAULT_COMPRESSION,
+                        arena, compressArenaSize(1000) / 2);
+    if (err != Z_MEM_ERROR) {
+        fprintf(stderr, "compressArena with a short arena: %d\n", err);
+        exit(1);
+    }
+
+    free(arena);
+    free(data);
+    printf("compressArena(): OK\n");
+}
+
+/* ===========================================================================
+ * Test deflatePooled() with messages ended by Z_SYNC_FLUSH, from two streams
+ * taking turns. Each message must inflate on its own.
+ */
+void test_pooled(compr, comprLen, uncompr, uncomprLen)
+    Byte *compr, *uncompr;
+    uLong comprLen, uncomprLen;
+{
+    z_stream c_stream[2]; /* compression streams */
+    z_stream d_stream; /* decompression stream */
+    Byte *data;
+    uLong len = uncomprLen / 2, i, msgLen;
+    int err, k, m;
+
+    data = (Byte*)malloc((uInt)len);
+    if (data == Z_NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < len; i++)
+        data[i] = (Byte)(hello[i % 13] + ((i * i) >> 13) % 5);
+
+    for (k = 0; k < 2; k++) {
+        c_stream[k].zalloc = (alloc_func)0;
+        c_stream[k].zfree = (free_func)0;
+        c_stream[k].opaque = (voidpf)0;
+
+        err = deflateInit2(&c_stream[k], Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                           -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        CHECK_ERR(err, "deflateInit2");
+        err = deflatePooled(&c_stream[k]);
+        CHECK_ERR(err, "deflatePooled");
+    }
+
+    d_stream.zalloc = (alloc_func)0;
+    d_stream.zfree = (free_func)0;
+    d_stream.opaque = (voidpf)0;
+    d_stream.next_in = Z_NULL;
+    d_stream.avail_in = 0;
+    err = inflateInit2(&d_stream, -MAX_WBITS);
+    CHECK_ERR(err, "inflateInit2");
+
+    for (m = 0; m < 8; m++) {
+        k = m & 1;
+        msgLen = 1000 + 700 * (m >> 1);   /* each repeats the one before */
+        c_stream[k].next_in  = data;
+        c_stream[k].avail_in = (uInt)msgLen;
+        c_stream[k].next_out = compr;
+        c_stream[k].avail_out = (uInt)comprLen;
+        err = deflate(&c_stream[k], Z_SYNC_FLUSH);
+        CHECK_ERR(err, "deflate");
+        if (c_stream[k].avail_in != 0) {
+            fprintf(stderr, "pooled deflate left input\n");
+            exit(1);
+        }
+
+        /* nothing more to do for this message */
+        err = deflate(&c_stream[k], Z_SYNC_FLUSH);
+        if (err != Z_BUF_ERROR) {
+            fprintf(stderr, "repeated Z_SYNC_FLUSH should report "
+                    "Z_BUF_ERROR\n");
+            exit(1);
+        }
+
+        err = inflateReset(&d_stream);
+        CHECK_ERR(err, "inflateReset");
+        d_stream.next_in  = compr;
+        d_stream.avail_in = (uInt)(comprLen - c_stream[k].avail_out);
+        d_stream.next_out = uncompr;
+        d_stream.avail_out = (uInt)uncomprLen;
+        err = inflate(&d_stream, Z_SYNC_FLUSH);
+        CHECK_ERR(err, "inflate");
+        if (d_stream.avail_in != 0 || d_stream.total_out != msgLen ||
+            memcmp(uncompr, data, (size_t)msgLen)) {
+            fprintf(stderr, "bad inflate of pooled message %d\n", m);
+            exit(1);
+        }
+    }
+
+    for (k = 0; k < 2; k++) {
+        err = deflateEnd(&c_stream[k]);
+        if (err == Z_DATA_ERROR) err = Z_OK;    /* never finished */
+        CHECK_ERR(err, "deflateEnd");
+    }
+    err = inflateEnd(&d_stream);
+    CHECK_ERR(err, "inflateEnd");
+
+    free(data);
+    printf("deflatePooled(): OK\n");
+}
+
+/* ===========================================================================
+ * Test gzgetline() mixed with gzgetc(), gzungetc() and gzread(), on a gzip
+ * file and on a plain one
+ */
+void test_getline(fname)
+    const char *fname; /* compressed file name */
+{
+#ifdef NO_GZCOMPRESS
+    fprintf(stderr, "NO_GZCOMPRESS -- gz* functions cannot compress\n");
+#else
+    static char longline[20001];
+    gzFile file;
+    FILE *plain;
+    const char *line;
+    char buf[8];
+    unsigned len;
+    int err;
+
+    memset(longline, 'x', sizeof(longline) - 2);
+    longline[sizeof(longline) - 2] = '\n';
+
+    file = gzopen(fname, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "gzopen error\n");
+        exit(1);
+    }
+    buf[0] = 'z';
+    if (gzgets(file, buf, 1) != buf || buf[0] != '\0') {
+        fprintf(stderr, "gzgets on a file opened for writing\n");
+        exit(1);
+    }
+    gzputs(file, "one\ntwo\n");
+    gzputs(file, longline);
+    gzputs(file, "last");
+    gzclose(file);
+
+    file = gzopen(fname, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "gzopen error\n");
+        exit(1);
+    }
+    line = gzgetline(file, &len);
+    if (line == NULL || len != 4 || memcmp(line, "one\n", 4)) {
+        fprintf(stderr, "bad gzgetline\n");
+        exit(1);
+    }
+    if (gzgetc(file) != 't' || gzungetc('t', file) != 't') {
+        fprintf(stderr, "gzgetc or gzungetc error after gzgetline\n");
+        exit(1);
+    }
+    line = gzgetline(file, &len);
+    if (line == NULL || len != 4 || memcmp(line, "two\n", 4)) {
+        fprintf(stderr, "bad gzgetline after gzungetc\n");
+        exit(1);
+    }
+    if (gzread(file, buf, 3) != 3 || memcmp(buf, "xxx", 3)) {
+        fprintf(stderr, "gzread err after gzgetline: %s\n",
+                gzerror(file, &err));
+        exit(1);
+    }
+    line = gzgetline(file, &len);
+    if (line == NULL || len != sizeof(longline) - 4 ||
+        memcmp(line, longline + 3, len)) {
+        fprintf(stderr, "bad gzgetline of a long line\n");
+        exit(1);
+    }
+    line = gzgetline(file, &len);
+    if (line == NULL || len != 4 || memcmp(line, "last", 4)) {
+        fprintf(stderr, "bad gzgetline of a last line without newline\n");
+        exit(1);
+    }
+    if (gzgetline(file, &len) != NULL || len != 0 || !gzeof(file)) {
+        fprintf(stderr, "gzgetline should report end of file: %s\n",
+                gzerror(file, &err));
+        exit(1);
+    }
+    gzclose(file);
+
+    /* a file that is not gzip data is read as it is */
+    plain = fopen(fname, "wb");
+    if (plain == NULL) {
+        fprintf(stderr, "fopen error\n");
+        exit(1);
+    }
+    fputs("plain\ntext", plain);
+    fclose(plain);
+
+    file = gzopen(fname, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "gzopen error\n");
+        exit(1);
+    }
+    line = gzgetline(file, &len);
+    if (line == NULL || len != 6 || memcmp(line, "plain\n", 6)) {
+        fprintf(stderr, "bad gzgetline of a plain file\n");
+        exit(1);
+    }
+    if (gzgetc(file) != 't' || gzungetc('t', file) != 't') {
+        fprintf(stderr, "gzgetc or gzungetc error on a plain file\n");
+        exit(1);
+    }
+    line = gzgetline(file, &len);
+    if (line == NULL || len != 4 || memcmp(line, "text", 4) ||
+        gzgetline(file, &len) != NULL) {
+        fprintf(stderr, "bad gzgetline at the end of a plain file\n");
+        exit(1);
+    }
+    gzclose(file);
+    printf("gzgetline(): OK\n");
+#endif
+}
+
+/* ===========================================================================
+ * Test reading a .gz file while it is still being written
+ */
+void test_follow(fname)
+    const char *fname; /* compressed file name */
+{
+#ifdef NO_GZCOMPRESS
+    fprintf(stderr, "NO_GZCOMPRESS -- gz* functions cannot compress\n");
+#else
+    gzFile in, out;
+    char buf[32];
+    int err;
+
+    out = gzopen(fname, "wb");
+    if (out == NULL) {
+        fprintf(stderr, "gzopen error\n");
+        exit(1);
+    }
+    gzputs(out, "first\n");
+    err = gzflush(out, Z_SYNC_FLUSH);
+    CHECK_ERR(err, "gzflush");
+
+    in = gzopen(fname, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "gzopen error\n");
+        exit(1);
+    }
+    if (gzread(in, buf, sizeof(buf)) != 6 || memcmp(buf, "first\n", 6)) {
+        fprintf(stderr, "gzread err: %s\n", gzerror(in, &err));
+        exit(1);
+    }
+
+    gzputs(out, "second\n");
+    err = gzflush(out, Z_SYNC_FLUSH);
+    CHECK_ERR(err, "gzflush");
+    gzclearerr(in);
+    if (gzread(in, buf, sizeof(buf)) != 7 || memcmp(buf, "second\n", 7)) {
+        fprintf(stderr, "gzread err after the file grew: %s\n",
+                gzerror(in, &err));
+        exit(1);
+    }
+
+    gzclose(out);
+    gzclearerr(in);
+    if (gzread(in, buf, sizeof(buf)) != 0 || !gzeof(in)) {
+        fprintf(stderr, "gzread err at the end: %s\n", gzerror(in, &err));
+        exit(1);
+    }
+    gzerror(in, &err);
+    if (err != Z_STREAM_END) {
+        fprintf(stderr, "gzread did not check the trailer: %d\n", err);
+        exit(1);
+    }
+    gzclose(in);
+    printf("gzread() of a growing file: OK\n");
+#endif
+}
+
+/* ===========================================================================
+ * Read file from pos to the end, which must be data[pos..len-1] followed by
+ * a valid trailer; return 0 if so
+ */
+int read_rest(file, data, pos, len)
+    gzFile file;
+    const Byte *data;
+    uLong pos, len;
+{
+    Byte buf[10000];
+    int n, err;
+
+    while ((n = gzread(file, buf, sizeof(buf))) > 0) {
+        if ((uLong)n > len - pos || memcmp(buf, data + pos, n))
+            return 1;
+        pos += n;
+    }
+    gzerror(file, &err);
+    return n != 0 || pos != len || !gzeof(file) || err != Z_STREAM_END;
+}
+
+/* ===========================================================================
+ * Test gzseek() with access points recorded by gzindex(), saved and loaded
+ * again, and thinned out by a small memory limit
+ */
+void test_index(fname)
+    const char *fname; /* compressed file name */
+{
+#ifdef NO_GZCOMPRESS
+    fprintf(stderr, "NO_GZCOMPRESS -- gz* functions cannot compress\n");
+#else
+    static const uLong seeks[] = {900000L, 100000L, 650000L, 3, 1048000L};
+    uLong len = 1L << 20, small = 4 * (32768L + 64), i;
+    Byte *data;
+    char *iname;
+    gzFile file;
+    unsigned k;
+    int pass, err;
+
+    data = (Byte*)malloc((uInt)len);
+    iname = (char*)malloc(strlen(fname) + 2);
+    if (data == Z_NULL || iname == Z_NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    for (i = 0; i < len; i++)
+        data[i] = (Byte)(hello[i % 13] + ((i * i) >> 13) % 5);
+    strcpy(iname, fname);
+    strcat(iname, "i");
+
+    /* flushes end a block every 16K, where access points can go */
+    file = gzopen(fname, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "gzopen error\n");
+        exit(1);
+    }
+    for (i = 0; i < len; i += 16384) {
+        if (gzwrite(file, data + i, 16384) != 16384) {
+            fprintf(stderr, "gzwrite err: %s\n", gzerror(file, &err));
+            exit(1);
+        }
+        err = gzflush(file, Z_SYNC_FLUSH);
+        CHECK_ERR(err, "gzflush");
+    }
+    gzclose(file);
+
+    /* 0: index while reading, and save it; 1: load it; 2: too small for
+       it, so index while reading with thinning */
+    for (pass = 0; pass < 3; pass++) {
+        file = gzopen(fname, "rb");
+        if (file == NULL) {
+            fprintf(stderr, "gzopen error\n");
+            exit(1);
+        }
+        err = gzindex(file, pass < 2 ? 32768L : 4096L,
+                      pass < 2 ? 4 * len : small);
+        CHECK_ERR(err, "gzindex");
+        if (pass == 1) {
+            err = gzloadindex(file, iname);
+            CHECK_ERR(err, "gzloadindex");
+        }
+        else {
+            if (pass == 2 && gzloadindex(file, iname) != Z_BUF_ERROR) {
+                fprintf(stderr, "gzloadindex should exceed the limit\n");
+                exit(1);
+            }
+            if (read_rest(file, data, 0, len)) {
+                fprintf(stderr, "gzread err while indexing: %s\n",
+                        gzerror(file, &err));
+                exit(1);
+            }
+            err = gzsaveindex(file, iname);
+            CHECK_ERR(err, "gzsaveindex");
+        }
+
+        for (k = 0; k < sizeof(seeks) / sizeof(seeks[0]); k++) {
+            Byte buf[500];
+
+            if (gzseek(file, (z_off_t)seeks[k], SEEK_SET) !=
+                (z_off_t)seeks[k] ||
+                gzread(file, buf, sizeof(buf)) != (int)sizeof(buf) ||
+                memcmp(buf, data + seeks[k], sizeof(buf))) {
+                fprintf(stderr, "bad gzseek to %lu with an index (%d)\n",
+                        seeks[k], pass);
+                exit(1);
+            }
+        }
+        if (gzseek(file, 500000L, SEEK_SET) != 500000L ||
+            read_rest(file, data, 500000L, len)) {
+            fprintf(stderr, "bad gzread to the end after gzseek (%d): %s\n",
+                    pass, gzerror(file, &err));
+            exit(1);
+        }
+        gzclose(file);
+    }
+
+    /* the thinned index now fits within the small limit */
+    file = gzopen(fname, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "gzopen error\n");
+        exit(1);
+    }
+    err = gzindex(file, 4096L, small);
+    CHECK_ERR(err, "gzindex");
+    err = gzloadindex(file, iname);
+    CHECK_ERR(err, "gzloadindex of the thinned index");
+    gzclose(file);
+
+    remove(iname);
+    free(iname);
+    free(data);
+    printf("gzseek() with gzindex(): OK\n");
+#endif
+}
+
 /* ===========================================================================
  * Usage:  example [output.gz  [input.gz]]
  */
@@ -558,6 +1409,17 @@ int main(argc, argv)
     test_dict_deflate(compr, comprLen);
     test_dict_inflate(compr, comprLen, uncompr, uncomprLen);
 
+    test_rle_flush(compr, comprLen, uncompr, uncomprLen);
+    test_pdeflate(compr, comprLen, uncompr, uncomprLen);
+    test_quick(compr, comprLen, uncompr, uncomprLen);
+    test_hash(compr, comprLen, uncompr, uncomprLen);
+    test_combine(uncompr, uncomprLen);
+    test_arena(compr, comprLen, uncompr, uncomprLen);
+    test_pooled(compr, comprLen, uncompr, uncomprLen);
+    test_getline(argc > 1 ? argv[1] : TESTFILE);
+    test_follow(argc > 1 ? argv[1] : TESTFILE);
+    test_index(argc > 1 ? argv[1] : TESTFILE);
+
     free(compr);
     free(uncompr);
 
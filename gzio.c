@@ -30,6 +30,18 @@ struct internal_state {int dummy;}; /* for buggy compilers */
 #  define Z_PRINTF_BUFSIZE 4096
 #endif
 
+/* Map whole input files into memory so that inflate reads them in place */
+#if !defined(NO_GZMMAP) && (defined(__unix__) || defined(__APPLE__))
+#  define GZ_MMAP
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#endif
+#ifndef GZ_MAP_CHUNK
+#  define GZ_MAP_CHUNK 0x40000000U /* most input handed to inflate at once */
+#endif
+
 #ifdef __MVS__
 #  pragma map (fdopen , "\174\174FDOPEN")
    FILE *fdopen(int, const char *);
@@ -53,6 +65,19 @@ static int const gz_magic[2] = {0x1f, 0x8b}; /* gzip magic header */
 #define COMMENT      0x10 /* bit 4 set: file comment present */
 #define RESERVED     0xE0 /* bits 5..7: reserved */
 
+#define GZ_WSIZE 32768U /* history needed to resume inflate at a point */
+
+/* access point in a gzip file opened for reading, see gzindex() */
+typedef struct gz_point {
+    z_off_t  out;     /* uncompressed offset of the point */
+    z_off_t  in;      /* compressed bytes into inflate at the point */
+    z_off_t  pos;     /* offset in file of the first whole byte to inflate */
+    uLong    crc;     /* crc32 of the member's data up to the point */
+    int      bits;    /* bits of the byte before pos still to inflate */
+    uInt     size;    /* number of bytes in window */
+    Byte     *window; /* uncompressed data just before the point */
+} gz_point;
+
 typedef struct gz_stream {
     z_stream stream;
     int      z_err;   /* error code for last stream operation */
@@ -70,16 +95,45 @@ typedef struct gz_stream {
     z_off_t  out;     /* bytes out of deflate or inflate */
     int      back;    /* one character push-back */
     int      last;    /* true if push-back is last character */
+    Byte     *map;    /* input file mapped in memory, or Z_NULL */
+    z_off_t  map_len; /* size of map */
+    z_off_t  map_pos; /* offset in map of the end of next_in */
+    Byte     *line;   /* read-ahead buffer for gzgets and gzgetline */
+    uInt     size;    /* allocated size of line */
+    Byte     *next;   /* next unread byte in line */
+    uInt     have;    /* number of unread bytes at next */
+    z_off_t  span;    /* distance between access points, 0 if no index */
+    gz_point *points; /* access points, in increasing out order */
+    int      npoints; /* number of access points */
+    int      room;    /* number of points allocated */
+    int      maxpoints; /* most points allowed by the memory limit */
+    z_off_t  member;  /* out at the start of the current gzip member */
+    Byte     *ring;   /* last GZ_WSIZE bytes of output while indexing */
+    uInt     ring_pos;  /* next position to write in ring */
+    uInt     ring_have; /* number of valid bytes in ring */
 } gz_stream;
 
 
 local gzFile gz_open      OF((const char *path, const char *mode, int  fd));
 local int do_flush        OF((gzFile file, int flush));
+local void   gz_map       OF((gz_stream *s));
+local void   gz_remap     OF((gz_stream *s));
+local uInt   gz_input     OF((gz_stream *s));
 local int    get_byte     OF((gz_stream *s));
 local void   check_header OF((gz_stream *s));
 local int    destroy      OF((gz_stream *s));
 local void   putLong      OF((FILE *file, uLong x));
 local uLong  getLong      OF((gz_stream *s));
+local int    gz_read      OF((gz_stream *s, voidp buf, unsigned len));
+local int    gz_fill      OF((gz_stream *s));
+local z_off_t gz_where    OF((gz_stream *s));
+local int    gz_mark      OF((gz_stream *s, Bytef *from));
+local void   gz_addpoint  OF((gz_stream *s));
+local int    gz_jump      OF((gz_stream *s, gz_point *p));
+local void   gz_unindex   OF((gz_stream *s));
+local void   putOff       OF((FILE *file, z_off_t x));
+local int    loadLong     OF((FILE *file, uLong *x));
+local int    loadOff      OF((FILE *file, z_off_t *x));
 
 /* ===========================================================================
      Opens a gzip (.gz) file for reading or writing. The mode parameter
@@ -120,6 +174,16 @@ local gzFile gz_open (path, mode, fd)
     s->in = 0;
     s->out = 0;
     s->back = EOF;
+    s->map = Z_NULL;
+    s->map_len = s->map_pos = 0;
+    s->line = s->next = Z_NULL;
+    s->size = s->have = 0;
+    s->span = 0;
+    s->points = Z_NULL;
+    s->npoints = s->room = s->maxpoints = 0;
+    s->member = 0;
+    s->ring = Z_NULL;
+    s->ring_pos = s->ring_have = 0;
     s->crc = crc32(0L, Z_NULL, 0);
     s->msg = NULL;
     s->transparent = 0;
@@ -195,8 +259,9 @@ local gzFile gz_open (path, mode, fd)
          * necessary.
          */
     } else {
+        gz_map(s);
         check_header(s); /* skip the .gz header */
-        s->start = ftell(s->file) - s->stream.avail_in;
+        s->start = gz_where(s);
     }
 
     return (gzFile)s;
@@ -253,6 +318,105 @@ int ZEXPORT gzsetparams (file, level, strategy)
     return deflateParams (&(s->stream), level, strategy);
 }
 
+/* ===========================================================================
+     Map a regular input file into memory, so that next_in can point straight
+   into the file and no copy is made. If that is not possible, at least ask
+   the system for aggressive read-ahead. The file is read from its current
+   position.
+*/
+local void gz_map(s)
+    gz_stream *s;
+{
+#ifdef GZ_MMAP
+    int fd = fileno(s->file);
+    struct stat st;
+    z_off_t pos;
+    void *map;
+
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+        return;
+    pos = ftell(s->file);
+    if (pos < 0 || pos > st.st_size) return;
+    if ((off_t)(size_t)st.st_size == st.st_size) {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+#  ifdef MADV_SEQUENTIAL
+            madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+#  endif
+            s->map = (Byte*)map;
+            s->map_len = (z_off_t)st.st_size;
+            s->map_pos = pos;
+            return;
+        }
+    }
+#  ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#  endif
+#else
+    if (s == NULL) return; /* make compiler happy */
+#endif
+}
+
+/* ===========================================================================
+     Map the file again if it has grown since it was mapped, as it does while
+   it is still being written, so that reading goes on past the old end as it
+   would with fread().
+*/
+local void gz_remap(s)
+    gz_stream *s;
+{
+#ifdef GZ_MMAP
+    int fd = fileno(s->file);
+    struct stat st;
+    void *map;
+
+    if (fstat(fd, &st) != 0 || (z_off_t)st.st_size <= s->map_len ||
+        (off_t)(size_t)st.st_size != st.st_size)
+        return;
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) return;
+#  ifdef MADV_SEQUENTIAL
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+#  endif
+    munmap((void*)s->map, (size_t)s->map_len);
+    s->map = (Byte*)map;
+    s->map_len = (z_off_t)st.st_size;
+#else
+    if (s == NULL) return; /* make compiler happy */
+#endif
+}
+
+/* ===========================================================================
+     Append more input after the avail_in bytes still unused at next_in.
+   From a mapped file, this only moves the end of next_in further into the
+   map. Return the number of bytes added, 0 for end of file or error.
+*/
+local uInt gz_input(s)
+    gz_stream *s;
+{
+    uInt len = s->stream.avail_in;
+    uInt n;
+
+    if (s->map != Z_NULL) {
+        z_off_t left;
+
+        if (s->map_pos == s->map_len) gz_remap(s);
+        left = s->map_len - s->map_pos;
+        n = left < (z_off_t)GZ_MAP_CHUNK ? (uInt)left : GZ_MAP_CHUNK;
+        s->stream.next_in = s->map + (s->map_pos - len);
+        s->map_pos += n;
+    } else {
+        if (len && s->stream.next_in != s->inbuf)
+            memmove(s->inbuf, s->stream.next_in, len);
+        errno = 0;
+        n = (uInt)fread(s->inbuf + len, 1, Z_BUFSIZE - len, s->file);
+        if (n == 0 && ferror(s->file)) s->z_err = Z_ERRNO;
+        s->stream.next_in = s->inbuf;
+    }
+    s->stream.avail_in = len + n;
+    return n;
+}
+
 /* ===========================================================================
      Read a byte from a gz_stream; update next_in and avail_in. Return EOF
    for end of file.
@@ -262,15 +426,9 @@ local int get_byte(s)
     gz_stream *s;
 {
     if (s->z_eof) return EOF;
-    if (s->stream.avail_in == 0) {
-        errno = 0;
-        s->stream.avail_in = (uInt)fread(s->inbuf, 1, Z_BUFSIZE, s->file);
-        if (s->stream.avail_in == 0) {
-            s->z_eof = 1;
-            if (ferror(s->file)) s->z_err = Z_ERRNO;
-            return EOF;
-        }
-        s->stream.next_in = s->inbuf;
+    if (s->stream.avail_in == 0 && gz_input(s) == 0) {
+        s->z_eof = 1;
+        return EOF;
     }
     s->stream.avail_in--;
     return *(s->stream.next_in)++;
@@ -298,12 +456,7 @@ local void check_header(s)
        gzip segment */
     len = s->stream.avail_in;
     if (len < 2) {
-        if (len) s->inbuf[0] = s->stream.next_in[0];
-        errno = 0;
-        len = (uInt)fread(s->inbuf + len, 1, Z_BUFSIZE >> len, s->file);
-        if (len == 0 && ferror(s->file)) s->z_err = Z_ERRNO;
-        s->stream.avail_in += len;
-        s->stream.next_in = s->inbuf;
+        (void)gz_input(s);
         if (s->stream.avail_in < 2) {
             s->transparent = s->stream.avail_in;
             return;
@@ -361,6 +514,9 @@ local int destroy (s)
 
     TRYFREE(s->msg);
 
+#ifdef GZ_MMAP
+    if (s->map != Z_NULL) munmap((void*)s->map, (size_t)s->map_len);
+#endif
     if (s->stream.state != NULL) {
         if (s->mode == 'w') {
 #ifdef NO_GZCOMPRESS
@@ -382,26 +538,27 @@ local int destroy (s)
 
     TRYFREE(s->inbuf);
     TRYFREE(s->outbuf);
+    TRYFREE(s->line);
+    gz_unindex(s);
     TRYFREE(s->path);
     TRYFREE(s);
     return err;
 }
 
 /* ===========================================================================
-     Reads the given number of uncompressed bytes from the compressed file.
-   gzread returns the number of bytes actually read (0 for end of file).
+     Reads the given number of uncompressed bytes from the compressed file,
+   bypassing the read-ahead buffer. Returns the number of bytes actually read
+   (0 for end of file), or -1 in case of error.
 */
-int ZEXPORT gzread (file, buf, len)
-    gzFile file;
+local int gz_read (s, buf, len)
+    gz_stream *s;
     voidp buf;
     unsigned len;
 {
-    gz_stream *s = (gz_stream*)file;
     Bytef *start = (Bytef*)buf; /* starting point for crc computation */
+    Bytef *from;     /* output of the last inflate call starts here */
     Byte  *next_out; /* == stream.next_out but not forced far (for MSDOS) */
 
-    if (s == NULL || s->mode != 'r') return Z_STREAM_ERROR;
-
     if (s->z_err == Z_DATA_ERROR || s->z_err == Z_ERRNO) return -1;
     if (s->z_err == Z_STREAM_END) return 0;  /* EOF */
 
@@ -436,7 +593,17 @@ int ZEXPORT gzread (file, buf, len)
                 s->stream.avail_out -= n;
                 s->stream.avail_in  -= n;
             }
-            if (s->stream.avail_out > 0) {
+            if (s->stream.avail_out > 0 && s->map != Z_NULL) {
+                z_off_t left;
+
+                if (s->map_pos == s->map_len) gz_remap(s);
+                left = s->map_len - s->map_pos;
+                n = s->stream.avail_out;
+                if ((z_off_t)n > left) n = (uInt)left;
+                zmemcpy(next_out, s->map + s->map_pos, n);
+                s->map_pos += n;
+                s->stream.avail_out -= n;
+            } else if (s->stream.avail_out > 0) {
                 s->stream.avail_out -=
                     (uInt)fread(next_out, 1, s->stream.avail_out, s->file);
             }
@@ -446,25 +613,23 @@ int ZEXPORT gzread (file, buf, len)
             if (len == 0) s->z_eof = 1;
             return (int)len;
         }
-        if (s->stream.avail_in == 0 && !s->z_eof) {
-
-            errno = 0;
-            s->stream.avail_in = (uInt)fread(s->inbuf, 1, Z_BUFSIZE, s->file);
-            if (s->stream.avail_in == 0) {
-                s->z_eof = 1;
-                if (ferror(s->file)) {
-                    s->z_err = Z_ERRNO;
-                    break;
-                }
-            }
-            s->stream.next_in = s->inbuf;
+        if (s->stream.avail_in == 0 && !s->z_eof && gz_input(s) == 0) {
+            s->z_eof = 1;
+            if (s->z_err == Z_ERRNO) break;
         }
         s->in += s->stream.avail_in;
         s->out += s->stream.avail_out;
-        s->z_err = inflate(&(s->stream), Z_NO_FLUSH);
+        from = s->stream.next_out;
+        s->z_err = inflate(&(s->stream), s->span ? Z_BLOCK : Z_NO_FLUSH);
         s->in -= s->stream.avail_in;
         s->out -= s->stream.avail_out;
 
+        if (s->span && s->z_err == Z_OK && gz_mark(s, from)) {
+            s->crc = crc32(s->crc, start, (uInt)(s->stream.next_out - start));
+            start = s->stream.next_out;
+            gz_addpoint(s);
+        }
+
         if (s->z_err == Z_STREAM_END) {
             /* Check CRC and original size */
             s->crc = crc32(s->crc, start, (uInt)(s->stream.next_out - start));
@@ -482,6 +647,7 @@ int ZEXPORT gzread (file, buf, len)
                 if (s->z_err == Z_OK) {
                     inflateReset(&(s->stream));
                     s->crc = crc32(0L, Z_NULL, 0);
+                    s->member = s->out;
                 }
             }
         }
@@ -495,6 +661,67 @@ int ZEXPORT gzread (file, buf, len)
     return (int)(len - s->stream.avail_out);
 }
 
+/* ===========================================================================
+     Reads the given number of uncompressed bytes from the compressed file.
+   gzread returns the number of bytes actually read (0 for end of file).
+   Bytes already decompressed by gzgets or gzgetline are returned first.
+*/
+int ZEXPORT gzread (file, buf, len)
+    gzFile file;
+    voidp buf;
+    unsigned len;
+{
+    gz_stream *s = (gz_stream*)file;
+    unsigned n;
+    int got;
+
+    if (s == NULL || s->mode != 'r') return Z_STREAM_ERROR;
+
+    n = 0;
+    if (s->have) {
+        n = s->have < len ? s->have : len;
+        zmemcpy((Bytef*)buf, s->next, n);
+        s->next += n;
+        s->have -= n;
+        if (n == len) return (int)n;
+    }
+    got = gz_read(s, (Bytef*)buf + n, len - n);
+    if (got < 0) return n ? (int)n : -1; /* error is reported next time */
+    return (int)(n + got);
+}
+
+/* ===========================================================================
+     Moves the unread bytes of the read-ahead buffer to its start, growing it
+   if it is full, and appends as much uncompressed data as fits. Returns the
+   number of bytes added (0 for end of file), or -1 in case of error.
+*/
+local int gz_fill (s)
+    gz_stream *s;
+{
+    int n;
+
+    if (s->have == s->size) {
+        uInt size = s->size ? s->size << 1 : Z_BUFSIZE;
+        Byte *line;
+
+        if (size <= s->size || (int)size < 0 ||
+            (line = (Byte*)ALLOC(size)) == Z_NULL) {
+            s->z_err = Z_MEM_ERROR;
+            return -1;
+        }
+        if (s->have) zmemcpy(line, s->next, s->have);
+        TRYFREE(s->line);
+        s->line = line;
+        s->size = size;
+    } else if (s->have && s->next != s->line) {
+        memmove(s->line, s->next, s->have);
+    }
+    s->next = s->line;
+    n = gz_read(s, s->line + s->have, s->size - s->have);
+    if (n > 0) s->have += n;
+    return n;
+}
+
 
 /* ===========================================================================
       Reads one byte from the compressed file. gzgetc returns this byte
@@ -503,8 +730,13 @@ int ZEXPORT gzread (file, buf, len)
 int ZEXPORT gzgetc(file)
     gzFile file;
 {
+    gz_stream *s = (gz_stream*)file;
     unsigned char c;
 
+    if (s != NULL && s->mode == 'r' && s->have) {
+        s->have--;
+        return *(s->next)++;
+    }
     return gzread(file, &c, 1) == 1 ? c : -1;
 }
 
@@ -518,7 +750,19 @@ int ZEXPORT gzungetc(c, file)
 {
     gz_stream *s = (gz_stream*)file;
 
-    if (s == NULL || s->mode != 'r' || c == EOF || s->back != EOF) return EOF;
+    if (s == NULL || s->mode != 'r' || c == EOF) return EOF;
+    if (s->have || (s->line != Z_NULL && s->next != s->line)) {
+        /* put it in front of the read-ahead data so that order is kept */
+        if (s->next == s->line) {
+            if (s->have == s->size) return EOF;
+            memmove(s->line + 1, s->line, s->have);
+            s->next++;
+        }
+        *--(s->next) = (Byte)c;
+        s->have++;
+        return c;
+    }
+    if (s->back != EOF) return EOF;
     s->back = c;
     s->out--;
     s->last = (s->z_err == Z_STREAM_END);
@@ -535,19 +779,80 @@ int ZEXPORT gzungetc(c, file)
    with a null character.
       gzgets returns buf, or Z_NULL in case of error.
 
-      The current implementation is not optimized at all.
+      The data is decompressed a block at a time into the read-ahead buffer
+   and scanned for the newline with memchr, so only the line itself is
+   copied to buf.
 */
 char * ZEXPORT gzgets(file, buf, len)
     gzFile file;
     char *buf;
     int len;
 {
-    char *b = buf;
+    gz_stream *s = (gz_stream*)file;
+    char *str = buf;
+    Byte *eol;
+    uInt left, n;
+
     if (buf == Z_NULL || len <= 0) return Z_NULL;
+    if (s == NULL || s->mode != 'r') {
+        *buf = '\0';
+        return len > 1 ? Z_NULL : buf;
+    }
 
-    while (--len > 0 && gzread(file, buf, 1) == 1 && *buf++ != '\n') ;
-    *buf = '\0';
-    return b == buf && len > 0 ? Z_NULL : b;
+    left = (uInt)len - 1;
+    while (left) {
+        if (s->have == 0 && gz_fill(s) <= 0) break;
+        n = s->have < left ? s->have : left;
+        eol = (Byte*)memchr(s->next, '\n', n);
+        if (eol != Z_NULL) n = (uInt)(eol - s->next) + 1;
+        zmemcpy((Bytef*)str, s->next, n);
+        str += n;
+        left -= n;
+        s->next += n;
+        s->have -= n;
+        if (eol != Z_NULL) break;
+    }
+    *str = '\0';
+    return str == buf && len > 1 ? Z_NULL : buf;
+}
+
+/* ===========================================================================
+      Returns a pointer to the next line in the read-ahead buffer, including
+   its newline if any, and sets *len to its length. The buffer is grown as
+   needed to hold a whole line. Returns Z_NULL at end of file or on error.
+*/
+const char * ZEXPORT gzgetline(file, len)
+    gzFile file;
+    unsigned *len;
+{
+    gz_stream *s = (gz_stream*)file;
+    uInt seen = 0;  /* bytes at next already known to hold no newline */
+    Byte *eol;
+    Byte *line;
+    uInt n;
+
+    if (s == NULL || s->mode != 'r' || len == NULL) return Z_NULL;
+    *len = 0;
+
+    for (;;) {
+        eol = s->have > seen ?
+              (Byte*)memchr(s->next + seen, '\n', s->have - seen) : Z_NULL;
+        if (eol != Z_NULL) {
+            n = (uInt)(eol - s->next) + 1;
+            break;
+        }
+        seen = s->have;
+        if (gz_fill(s) <= 0) {
+            if (s->have == 0 || s->z_err == Z_MEM_ERROR) return Z_NULL;
+            n = s->have;   /* last line has no newline */
+            break;
+        }
+    }
+    line = s->next;
+    s->next += n;
+    s->have -= n;
+    *len = n;
+    return (const char*)line;
 }
 
 
@@ -762,7 +1067,8 @@ int ZEXPORT gzflush (file, flush)
       gzseek returns the resulting offset location as measured in bytes from
    the beginning of the uncompressed stream, or -1 in case of error.
       SEEK_END is not implemented, returns error.
-      In this version of the library, gzseek can be extremely slow.
+      In this version of the library, gzseek can be extremely slow, unless
+   access points are recorded with gzindex.
 */
 z_off_t ZEXPORT gzseek (file, offset, whence)
     gzFile file;
@@ -770,6 +1076,7 @@ z_off_t ZEXPORT gzseek (file, offset, whence)
     int whence;
 {
     gz_stream *s = (gz_stream*)file;
+    gz_point *p;
 
     if (s == NULL || whence == SEEK_END ||
         s->z_err == Z_ERRNO || s->z_err == Z_DATA_ERROR) {
@@ -807,24 +1114,46 @@ z_off_t ZEXPORT gzseek (file, offset, whence)
 
     /* compute absolute position */
     if (whence == SEEK_CUR) {
-        offset += s->out;
+        offset += s->out - s->have;
     }
     if (offset < 0) return -1L;
 
     if (s->transparent) {
         /* map to fseek */
         s->back = EOF;
+        s->have = 0;
         s->stream.avail_in = 0;
         s->stream.next_in = s->inbuf;
-        if (fseek(s->file, offset, SEEK_SET) < 0) return -1L;
+        if (s->map != Z_NULL) {
+            if (offset > s->map_len) gz_remap(s);
+            s->map_pos = offset < s->map_len ? offset : s->map_len;
+        } else if (fseek(s->file, offset, SEEK_SET) < 0) {
+            return -1L;
+        }
 
         s->in = s->out = offset;
         return offset;
     }
 
-    /* For a negative seek, rewind and use positive seek */
-    if (offset >= s->out) {
-        offset -= s->out;
+    /* Resume at the last access point before offset if that saves work,
+       else for a negative seek, rewind and use positive seek */
+    p = Z_NULL;
+    if (s->npoints && s->points[0].out <= offset) {
+        int lo = 0, hi = s->npoints - 1;
+
+        while (lo < hi) {
+            int mid = (lo + hi + 1) >> 1;
+            if (s->points[mid].out <= offset) lo = mid;
+            else hi = mid - 1;
+        }
+        p = s->points + lo;
+    }
+    if (p != Z_NULL &&
+        (offset < s->out - s->have || p->out > s->out - s->have)) {
+        if (gz_jump(s, p) < 0) return -1L;
+        offset -= p->out;
+    } else if (offset >= s->out - s->have) {
+        offset -= s->out - s->have;
     } else if (gzrewind(file) < 0) {
         return -1L;
     }
@@ -848,7 +1177,7 @@ z_off_t ZEXPORT gzseek (file, offset, whence)
         if (size <= 0) return -1L;
         offset -= size;
     }
-    return s->out;
+    return s->out - s->have;
 }
 
 /* ===========================================================================
@@ -864,12 +1193,19 @@ int ZEXPORT gzrewind (file)
     s->z_err = Z_OK;
     s->z_eof = 0;
     s->back = EOF;
+    s->have = 0;
+    s->member = 0;
+    s->ring_pos = s->ring_have = 0;
     s->stream.avail_in = 0;
     s->stream.next_in = s->inbuf;
     s->crc = crc32(0L, Z_NULL, 0);
     if (!s->transparent) (void)inflateReset(&s->stream);
     s->in = 0;
     s->out = 0;
+    if (s->map != Z_NULL) {
+        s->map_pos = s->start;
+        return 0;
+    }
     return fseek(s->file, s->start, SEEK_SET);
 }
 
@@ -898,6 +1234,7 @@ int ZEXPORT gzeof (file)
      * on a gz_stream. Handle end-of-stream error explicitly here.
      */
     if (s == NULL || s->mode != 'r') return 0;
+    if (s->have) return 0;
     if (s->z_eof) return 1;
     return s->z_err == Z_STREAM_END;
 }
@@ -914,6 +1251,324 @@ int ZEXPORT gzdirect (file)
     return s->transparent;
 }
 
+/* ===========================================================================
+     Returns the offset in the file of the next input byte for inflate.
+*/
+local z_off_t gz_where (s)
+    gz_stream *s;
+{
+    return (s->map != Z_NULL ? s->map_pos : (z_off_t)ftell(s->file)) -
+           (z_off_t)s->stream.avail_in;
+}
+
+/* ===========================================================================
+     Copies the output of the last inflate call, from from to next_out, to
+   the end of the ring of recent output. Returns true if inflate stopped at
+   the end of a block where an access point is due.
+*/
+local int gz_mark (s, from)
+    gz_stream *s;
+    Bytef *from;
+{
+    uInt n = (uInt)(s->stream.next_out - from);
+    uInt k;
+    z_off_t last;
+
+    if (n >= GZ_WSIZE) {
+        zmemcpy(s->ring, from + n - GZ_WSIZE, GZ_WSIZE);
+        s->ring_pos = 0;
+        s->ring_have = GZ_WSIZE;
+    } else if (n) {
+        k = GZ_WSIZE - s->ring_pos;
+        if (k > n) k = n;
+        zmemcpy(s->ring + s->ring_pos, from, k);
+        zmemcpy(s->ring, from + k, n - k);
+        s->ring_pos = (s->ring_pos + n) & (GZ_WSIZE - 1);
+        s->ring_have = s->ring_have + n > GZ_WSIZE ? GZ_WSIZE :
+                       s->ring_have + n;
+    }
+
+    /* end of a block other than the last one of the member, far enough from
+       the last point, and with all the history inflate may refer to */
+    last = s->npoints ? s->points[s->npoints - 1].out : 0;
+    return (s->stream.data_type & 192) == 128 && s->out - last >= s->span &&
+           (s->ring_have == GZ_WSIZE ||
+            (z_off_t)s->ring_have >= s->out - s->member);
+}
+
+/* ===========================================================================
+     Records an access point at the current position. When the memory limit
+   is reached, every other point is dropped and the span is doubled instead.
+   A point that cannot be allocated is silently skipped.
+*/
+local void gz_addpoint (s)
+    gz_stream *s;
+{
+    gz_point *p;
+    uInt size, first, k;
+    int n;
+
+    if (s->npoints == s->maxpoints) {
+        for (n = 0; n < s->npoints; n++) {
+            if (n & 1)
+                s->points[n >> 1] = s->points[n];
+            else
+                TRYFREE(s->points[n].window);
+        }
+        s->npoints >>= 1;
+        s->span <<= 1;
+        if (s->npoints && s->out - s->points[s->npoints - 1].out < s->span)
+            return;
+    }
+    if (s->npoints == s->room) {
+        n = s->room ? s->room << 1 : 16;
+        if (n > s->maxpoints) n = s->maxpoints;
+        p = (gz_point*)ALLOC((uInt)n * sizeof(gz_point));
+        if (p == Z_NULL) return;
+        if (s->npoints) zmemcpy(p, s->points, s->npoints * sizeof(gz_point));
+        TRYFREE(s->points);
+        s->points = p;
+        s->room = n;
+    }
+
+    size = s->ring_have;
+    if ((z_off_t)size > s->out - s->member) size = (uInt)(s->out - s->member);
+    p = s->points + s->npoints;
+    p->window = Z_NULL;
+    if (size) {
+        p->window = (Byte*)ALLOC(size);
+        if (p->window == Z_NULL) return;
+        first = (s->ring_pos - size) & (GZ_WSIZE - 1);
+        k = GZ_WSIZE - first;
+        if (k > size) k = size;
+        zmemcpy(p->window, s->ring + first, k);
+        zmemcpy(p->window + k, s->ring, size - k);
+    }
+    p->out = s->out;
+    p->in = s->in;
+    p->pos = gz_where(s);
+    p->crc = s->crc;
+    p->bits = s->stream.data_type & 7;
+    p->size = size;
+    s->npoints++;
+}
+
+/* ===========================================================================
+     Repositions the stream at the given access point, discarding any
+   read-ahead. Returns 0, or -1 in case of error.
+*/
+local int gz_jump (s, p)
+    gz_stream *s;
+    gz_point *p;
+{
+    z_off_t pos = p->pos - (p->bits ? 1 : 0);
+    int c;
+
+    s->stream.avail_in = 0;
+    s->stream.next_in = s->inbuf;
+    if (s->map != Z_NULL) {
+        if (pos > s->map_len) gz_remap(s);
+        if (pos > s->map_len) return -1;
+        s->map_pos = pos;
+    } else if (fseek(s->file, pos, SEEK_SET) < 0) {
+        return -1;
+    }
+    s->z_err = Z_OK;
+    s->z_eof = 0;
+    s->back = EOF;
+    s->have = 0;
+    (void)inflateReset(&s->stream);
+    if (p->bits) {
+        c = get_byte(s);
+        if (c == EOF) return -1;
+        (void)inflatePrime(&s->stream, p->bits, c >> (8 - p->bits));
+    }
+    if (p->size &&
+        inflateSetDictionary(&s->stream, p->window, p->size) != Z_OK) {
+        s->z_err = Z_MEM_ERROR;
+        return -1;
+    }
+    s->in = p->in;
+    s->out = p->out;
+    s->crc = p->crc;
+    s->member = p->out - p->size;
+    if (p->size) zmemcpy(s->ring, p->window, p->size);
+    s->ring_pos = p->size & (GZ_WSIZE - 1);
+    s->ring_have = p->size;
+    return 0;
+}
+
+/* ===========================================================================
+     Frees the access points and stops recording them.
+*/
+local void gz_unindex (s)
+    gz_stream *s;
+{
+    while (s->npoints) {
+        s->npoints--;
+        TRYFREE(s->points[s->npoints].window);
+    }
+    TRYFREE(s->points);
+    TRYFREE(s->ring);
+    s->points = Z_NULL;
+    s->ring = Z_NULL;
+    s->room = s->maxpoints = 0;
+    s->span = 0;
+    s->ring_pos = s->ring_have = 0;
+}
+
+/* ===========================================================================
+     Starts recording access points every span uncompressed bytes while
+   reading, using at most about limit bytes for them.
+*/
+int ZEXPORT gzindex (file, span, limit)
+    gzFile file;
+    z_off_t span;
+    uLong limit;
+{
+    gz_stream *s = (gz_stream*)file;
+    uLong max;
+
+    if (s == NULL || s->mode != 'r' || span < 0) return Z_STREAM_ERROR;
+    gz_unindex(s);
+    if (span == 0) return Z_OK;
+
+    max = limit / (GZ_WSIZE + sizeof(gz_point));
+    if (max < 1) return Z_STREAM_ERROR;
+    if (max > 0x7fffffffUL / sizeof(gz_point))
+        max = 0x7fffffffUL / sizeof(gz_point);
+    s->ring = (Byte*)ALLOC(GZ_WSIZE);
+    if (s->ring == Z_NULL) return Z_MEM_ERROR;
+    s->maxpoints = (int)max;
+    s->span = span;
+    return Z_OK;
+}
+
+/* ===========================================================================
+     Writes the access points of file to path. The format is "gzix", the
+   start of the compressed data, the span and the number of points, followed
+   by each point with its window; offsets take 8 bytes and the rest 4, all
+   in LSB order.
+*/
+int ZEXPORT gzsaveindex (file, path)
+    gzFile file;
+    const char *path;
+{
+    gz_stream *s = (gz_stream*)file;
+    gz_point *p;
+    FILE *out;
+    int n, err;
+
+    if (s == NULL || s->mode != 'r' || path == NULL) return Z_STREAM_ERROR;
+
+    out = F_OPEN(path, "wb");
+    if (out == NULL) return Z_ERRNO;
+    fputs("gzix", out);
+    putOff(out, s->start);
+    putOff(out, s->span);
+    putLong(out, (uLong)s->npoints);
+    for (n = 0; n < s->npoints; n++) {
+        p = s->points + n;
+        putOff(out, p->out);
+        putOff(out, p->in);
+        putOff(out, p->pos);
+        putLong(out, p->crc);
+        putLong(out, (uLong)p->bits);
+        putLong(out, (uLong)p->size);
+        if (p->size) fwrite(p->window, 1, p->size, out);
+    }
+    err = ferror(out);
+    if (fclose(out) || err) return Z_ERRNO;
+    return Z_OK;
+}
+
+/* ===========================================================================
+     Replaces the access points of file with those saved in path.
+*/
+int ZEXPORT gzloadindex (file, path)
+    gzFile file;
+    const char *path;
+{
+    gz_stream *s = (gz_stream*)file;
+    gz_point *p;
+    FILE *in;
+    char magic[4];
+    z_off_t start, span, last;
+    uLong count, bits, size;
+    int err;
+
+    if (s == NULL || s->mode != 'r' || s->span == 0 || path == NULL)
+        return Z_STREAM_ERROR;
+
+    in = F_OPEN(path, "rb");
+    if (in == NULL) return Z_ERRNO;
+    if (fread(magic, 1, 4, in) != 4 || memcmp(magic, "gzix", 4) ||
+        loadOff(in, &start) || loadOff(in, &span) || loadLong(in, &count) ||
+        start != s->start || span <= 0) {
+        fclose(in);
+        return Z_DATA_ERROR;
+    }
+    if (count > (uLong)s->maxpoints) {
+        fclose(in);
+        return Z_BUF_ERROR;
+    }
+
+    /* drop the current points, keeping the memory limit */
+    while (s->npoints) {
+        s->npoints--;
+        TRYFREE(s->points[s->npoints].window);
+    }
+    if ((uLong)s->room < count) {
+        TRYFREE(s->points);
+        s->room = 0;
+        s->points = (gz_point*)ALLOC((uInt)count * sizeof(gz_point));
+        err = Z_MEM_ERROR;
+        if (s->points == Z_NULL) goto done;
+        s->room = (int)count;
+    }
+
+    err = Z_DATA_ERROR;
+    last = -1;
+    while ((uLong)s->npoints < count) {
+        p = s->points + s->npoints;
+        if (loadOff(in, &p->out) || loadOff(in, &p->in) ||
+            loadOff(in, &p->pos) || loadLong(in, &p->crc) ||
+            loadLong(in, &bits) || loadLong(in, &size) ||
+            p->out <= last || bits > 7 || size > GZ_WSIZE ||
+            (z_off_t)size > p->out || p->pos < s->start)
+            goto done;
+        p->bits = (int)bits;
+        p->size = (uInt)size;
+        p->window = Z_NULL;
+        if (size) {
+            p->window = (Byte*)ALLOC(p->size);
+            if (p->window == Z_NULL) {
+                err = Z_MEM_ERROR;
+                goto done;
+            }
+            if (fread(p->window, 1, p->size, in) != p->size) {
+                TRYFREE(p->window);
+                goto done;
+            }
+        }
+        last = p->out;
+        s->npoints++;
+    }
+    s->span = span;
+    err = Z_OK;
+
+  done:
+    fclose(in);
+    if (err != Z_OK) {
+        /* leave no partial index behind */
+        while (s->npoints) {
+            s->npoints--;
+            TRYFREE(s->points[s->npoints].window);
+        }
+    }
+    return err;
+}
+
 /* ===========================================================================
    Outputs a long in LSB order to the given file
 */
@@ -928,6 +1583,49 @@ local void putLong (file, x)
     }
 }
 
+/* ===========================================================================
+   Outputs a z_off_t in LSB order, in 8 bytes, to the given file
+*/
+local void putOff (file, x)
+    FILE *file;
+    z_off_t x;
+{
+    putLong(file, (uLong)(x & 0xffffffffL));
+    putLong(file, (uLong)((x >> 16) >> 16));
+}
+
+/* ===========================================================================
+   Reads a long in LSB order from the given file. Returns -1 at end of file.
+*/
+local int loadLong (file, x)
+    FILE *file;
+    uLong *x;
+{
+    Byte buf[4];
+
+    if (fread(buf, 1, 4, file) != 4) return -1;
+    *x = (uLong)buf[0] + ((uLong)buf[1] << 8) +
+         ((uLong)buf[2] << 16) + ((uLong)buf[3] << 24);
+    return 0;
+}
+
+/* ===========================================================================
+   Reads a z_off_t written by putOff from the given file. Returns -1 at end
+   of file or if the value does not fit in a z_off_t.
+*/
+local int loadOff (file, x)
+    FILE *file;
+    z_off_t *x;
+{
+    uLong lo, hi;
+
+    if (loadLong(file, &lo) || loadLong(file, &hi)) return -1;
+    if (sizeof(z_off_t) < 8 ? hi || lo > 0x7fffffffUL : hi > 0x7fffffffUL)
+        return -1;
+    *x = (z_off_t)lo + (z_off_t)hi * 65536 * 65536;
+    return 0;
+}
+
 /* ===========================================================================
    Reads a long in LSB order from the given gz_stream. Sets z_err in case
    of error.
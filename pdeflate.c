@@ -0,0 +1,490 @@
+/* pdeflate.c -- parallel compression into a single zlib, gzip or raw stream
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ *
+ * The input is cut into blocks that are compressed by a pool of threads.
+ * Each block is compressed as raw deflate data, with the last window of
+ * input of the block before it as preset dictionary, so the compression
+ * ratio is nearly that of deflate on the whole input. All but the last
+ * block are ended with Z_SYNC_FLUSH, which leaves the deflate data on a
+ * byte boundary, so the compressed blocks can simply be concatenated. The
+ * check value of each block is computed by its thread and combined with
+ * crc32_combine() or adler32_combine() as the blocks are written in order.
+ *
+ * This file needs POSIX threads.
+ */
+
+/* @(#) $Id$ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "zutil.h"
+
+#ifndef NO_DUMMY_DECL
+struct internal_state {int dummy;}; /* for buggy compilers */
+#endif
+
+#ifndef PZ_BLOCK
+#  define PZ_BLOCK 131072L      /* default input block size */
+#endif
+
+#define ALLOC(size) malloc(size)
+#define TRYFREE(p) {if (p) free(p);}
+
+/* checksums (adler32.c and crc32.c) */
+uLong ZEXPORT adler32 OF((uLong adler, const Bytef *buf, uInt len));
+uLong ZEXPORT adler32_combine OF((uLong adler1, uLong adler2, z_off_t len2));
+uLong ZEXPORT crc32 OF((uLong crc, const Bytef *buf, uInt len));
+uLong ZEXPORT crc32_combine OF((uLong crc1, uLong crc2, z_off_t len2));
+
+/* One block of input and, once done, its compressed data */
+typedef struct pz_job {
+    struct pz_job *next;    /* next job to compress */
+    struct pz_job *after;   /* next job to write */
+    Bytef   *dict;          /* end of the previous block's input */
+    uInt    dictlen;
+    Bytef   *in;            /* input, block bytes allocated */
+    uInt    len;
+    Bytef   *out;           /* compressed data */
+    uLong   outlen;
+    uLong   check;          /* crc32 or adler32 of the input */
+    int     last;           /* true for the block that ends the stream */
+    int     done;           /* compressed, or failed */
+    int     err;            /* Z_OK or the error compressing it */
+} pz_job;
+
+typedef struct pz_stream {
+    pz_out_func out;        /* where the compressed data goes */
+    voidp   opaque;
+    int     level;
+    int     wbits;          /* log2 of the window size */
+    int     wrap;           /* 0 raw, 1 zlib, 2 gzip */
+    uInt    block;          /* input block size */
+    int     nthreads;
+    pthread_t *threads;
+    pthread_mutex_t lock;   /* protects the lists, done and stop */
+    pthread_cond_t  work;   /* signalled when a job is queued, or at stop */
+    pthread_cond_t  ready;  /* signalled when a job is done */
+    pz_job  *todo;          /* jobs to compress, first in first out */
+    pz_job  *todo_tail;
+    pz_job  *first;         /* jobs to write, in order */
+    pz_job  *first_tail;
+    int     queued;         /* number of jobs in first */
+    int     stop;           /* tells the threads to exit */
+    pz_job  *cur;           /* block being filled by pzwrite */
+    uLong   check;          /* check value of all the data written */
+    uLong   total;          /* uncompressed length, modulo 2^32 */
+    int     err;            /* first error, or Z_OK */
+} pz_stream;
+
+local pz_job *new_job  OF((pz_stream *s, pz_job *prev));
+local void   free_job  OF((pz_job *job));
+local void   compress_job OF((pz_stream *s, z_streamp strm, pz_job *job));
+local void   *worker   OF((void *arg));
+local void   submit    OF((pz_stream *s, pz_job *job));
+local void   write_jobs OF((pz_stream *s, int wait));
+local void   put       OF((pz_stream *s, const Bytef *buf, unsigned len));
+local void   put_long  OF((pz_stream *s, uLong x, int lsb));
+local int    destroy   OF((pz_stream *s));
+
+/* ===========================================================================
+ * Make a job for the block that follows prev, or for the first block when
+ * prev is null. The dictionary is a copy, so that prev can be freed once it
+ * is written, while this block may still be compressed.
+ */
+local pz_job *new_job(s, prev)
+    pz_stream *s;
+    pz_job *prev;
+{
+    pz_job *job;
+    uInt wsize = 1U << s->wbits;
+
+    job = (pz_job *)ALLOC(sizeof(pz_job));
+    if (job == Z_NULL) return Z_NULL;
+    zmemzero((voidp)job, sizeof(pz_job));
+    job->in = (Bytef *)ALLOC(s->block);
+    if (prev != Z_NULL) {
+        job->dictlen = prev->len < wsize ? prev->len : wsize;
+        job->dict = (Bytef *)ALLOC(job->dictlen);
+        if (job->dict != Z_NULL)
+            zmemcpy(job->dict, prev->in + prev->len - job->dictlen,
+                    job->dictlen);
+    }
+    if (job->in == Z_NULL || (prev != Z_NULL && job->dict == Z_NULL)) {
+        free_job(job);
+        return Z_NULL;
+    }
+    return job;
+}
+
+/* ========================================================================= */
+local void free_job(job)
+    pz_job *job;
+{
+    TRYFREE(job->dict);
+    TRYFREE(job->in);
+    TRYFREE(job->out);
+    free(job);
+}
+
+/* ===========================================================================
+ * Compress one block with strm, a raw deflate stream that was used for the
+ * previous block of this thread, if any.
+ */
+local void compress_job(s, strm, job)
+    pz_stream *s;
+    z_streamp strm;
+    pz_job *job;
+{
+    uLong size;
+    Bytef *grown;
+    int flush = job->last ? Z_FINISH : Z_SYNC_FLUSH;
+
+    job->check = s->wrap == 2 ? crc32(crc32(0L, Z_NULL, 0), job->in, job->len)
+                              : adler32(adler32(0L, Z_NULL, 0), job->in, job->len);
+    job->err = deflateReset(strm);
+    if (job->err == Z_OK && job->dictlen)
+        job->err = deflateSetDictionary(strm, job->dict, job->dictlen);
+    if (job->err != Z_OK) return;
+
+    /* deflateBound() plus room for the empty stored block of the flush */
+    size = deflateBound(strm, job->len) + 16;
+    job->out = (Bytef *)ALLOC(size);
+    if (job->out == Z_NULL) {
+        job->err = Z_MEM_ERROR;
+        return;
+    }
+    strm->next_in = job->in;
+    strm->avail_in = job->len;
+    strm->next_out = job->out;
+    strm->avail_out = (uInt)size;
+    for (;;) {
+        job->err = deflate(strm, flush);
+        if (job->err == Z_STREAM_ERROR) return;
+        if (strm->avail_out != 0) break;
+
+        /* not expected, but the bound is only an estimate */
+        grown = (Bytef *)ALLOC(size << 1);
+        if (grown == Z_NULL) {
+            job->err = Z_MEM_ERROR;
+            return;
+        }
+        zmemcpy(grown, job->out, (uInt)size);
+        free(job->out);
+        job->out = grown;
+        strm->next_out = job->out + size;
+        strm->avail_out = (uInt)size;
+        size <<= 1;
+    }
+    job->outlen = size - strm->avail_out;
+    job->err = Z_OK;
+}
+
+/* ===========================================================================
+ * Thread that compresses queued jobs until told to stop.
+ */
+local void *worker(arg)
+    void *arg;
+{
+    pz_stream *s = (pz_stream *)arg;
+    z_stream strm;
+    pz_job *job;
+    int ret;
+
+    strm.zalloc = (alloc_func)0;
+    strm.zfree = (free_func)0;
+    strm.opaque = (voidpf)0;
+    ret = deflateInit2(&strm, s->level, Z_DEFLATED, -s->wbits,
+                       DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+    for (;;) {
+        pthread_mutex_lock(&s->lock);
+        while (s->todo == Z_NULL && !s->stop)
+            pthread_cond_wait(&s->work, &s->lock);
+        job = s->todo;
+        if (job == Z_NULL) {
+            pthread_mutex_unlock(&s->lock);
+            break;
+        }
+        s->todo = job->next;
+        pthread_mutex_unlock(&s->lock);
+
+        if (ret == Z_OK)
+            compress_job(s, &strm, job);
+        else
+            job->err = ret;
+
+        pthread_mutex_lock(&s->lock);
+        job->done = 1;
+        pthread_cond_broadcast(&s->ready);
+        pthread_mutex_unlock(&s->lock);
+    }
+    if (ret == Z_OK)
+        deflateEnd(&strm);
+    return Z_NULL;
+}
+
+/* ===========================================================================
+ * Queue a filled block for compression and writing.
+ */
+local void submit(s, job)
+    pz_stream *s;
+    pz_job *job;
+{
+    pthread_mutex_lock(&s->lock);
+    if (s->todo == Z_NULL)
+        s->todo = job;
+    else
+        s->todo_tail->next = job;
+    s->todo_tail = job;
+    if (s->first == Z_NULL)
+        s->first = job;
+    else
+        s->first_tail->after = job;
+    s->first_tail = job;
+    s->queued++;
+    pthread_cond_signal(&s->work);
+    pthread_mutex_unlock(&s->lock);
+}
+
+/* ===========================================================================
+ * Write the compressed blocks that are done, in order. If wait is true,
+ * wait until the oldest one is done and write at least that one; if wait is
+ * 2, wait for all of them.
+ */
+local void write_jobs(s, wait)
+    pz_stream *s;
+    int wait;
+{
+    pz_job *job;
+
+    for (;;) {
+        pthread_mutex_lock(&s->lock);
+        job = s->first;
+        if (job != Z_NULL && !job->done && wait)
+            while (!job->done)
+                pthread_cond_wait(&s->ready, &s->lock);
+        if (job == Z_NULL || !job->done) {
+            pthread_mutex_unlock(&s->lock);
+            return;
+        }
+        s->first = job->after;
+        s->queued--;
+        pthread_mutex_unlock(&s->lock);
+
+        if (job->err != Z_OK && s->err == Z_OK)
+            s->err = job->err;
+        if (s->err == Z_OK) {
+            put(s, job->out, (unsigned)job->outlen);
+            s->check = s->wrap == 2 ?
+                crc32_combine(s->check, job->check, (z_off_t)job->len) :
+                adler32_combine(s->check, job->check, (z_off_t)job->len);
+            s->total += job->len;
+        }
+        free_job(job);
+        if (wait == 1) wait = 0;
+    }
+}
+
+/* ===========================================================================
+ * Hand compressed data to the application, unless there was an error.
+ */
+local void put(s, buf, len)
+    pz_stream *s;
+    const Bytef *buf;
+    unsigned len;
+{
+    if (s->err == Z_OK && len != 0 && s->out(s->opaque, buf, len) != 0)
+        s->err = Z_ERRNO;
+}
+
+/* ===========================================================================
+ * Write a 32-bit value, least significant byte first if lsb is true.
+ */
+local void put_long(s, x, lsb)
+    pz_stream *s;
+    uLong x;
+    int lsb;
+{
+    Byte buf[4];
+    int n;
+
+    for (n = 0; n < 4; n++) {
+        buf[lsb ? n : 3 - n] = (Byte)(x & 0xff);
+        x >>= 8;
+    }
+    put(s, buf, 4);
+}
+
+/* ========================================================================= */
+pzStream ZEXPORT pzopen(out, opaque, level, windowBits, threads, blockSize)
+    pz_out_func out;
+    voidp opaque;
+    int level;
+    int windowBits;
+    int threads;
+    uLong blockSize;
+{
+    pz_stream *s;
+    Byte head[10];
+    uInt header;
+    int n;
+
+    if (level == Z_DEFAULT_COMPRESSION) level = 6;
+    if (out == Z_NULL || level < 0 || level > 9) return Z_NULL;
+
+    s = (pz_stream *)ALLOC(sizeof(pz_stream));
+    if (s == Z_NULL) return Z_NULL;
+    zmemzero((voidp)s, sizeof(pz_stream));
+    s->out = out;
+    s->opaque = opaque;
+    s->level = level;
+    s->wrap = 1;
+    if (windowBits < 0) {
+        s->wrap = 0;
+        windowBits = -windowBits;
+    }
+    else if (windowBits > 15) {
+        s->wrap = 2;
+        windowBits -= 16;
+    }
+    if (windowBits == 8) windowBits = 9;   /* as deflateInit2() does */
+    if (windowBits < 9 || windowBits > 15) {
+        free(s);
+        return Z_NULL;
+    }
+    s->wbits = windowBits;
+    if (blockSize == 0) blockSize = PZ_BLOCK;
+    if (blockSize < (1UL << windowBits)) blockSize = 1UL << windowBits;
+    s->block = (uInt)blockSize;
+    if (threads < 1) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1) threads = 1;
+    s->check = s->wrap == 2 ? crc32(0L, Z_NULL, 0) : adler32(0L, Z_NULL, 0);
+
+    s->threads = (pthread_t *)ALLOC(threads * sizeof(pthread_t));
+    s->cur = new_job(s, Z_NULL);
+    if (s->threads == Z_NULL || s->cur == Z_NULL) {
+        destroy(s);
+        return Z_NULL;
+    }
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->work, NULL);
+    pthread_cond_init(&s->ready, NULL);
+    for (n = 0; n < threads; n++) {
+        if (pthread_create(s->threads + n, NULL, worker, s) != 0)
+            break;
+        s->nthreads++;
+    }
+    if (s->nthreads == 0) {
+        destroy(s);
+        return Z_NULL;
+    }
+
+    /* the header; the deflate data has no dictionary of its own */
+    if (s->wrap == 2) {
+        head[0] = 0x1f; head[1] = 0x8b; head[2] = Z_DEFLATED;
+        head[3] = head[4] = head[5] = head[6] = head[7] = 0;
+        head[8] = level == 9 ? 2 : (level == 1 ? 4 : 0);
+        head[9] = OS_CODE;
+        put(s, head, 10);
+    }
+    else if (s->wrap == 1) {
+        header = (Z_DEFLATED + ((s->wbits-8)<<4)) << 8;
+        header |= (level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6;
+        header += 31 - (header % 31);
+        head[0] = (Byte)(header >> 8);
+        head[1] = (Byte)(header & 0xff);
+        put(s, head, 2);
+    }
+    if (s->err != Z_OK) {
+        destroy(s);
+        return Z_NULL;
+    }
+    return (pzStream)s;
+}
+
+/* ===========================================================================
+ * Keep at most two blocks per thread in flight, to bound the memory used.
+ */
+int ZEXPORT pzwrite(pz, buf, len)
+    pzStream pz;
+    voidpc buf;
+    unsigned len;
+{
+    pz_stream *s = (pz_stream *)pz;
+    const Bytef *next = (const Bytef *)buf;
+    unsigned left = len;
+    uInt copy;
+    pz_job *job;
+
+    if (s == Z_NULL) return 0;
+    while (left != 0 && s->err == Z_OK) {
+        copy = s->block - s->cur->len;
+        if (copy > left) copy = left;
+        zmemcpy(s->cur->in + s->cur->len, next, copy);
+        s->cur->len += copy;
+        next += copy;
+        left -= copy;
+        if (s->cur->len == s->block) {
+            job = new_job(s, s->cur);
+            if (job == Z_NULL) {
+                s->err = Z_MEM_ERROR;
+                break;
+            }
+            submit(s, s->cur);
+            s->cur = job;
+            write_jobs(s, s->queued >= 2 * s->nthreads);
+        }
+    }
+    return s->err == Z_OK ? (int)len : 0;
+}
+
+/* ========================================================================= */
+int ZEXPORT pzclose(pz)
+    pzStream pz;
+{
+    pz_stream *s = (pz_stream *)pz;
+
+    if (s == Z_NULL) return Z_STREAM_ERROR;
+    s->cur->last = 1;
+    submit(s, s->cur);
+    s->cur = Z_NULL;
+    write_jobs(s, 2);
+    if (s->wrap == 2) {
+        put_long(s, s->check, 1);
+        put_long(s, s->total, 1);
+    }
+    else if (s->wrap == 1)
+        put_long(s, s->check, 0);
+    return destroy(s);
+}
+
+/* ===========================================================================
+ * Stop the threads, free everything and return the first error, if any.
+ */
+local int destroy(s)
+    pz_stream *s;
+{
+    int n, err;
+    pz_job *job;
+
+    if (s->nthreads) {
+        pthread_mutex_lock(&s->lock);
+        s->stop = 1;
+        pthread_cond_broadcast(&s->work);
+        pthread_mutex_unlock(&s->lock);
+        for (n = 0; n < s->nthreads; n++)
+            pthread_join(s->threads[n], NULL);
+        pthread_cond_destroy(&s->ready);
+        pthread_cond_destroy(&s->work);
+        pthread_mutex_destroy(&s->lock);
+    }
+    while ((job = s->first) != Z_NULL) {
+        s->first = job->after;
+        free_job(job);
+    }
+    if (s->cur != Z_NULL) free_job(s->cur);
+    TRYFREE(s->threads);
+    err = s->err;
+    free(s);
+    return err;
+}
@@ -46,9 +46,6 @@
 #define MAX_BL_BITS 7
 /* Bit length codes must not exceed MAX_BL_BITS bits */
 
-#define END_BLOCK 256
-/* end of block literal code */
-
 #define REP_3_6      16
 /* repeat previous bit length 3-6 times (2 bits of repeat count) */
 
@@ -73,10 +70,8 @@ local const uch bl_order[BL_CODES]
  * probability, to avoid transmitting the lengths for unused bit length codes.
  */
 
-#define Buf_size (8 * 2*sizeof(char))
-/* Number of bits used within bi_buf. (bi_buf might be implemented on
- * more than 16 bits on some systems.)
- */
+#define Buf_size BITBUF_BITS
+/* Number of bits used within bi_buf, see bitbuf in deflate.h. */
 
 /* ===========================================================================
  * Local data. These are initialized only once.
@@ -135,6 +130,9 @@ local static_tree_desc  static_d_desc =
 local static_tree_desc  static_bl_desc =
 {(const ct_data *)0, extra_blbits, 0,   BL_CODES, MAX_BL_BITS};
 
+const quick_codes _tr_quick =
+{static_ltree, static_dtree, base_length, base_dist, extra_lbits, extra_dbits};
+
 /* ===========================================================================
  * Local (static) routines in this file.
  */
@@ -183,32 +181,35 @@ local void gen_trees_header OF((void));
 }
 
 /* ===========================================================================
- * Send a value on a given number of bits.
- * IN assertion: length <= 16 and value fits in length bits.
+ * Send a value on a given number of bits. bi_buf is written out only when
+ * it is full, so there is one branch per code in the common case.
+ * IN assertion: length <= 28 and value fits in length bits. Up to 28 bits
+ * are sent at once, for a length or distance code with its extra bits.
  */
 #ifdef DEBUG
-local void send_bits      OF((deflate_state *s, int value, int length));
+local void send_bits      OF((deflate_state *s, ulg value, int length));
 
 local void send_bits(s, value, length)
     deflate_state *s;
-    int value;  /* value to send */
+    ulg value;  /* value to send */
     int length; /* number of bits */
 {
-    Tracevv((stderr," l %2d v %4x ", length, value));
-    Assert(length > 0 && length <= 15, "invalid length");
+    Tracevv((stderr," l %2d v %4lx ", length, value));
+    Assert(length > 0 && length <= 28, "invalid length");
+    Assert(value < (1UL << length), "value too large");
     s->bits_sent += (ulg)length;
 
-    /* If not enough room in bi_buf, use (valid) bits from bi_buf and
-     * (16 - bi_valid) bits from value, leaving (width - (16-bi_valid))
-     * unused bits in value.
+    /* If value fills bi_buf, complete bi_buf with (Buf_size - bi_valid)
+     * bits from value and leave the rest of value in bi_buf. bi_valid is
+     * thus always less than Buf_size, so that no shift is by Buf_size.
      */
-    if (s->bi_valid > (int)Buf_size - length) {
-        s->bi_buf |= (value << s->bi_valid);
-        put_short(s, s->bi_buf);
-        s->bi_buf = (ush)value >> (Buf_size - s->bi_valid);
+    if (s->bi_valid >= (int)Buf_size - length) {
+        s->bi_buf |= (bitbuf)value << s->bi_valid;
+        put_bitbuf(s, s->bi_buf);
+        s->bi_buf = (bitbuf)value >> (Buf_size - s->bi_valid);
         s->bi_valid += length - Buf_size;
     } else {
-        s->bi_buf |= value << s->bi_valid;
+        s->bi_buf |= (bitbuf)value << s->bi_valid;
         s->bi_valid += length;
     }
 }
@@ -216,19 +217,27 @@ local void send_bits(s, value, length)
 
 #define send_bits(s, value, length) \
 { int len = length;\
-  if (s->bi_valid > (int)Buf_size - len) {\
-    int val = value;\
-    s->bi_buf |= (val << s->bi_valid);\
-    put_short(s, s->bi_buf);\
-    s->bi_buf = (ush)val >> (Buf_size - s->bi_valid);\
+  bitbuf val = (bitbuf)(value);\
+  if (s->bi_valid >= (int)Buf_size - len) {\
+    s->bi_buf |= val << s->bi_valid;\
+    put_bitbuf(s, s->bi_buf);\
+    s->bi_buf = val >> (Buf_size - s->bi_valid);\
     s->bi_valid += len - Buf_size;\
   } else {\
-    s->bi_buf |= (value) << s->bi_valid;\
+    s->bi_buf |= val << s->bi_valid;\
     s->bi_valid += len;\
   }\
 }
 #endif /* DEBUG */
 
+/* ===========================================================================
+ * Send code c of the given tree followed by its extra bits, in one call.
+ * c, tree and extra must not have side effects.
+ */
+#define send_code_extra(s, c, tree, value, extra) \
+    send_bits(s, (ulg)tree[c].Code | ((ulg)(value) << tree[c].Len), \
+              tree[c].Len + (extra))
+
 
 /* the arguments must not have side effects */
 
@@ -914,6 +923,19 @@ void _tr_align(s)
     s->last_eob_len = 7;
 }
 
+/* ===========================================================================
+ * Write out the bits of the last block, which deflate_quick() has sent
+ * itself, up to the byte boundary.
+ */
+void _tr_windup(s)
+    deflate_state *s;
+{
+    bi_windup(s);
+#ifdef DEBUG
+    s->compressed_len = (s->compressed_len + 7) & (ulg)~7L;
+#endif
+}
+
 /* ===========================================================================
  * Determine the best encoding for the current block: dynamic trees, static
  * trees or store, and output the encoded block to the zip file.
@@ -1089,22 +1111,22 @@ local void compress_block(s, ltree, dtree)
         } else {
             /* Here, lc is the match length - MIN_MATCH */
             code = _length_code[lc];
-            send_code(s, code+LITERALS+1, ltree); /* send the length code */
             extra = extra_lbits[code];
-            if (extra != 0) {
-                lc -= base_length[code];
-                send_bits(s, lc, extra);       /* send the extra length bits */
-            }
+            /* lc - base_length[code] is not 0 for length 258, which has
+             * no extra bits
+             */
+            lc = extra != 0 ? lc - base_length[code] : 0;
+            /* send the length code and the extra length bits */
+            send_code_extra(s, code+LITERALS+1, ltree, lc, extra);
+
             dist--; /* dist is now the match distance - 1 */
             code = d_code(dist);
             Assert (code < D_CODES, "bad d_code");
 
-            send_code(s, code, dtree);       /* send the distance code */
             extra = extra_dbits[code];
-            if (extra != 0) {
-                dist -= base_dist[code];
-                send_bits(s, dist, extra);   /* send the extra distance bits */
-            }
+            dist -= base_dist[code];
+            /* send the distance code and the extra distance bits */
+            send_code_extra(s, code, dtree, dist, extra);
         } /* literal or match pair ? */
 
         /* Check that the overlay between pending_buf and d_buf+l_buf is ok: */
@@ -1161,11 +1183,7 @@ local unsigned bi_reverse(code, len)
 local void bi_flush(s)
     deflate_state *s;
 {
-    if (s->bi_valid == 16) {
-        put_short(s, s->bi_buf);
-        s->bi_buf = 0;
-        s->bi_valid = 0;
-    } else if (s->bi_valid >= 8) {
+    while (s->bi_valid >= 8) {
         put_byte(s, (Byte)s->bi_buf);
         s->bi_buf >>= 8;
         s->bi_valid -= 8;
@@ -1178,10 +1196,10 @@ local void bi_flush(s)
 local void bi_windup(s)
     deflate_state *s;
 {
-    if (s->bi_valid > 8) {
-        put_short(s, s->bi_buf);
-    } else if (s->bi_valid > 0) {
+    while (s->bi_valid > 0) {
         put_byte(s, (Byte)s->bi_buf);
+        s->bi_buf >>= 8;
+        s->bi_valid -= 8;
     }
     s->bi_buf = 0;
     s->bi_valid = 0;
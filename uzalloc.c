@@ -0,0 +1,334 @@
+/*
+   uzalloc, an optional slab allocator for uzinflate.  Needs POSIX threads
+   and mmap(); built in with make -f Makefile.inflate UZALLOC=1.
+
+   Distributed under the same terms as uzinflate.c, see the notice there.
+*/
+
+/*
+   An inflate stream allocates just a few kinds of objects: its state, a
+   power of two sized window, and a hibernation record.  With many streams
+   coming and going these all end up in malloc, with its locks and its
+   fragmentation.  This allocator instead serves them from size classes in
+   2M slabs:
+
+   - Size classes go in steps of a quarter power of two from 256 bytes to
+     56K, so the windows fit exactly and the state wastes only a few
+     percent.  Anything larger gets a mapping of its own.
+
+   - Every slab is aligned to its size and starts with a header saying what
+     class it holds, so uzFree() finds the class from the address alone.
+
+   - Each thread keeps up to CACHE_MAX free objects per class and refills
+     or drains in batches from a shared depot, which is the only place a
+     lock is taken.  Slabs are carved lazily with a bump pointer, so
+     memory is not touched before it is handed out.
+
+   - With UZ_ALLOC_HUGEPAGES slabs are backed by huge pages when the system
+     has them.  With UZ_ALLOC_NUMA_LOCAL there is a depot per NUMA node.
+     Slabs are carved, and thus first touched, by a thread on that node,
+     and objects always return to the depot of the node they came from.
+
+   Slabs are never returned to the system; the objects are recycled.
+*/
+
+#define _GNU_SOURCE
+#include "uzlib.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#define SLAB_SHIFT 21
+#define SLAB_SIZE ((size_t)1 << SLAB_SHIFT)
+#define SLAB_HEAD 64		/* header space, keeps objects cache aligned */
+#define NCLASS 32		/* eight powers of two, four steps each */
+#define BIG NCLASS		/* class of a block that has its own mapping */
+#define MAX_NODES 8
+#define CACHE_MAX 32		/* free objects kept per class and thread */
+#define BATCH 8			/* objects moved between cache and depot */
+
+/* Header at the start of every slab (and of every big block) */
+struct slab {
+	unsigned cls;		/* size class, or BIG */
+	unsigned node;		/* depot the objects return to */
+	size_t len;		/* length of the mapping */
+};
+
+struct freeobj {
+	struct freeobj *next;
+};
+
+/* Shared free objects of one class on one node */
+struct depot {
+	pthread_mutex_t lock;
+	struct freeobj *free;	/* returned objects */
+	char *bump;		/* uncarved part of the newest slab */
+	char *end;
+};
+
+/* Free objects of one class cached by one thread */
+struct cache {
+	struct freeobj *free;
+	unsigned count;
+};
+
+static int config;		/* UZ_ALLOC_* flags */
+static int started;		/* set by the first allocation */
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static pthread_key_t exitkey;
+static struct depot depots[MAX_NODES][NCLASS];
+static __thread struct cache caches[NCLASS];
+static __thread int registered;	/* exitkey set for this thread */
+
+static void flushcaches (void *unused);
+
+static void
+setup(void)
+{
+	unsigned n, c;
+
+	for (n = 0; n < MAX_NODES; n++)
+		for (c = 0; c < NCLASS; c++)
+			pthread_mutex_init(&depots[n][c].lock, NULL);
+	pthread_key_create(&exitkey, flushcaches);
+	started = 1;
+}
+
+int
+uzAllocConfig(int flags)
+{
+	if (started || (flags & ~(UZ_ALLOC_HUGEPAGES | UZ_ALLOC_NUMA_LOCAL)))
+		return Z_STREAM_ERROR;
+	config = flags;
+	return Z_OK;
+}
+
+/* Object size of class cls */
+static size_t
+classsize(unsigned cls)
+{
+	size_t base = (size_t)256 << (cls >> 2);
+
+	return base + (base >> 2) * (cls & 3);
+}
+
+/* Smallest class holding n bytes, or BIG */
+static unsigned
+sizeclass(size_t n)
+{
+	unsigned cls;
+
+	for (cls = 0; cls < NCLASS; cls++)
+		if (classsize(cls) >= n)
+			break;
+	return cls;
+}
+
+/* NUMA node of the calling thread, or 0 when not placing by node */
+static unsigned
+localnode(void)
+{
+#ifdef SYS_getcpu
+	unsigned cpu, node;
+
+	if ((config & UZ_ALLOC_NUMA_LOCAL) && syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+		return node % MAX_NODES;
+#endif
+	return 0;
+}
+
+/* Map *len bytes (a multiple of the page size) aligned to SLAB_SIZE; *len
+   is rounded up to the length actually mapped, which munmap() needs */
+static void *
+mapaligned(size_t *lenp)
+{
+	char *p, *a;
+	size_t head, len = *lenp;
+
+#ifdef MAP_HUGETLB
+	if (config & UZ_ALLOC_HUGEPAGES) {
+		/* huge page mappings come aligned to the huge page size */
+		len = (len + SLAB_SIZE - 1) & ~(SLAB_SIZE - 1);
+		p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED && ((uintptr_t)p & (SLAB_SIZE - 1)) == 0) {
+			*lenp = len;
+			return p;
+		}
+		if (p != MAP_FAILED)
+			munmap(p, len);
+		len = *lenp;
+	}
+#endif
+	p = mmap(NULL, len + SLAB_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+	a = (char *)(((uintptr_t)p + SLAB_SIZE - 1) & ~(uintptr_t)(SLAB_SIZE - 1));
+	head = (size_t)(a - p);
+	if (head)
+		munmap(p, head);
+	munmap(a + len, SLAB_SIZE - head);
+#ifdef MADV_HUGEPAGE
+	if (config & UZ_ALLOC_HUGEPAGES)
+		madvise(a, len, MADV_HUGEPAGE);
+#endif
+	return a;
+}
+
+static void *
+bigalloc(size_t n)
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t len = (n + SLAB_HEAD + page - 1) & ~(page - 1);
+	struct slab *s;
+
+	s = mapaligned(&len);
+	if (s == NULL)
+		return NULL;
+	s->cls = BIG;
+	s->node = 0;
+	s->len = len;
+	return (char *)s + SLAB_HEAD;
+}
+
+/* Move up to BATCH objects of class cls from depot d into the cache */
+static int
+refill(struct cache *c, struct depot *d, unsigned cls, unsigned node)
+{
+	size_t size = classsize(cls), len;
+	struct freeobj *o;
+	struct slab *s;
+	unsigned n;
+
+	pthread_mutex_lock(&d->lock);
+	for (n = 0; n < BATCH; n++) {
+		if (d->free != NULL) {
+			o = d->free;
+			d->free = o->next;
+		} else {
+			if (d->bump == NULL || (size_t)(d->end - d->bump) < size) {
+				len = SLAB_SIZE;
+				s = mapaligned(&len);
+				if (s == NULL)
+					break;
+				s->cls = cls;
+				s->node = node;
+				s->len = SLAB_SIZE;
+				d->bump = (char *)s + SLAB_HEAD;
+				d->end = (char *)s + SLAB_SIZE;
+			}
+			o = (struct freeobj *)d->bump;
+			d->bump += size;
+		}
+		o->next = c->free;
+		c->free = o;
+		c->count++;
+	}
+	pthread_mutex_unlock(&d->lock);
+	return n != 0;
+}
+
+/* Hand objects back to their depots, down to CACHE_MAX - BATCH or all */
+static void
+drain(struct cache *c, int all)
+{
+	struct freeobj *o;
+	struct slab *s;
+	struct depot *d;
+
+	while (c->free != NULL && (all || c->count > CACHE_MAX - BATCH)) {
+		o = c->free;
+		c->free = o->next;
+		c->count--;
+		s = (struct slab *)((uintptr_t)o & ~(uintptr_t)(SLAB_SIZE - 1));
+		d = &depots[s->node][s->cls];
+		pthread_mutex_lock(&d->lock);
+		o->next = d->free;
+		d->free = o;
+		pthread_mutex_unlock(&d->lock);
+	}
+}
+
+/* Thread exit, nothing cached may be lost */
+static void
+flushcaches(void *unused)
+{
+	unsigned cls;
+
+	(void)unused;
+	for (cls = 0; cls < NCLASS; cls++)
+		drain(&caches[cls], 1);
+}
+
+/* The calling thread's caches, arranging for them to be flushed on exit */
+static struct cache *
+threadcaches(void)
+{
+	if (!registered) {
+		pthread_once(&once, setup);
+		pthread_setspecific(exitkey, caches);
+		registered = 1;
+	}
+	return caches;
+}
+
+voidp
+uzAlloc(voidp opaque, uInt items, uInt size)
+{
+	size_t n = (size_t)items * size;
+	unsigned cls, node;
+	struct cache *c;
+	struct freeobj *o;
+
+	(void)opaque;
+	c = threadcaches();
+	cls = sizeclass(n);
+	if (cls == BIG)
+		return bigalloc(n);
+	c += cls;
+	if (c->free == NULL) {
+		node = localnode();
+		if (!refill(c, &depots[node][cls], cls, node))
+			return Z_NULL;
+	}
+	o = c->free;
+	c->free = o->next;
+	c->count--;
+	return o;
+}
+
+void
+uzFree(voidp opaque, voidp address)
+{
+	struct slab *s;
+	struct cache *c;
+	struct freeobj *o = address;
+
+	(void)opaque;
+	if (o == Z_NULL)
+		return;
+	s = (struct slab *)((uintptr_t)o & ~(uintptr_t)(SLAB_SIZE - 1));
+	if (s->cls == BIG) {
+		munmap(s, s->len);
+		return;
+	}
+
+	/* memory of another node goes straight home */
+	if ((config & UZ_ALLOC_NUMA_LOCAL) && s->node != localnode()) {
+		pthread_mutex_lock(&depots[s->node][s->cls].lock);
+		o->next = depots[s->node][s->cls].free;
+		depots[s->node][s->cls].free = o;
+		pthread_mutex_unlock(&depots[s->node][s->cls].lock);
+		return;
+	}
+	c = threadcaches() + s->cls;
+	o->next = c->free;
+	c->free = o;
+	c->count++;
+	if (c->count > CACHE_MAX)
+		drain(c, 0);
+}
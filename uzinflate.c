@@ -46,6 +46,33 @@ const char inflate_copyright[] = " inflate 1.2.3 Copyright 1995-2005 Mark Adler
 #include <stdlib.h>
 #include <string.h>
 
+/*
+   Build configuration.  A service that only ever sees one kind of stream
+   can compile out the runtime tests for the others, which sit on every
+   path out of inflate():
+
+     UZ_WRAP=0      raw deflate only, no zlib header or trailer
+     UZ_WRAP=1      zlib streams only
+     UZ_CHECK=0     do not compute or verify the Adler-32 check value; the
+                    trailer is still consumed and strm->adler stays at 1
+     UZ_WINDOW=0    keep no sliding window: each stream must be inflated
+                    with all its output in one call, as uncompress() does
+     MAX_WBITS=n    refuse streams asking for a window over 2^n bytes
+
+   Without UZ_WRAP the wrapper is chosen at run time as before.
+ */
+#ifdef UZ_WRAP
+#  define WRAP(state) UZ_WRAP
+#else
+#  define WRAP(state) ((state)->wrap)
+#endif
+#ifndef UZ_CHECK
+#  define UZ_CHECK 1
+#endif
+#ifndef UZ_WINDOW
+#  define UZ_WINDOW 1
+#endif
+
 #define BASE 65521UL		/* largest prime smaller than 65536 */
 #define NMAX 5552
 /* NMAX is the largest n such that 255n(n+1)/2 + (n+1)(BASE-1) <= 2^32-1 */
@@ -132,7 +159,8 @@ typedef enum {
 	DONE,			/* finished check, done -- remain here until reset */
 	BAD,			/* got a data error -- remain here until reset */
 	MEM,			/* got an inflate() memory error -- remain here until reset */
-	SYNC			/* looking for synchronization bytes to restart inflate() */
+	SYNC,			/* looking for synchronization bytes to restart inflate() */
+	SLEEP			/* hibernated, see struct inflate_sleeper */
 } inflate_mode;
 
 /*
@@ -156,6 +184,9 @@ typedef enum {
                 LIT -> LEN
     Process trailer:
         CHECK -> LENGTH -> DONE
+
+    Idle streams:
+        (any) -> SLEEP on inflateHibernate(), SLEEP -> (same) on inflateWake()
  */
 
 
@@ -175,6 +206,12 @@ struct inflate_state {
 	unsigned whave;		/* valid bytes in the window */
 	unsigned write;		/* window write index */
 	unsigned char *window;	/* allocated sliding window, if needed */
+	/* shared preset dictionary, logically preceding the window */
+	const Bytef *dict;	/* dictionary data, not owned */
+	unsigned dictlen;	/* usable dictionary bytes, zero once out of reach */
+	unsigned long dictid;	/* Adler-32 of the dictionary in use */
+	const z_dictionary *dicts;	/* dictionaries to look up on DICTID */
+	unsigned ndicts;	/* number of entries in dicts[] */
 	/* bit accumulator */
 	unsigned long hold;	/* input bit accumulator */
 	unsigned bits;		/* number of bits in "in" */
@@ -199,6 +236,18 @@ struct inflate_state {
 	code codes[ENOUGH];	/* space for code tables */
 };
 
+/* What is left of a stream after inflateHibernate(): the serialized state
+   in a single allocation of exactly the needed size.  mode must stay the
+   first member, it is how inflate() tells the two structures apart. */
+struct inflate_sleeper {
+	inflate_mode mode;	/* always SLEEP */
+	const z_dictionary *dicts;	/* kept from inflateUseDictionaries() */
+	unsigned ndicts;	/* entries in dicts[] */
+	z_dictionary dict;	/* part of the dictionary still in reach */
+	uInt len;		/* bytes used in saved[] */
+	Bytef saved[1];		/* inflateSerialize() output, len bytes */
+};
+
 /* function prototypes */
 
 static uLong adler32 (uLong adler, const Bytef * buf, uInt len);
@@ -207,11 +256,18 @@ static int inflate_table (codetype type, unsigned short *lens, unsigned codes, c
 static void inflate_fast (z_streamp strm, unsigned start);
 
 static void fixedtables (struct inflate_state *state);
+static const z_dictionary *finddict (struct inflate_state *state, uLong id);
+static void usedict (struct inflate_state *state, const z_dictionary *dict);
+#if UZ_WINDOW
 static int updatewindow (z_streamp strm, unsigned out);
-static int inflateReset(z_streamp strm);
+#endif
+static int inflateResetKeep(z_streamp strm);
 
 static int inflateInit2_(z_streamp strm, int windowBits);
 
+/* true if strm was put to sleep by inflateHibernate() */
+#define ASLEEP(strm) (*(inflate_mode *)(strm)->state == SLEEP)
+
 
 
 #  define Assert(cond,msg)
@@ -227,6 +283,7 @@ static int inflateInit2_(z_streamp strm, int windowBits);
 #ifndef DEF_WBITS
 #  define DEF_WBITS MAX_WBITS
 #endif
+#define MIN_WBITS 8		/* smallest window, 256 bytes */
 /* default windowBits for decompression. MAX_WBITS is for compression only */
 
 #define ZALLOC(strm, items, size) \
@@ -241,7 +298,7 @@ static int inflateInit2_(z_streamp strm, int windowBits);
 
 
 static int
-inflateReset(z_streamp strm)
+inflateResetKeep(z_streamp strm)
 {
 	struct inflate_state *state;
 
@@ -254,17 +311,67 @@ inflateReset(z_streamp strm)
 	state->mode = HEAD;
 	state->last = 0;
 	state->havedict = 0;
+	state->dict = Z_NULL;
+	state->dictlen = 0;
+	state->dictid = 0;
 	state->dmax = 32768U;
-	state->wsize = 0;
+	if (state->window == Z_NULL)
+		state->wsize = 0;	/* else keep it for the next stream */
 	state->whave = 0;
 	state->write = 0;
 	state->hold = 0;
 	state->bits = 0;
+	state->length = 0;
+	state->offset = 0;
+	state->extra = 0;
+	state->ncode = 0;
+	state->nlen = 0;
+	state->ndist = 0;
+	state->have = 0;
 	state->lencode = state->distcode = state->next = state->codes;
 	Tracev((stderr, "inflate: reset\n"));
 	return Z_OK;
 }
 
+int
+inflateReset(z_streamp strm)
+{
+	struct inflate_state *state;
+	int ret;
+
+	if (strm == Z_NULL || strm->state == Z_NULL)
+		return Z_STREAM_ERROR;
+	if (ASLEEP(strm)) {
+		ret = inflateWake(strm);
+		if (ret != Z_OK)
+			return ret;
+	}
+	state = (struct inflate_state *)strm->state;
+	state->wbits = DEF_WBITS;	/* undo narrowing by the last header */
+	return inflateResetKeep(strm);
+}
+
+/* Default allocation functions: the slab allocator when it is built in,
+   else malloc() and free() like zcalloc() and zcfree() of zlib */
+#ifdef UZ_ALLOC
+#  define zcalloc uzAlloc
+#  define zcfree uzFree
+#else
+static voidp
+zcalloc(voidp opaque, uInt items, uInt size)
+{
+	(void)opaque;
+	return malloc((size_t)items * size);
+}
+
+static void
+zcfree(voidp opaque, voidp ptr)
+{
+	(void)opaque;
+	free(ptr);
+}
+#endif
+
 static int
 inflateInit2_(z_streamp strm, int windowBits)
 {
@@ -274,10 +381,11 @@ inflateInit2_(z_streamp strm, int windowBits)
 		return Z_STREAM_ERROR;
 	strm->msg = Z_NULL;	/* in case we return an error */
 	if (strm->zalloc == (alloc_func) 0) {
-		return Z_MEM_ERROR;
+		strm->zalloc = zcalloc;
+		strm->opaque = (voidp) 0;
 	}
 	if (strm->zfree == (free_func) 0)
-		return Z_MEM_ERROR;
+		strm->zfree = zcfree;
 	state = (struct inflate_state *)
 	    ZALLOC(strm, 1, sizeof(struct inflate_state));
 	if (state == Z_NULL)
@@ -290,14 +398,16 @@ inflateInit2_(z_streamp strm, int windowBits)
 	} else {
 		state->wrap = (windowBits >> 4) + 1;
 	}
-	if (windowBits < 8 || windowBits > 15) {
+	if (windowBits < MIN_WBITS || windowBits > MAX_WBITS) {
 		ZFREE(strm, state);
 		strm->state = Z_NULL;
 		return Z_STREAM_ERROR;
 	}
 	state->wbits = (unsigned)windowBits;
 	state->window = Z_NULL;
-	return inflateReset(strm);
+	state->dicts = Z_NULL;
+	state->ndicts = 0;
+	return inflateResetKeep(strm);
 }
 
 int
@@ -414,10 +524,15 @@ fixedtables(struct inflate_state *state)
 /*
    Update the window with the last wsize (normally 32K) bytes written before
    returning.  If window does not exist yet, create it.  This is only called
-   when a window is already in use, or when output has been written during this
-   inflate call, but the end of the deflate stream has not been reached yet.
-   It is also called to create a window for dictionary data when a dictionary
-   is loaded.
+   when output has been written during this inflate call, or a window is
+   already in use, and the end of the deflate stream has not been reached yet.
+
+   The window starts out just large enough for the output so far and is
+   doubled as more arrives, up to 1 << wbits bytes, where wbits is what the
+   zlib header declared (or windowBits for raw inflate).  Short streams and
+   senders using small windows thus never cost a full 32K.  Until it has
+   reached its final size the window is never full, so it never wraps and
+   growing it is a plain copy of whave bytes.
 
    Providing output buffers larger than 32K to inflate() should provide a speed
    advantage, since only the last 32K of output is copied to the sliding window
@@ -425,31 +540,38 @@ fixedtables(struct inflate_state *state)
    output will fall in the output data, making match copies simpler and faster.
    The advantage may be dependent on the size of the processor's data caches.
  */
+#if UZ_WINDOW
 static int
 updatewindow (z_streamp strm, unsigned out)
 {
 	struct inflate_state *state;
-	unsigned copy, dist;
+	unsigned copy, dist, size;
+	unsigned char *window;
 
 	state = (struct inflate_state *)strm->state;
+	copy = out - strm->avail_out;
 
-	/* if it hasn't been done already, allocate space for the window */
-	if (state->window == Z_NULL) {
-		state->window = (unsigned char *)
-		    ZALLOC(strm, 1U << state->wbits, sizeof(unsigned char));
-		if (state->window == Z_NULL)
+	/* allocate or grow the window unless this output fits without filling it */
+	if (state->wsize < (1U << state->wbits) && copy >= state->wsize - state->whave) {
+		size = state->wsize ? state->wsize : 1U << MIN_WBITS;
+		while (size < (1U << state->wbits) && size - state->whave <= copy)
+			size <<= 1;
+		window = (unsigned char *)ZALLOC(strm, size, sizeof(unsigned char));
+		if (window == Z_NULL)
 			return 1;
-	}
-
-	/* if window not in use yet, initialize */
-	if (state->wsize == 0) {
-		state->wsize = 1U << state->wbits;
-		state->write = 0;
-		state->whave = 0;
+		if (state->wsize == 0)
+			state->whave = 0;
+		else
+			zmemcpy(window, state->window, state->whave);
+		if (state->window != Z_NULL)
+			ZFREE(strm, state->window);
+		state->window = window;
+		state->wsize = size;
+		state->write = state->whave;
+		Tracev((stderr, "inflate: window %u bytes\n", size));
 	}
 
 	/* copy state->wsize or less output bytes into the circular window */
-	copy = out - strm->avail_out;
 	if (copy >= state->wsize) {
 		zmemcpy(state->window, strm->next_out - state->wsize, state->wsize);
 		state->write = 0;
@@ -472,8 +594,15 @@ updatewindow (z_streamp strm, unsigned out)
 				state->whave += dist;
 		}
 	}
+
+	/* a full window hides the dictionary for good */
+	if (state->whave == state->wsize) {
+		state->dict = Z_NULL;
+		state->dictlen = 0;
+	}
 	return 0;
 }
+#endif
 
 /* Macros for inflate(): */
 
@@ -654,6 +783,11 @@ inflate(z_streamp strm ,int flush)
 	if (strm == Z_NULL || strm->state == Z_NULL || strm->next_out == Z_NULL || (strm->next_in == Z_NULL && strm->avail_in != 0))
 		return Z_STREAM_ERROR;
 
+	if (ASLEEP(strm)) {
+		ret = inflateWake(strm);
+		if (ret != Z_OK)
+			return ret;
+	}
 	state = (struct inflate_state *)strm->state;
 	if (state->mode == TYPE)
 		state->mode = TYPEDO;	/* skip check */
@@ -664,7 +798,7 @@ inflate(z_streamp strm ,int flush)
 	for (;;)
 		switch (state->mode) {
 		case HEAD:
-			if (state->wrap == 0) {
+			if (WRAP(state) == 0) {
 				state->mode = TYPEDO;
 				break;
 			}
@@ -687,6 +821,8 @@ inflate(z_streamp strm ,int flush)
 				break;
 			}
 			state->dmax = 1U << len;
+			if (state->window == Z_NULL)
+				state->wbits = len;	/* never need more than declared */
 			Tracev((stderr, "inflate:   zlib header ok\n"));
 			strm->adler = state->check = adler32(0L, Z_NULL, 0);
 			state->mode = hold & 0x200 ? DICTID : TYPE;
@@ -698,6 +834,8 @@ inflate(z_streamp strm ,int flush)
 			INITBITS();
 			state->mode = DICT;
 		case DICT:
+			if (state->havedict == 0)
+				usedict(state, finddict(state, state->check));
 			if (state->havedict == 0) {
 				RESTORE();
 				return Z_NEED_DICT;
@@ -952,7 +1090,7 @@ inflate(z_streamp strm ,int flush)
 				state->offset += BITS(state->extra);
 				DROPBITS(state->extra);
 			}
-			if (state->offset > state->whave + out - left) {
+			if (state->offset > state->whave + state->dictlen + out - left) {
 				strm->msg = (char *)"invalid distance too far back";
 				state->mode = BAD;
 				break;
@@ -965,7 +1103,15 @@ inflate(z_streamp strm ,int flush)
 			copy = out - left;
 			if (state->offset > copy) {	/* copy from window */
 				copy = state->offset - copy;
-				if (copy > state->write) {
+				if (!UZ_WINDOW || copy > state->whave) {	/* from dictionary */
+					copy -= state->whave;
+					if (copy > state->dictlen) {	/* only without a window */
+						strm->msg = (char *)"invalid distance too far back";
+						state->mode = BAD;
+						break;
+					}
+					from = (unsigned char *)state->dict + (state->dictlen - copy);
+				} else if (copy > state->write) {
 					copy -= state->write;
 					from = state->window + (state->wsize - copy);
 				} else
@@ -994,15 +1140,15 @@ inflate(z_streamp strm ,int flush)
 			state->mode = LEN;
 			break;
 		case CHECK:
-			if (state->wrap) {
+			if (WRAP(state)) {
 				NEEDBITS(32);
 				out -= left;
 				strm->total_out += out;
 				state->total += out;
-				if (out)
+				if (UZ_CHECK && out)
 					strm->adler = state->check = UPDATE(state->check, put - out, out);
 				out = left;
-				if ((REVERSE(hold)) != state->check) {
+				if (UZ_CHECK && REVERSE(hold) != state->check) {
 					strm->msg = (char *)"incorrect data check";
 					state->mode = BAD;
 					break;
@@ -1032,17 +1178,19 @@ inflate(z_streamp strm ,int flush)
 	 */
  inf_leave:
 	RESTORE();
-	if (state->wsize || (state->mode < CHECK && out != strm->avail_out))
+#if UZ_WINDOW
+	if (state->mode < CHECK && (state->wsize || out != strm->avail_out))
 		if (updatewindow(strm, out)) {
 			state->mode = MEM;
 			return Z_MEM_ERROR;
 		}
+#endif
 	in -= strm->avail_in;
 	out -= strm->avail_out;
 	strm->total_in += in;
 	strm->total_out += out;
 	state->total += out;
-	if (state->wrap && out)
+	if (UZ_CHECK && WRAP(state) && out)
 		strm->adler = state->check = UPDATE(state->check, strm->next_out - out, out);
 	strm->data_type = state->bits + (state->last ? 64 : 0) + (state->mode == TYPE ? 128 : 0);
 	if (((in == 0 && out == 0) || flush == Z_FINISH) && ret == Z_OK)
@@ -1050,6 +1198,78 @@ inflate(z_streamp strm ,int flush)
 	return ret;
 }
 
+/*
+   inflatev() is a loop around inflate(): it calls it once per pair of
+   current input and output segments and moves on to the next segment of
+   whichever list ran out.  Nothing in the decoder steps across segments
+   itself; bits of a code that straddles two input segments wait in the bit
+   accumulator, and output segments are folded into the window as they are
+   filled, so a distance reaching into an earlier segment is served from
+   there.  Segment lengths beyond what fits in a uInt are fed in pieces.
+   Once a list runs out, inflate() is pointed at dummy, and the stream is
+   pointed back at the end of the last segment of that list before return.
+ */
+#define MAXSEG ((uInt)-1)
+
+int
+inflatev(z_streamp strm, z_iovec *in, unsigned nin, z_iovec *out, unsigned nout, int flush)
+{
+	unsigned char dummy;	/* for next_in or next_out when out of segments */
+	Bytef *end_in, *end_out;	/* end of the last segment skipped */
+	uInt have, left;	/* avail_in and avail_out given to inflate() */
+	int progress;		/* true once any input used or output made */
+	int ret;
+
+	if (strm == Z_NULL || strm->state == Z_NULL || (in == Z_NULL && nin != 0) || (out == Z_NULL && nout != 0))
+		return Z_STREAM_ERROR;
+	end_in = strm->next_in;
+	end_out = strm->next_out;
+	progress = 0;
+	for (;;) {
+		while (nin != 0 && in->len == 0) {
+			end_in = (Bytef *)in->base;
+			in++;
+			nin--;
+		}
+		while (nout != 0 && out->len == 0) {
+			end_out = (Bytef *)out->base;
+			out++;
+			nout--;
+		}
+		have = nin == 0 ? 0 : in->len > MAXSEG ? MAXSEG : (uInt)in->len;
+		left = nout == 0 ? 0 : out->len > MAXSEG ? MAXSEG : (uInt)out->len;
+		strm->next_in = nin == 0 ? &dummy : (Bytef *)in->base;
+		strm->avail_in = have;
+		strm->next_out = nout == 0 ? &dummy : (Bytef *)out->base;
+		strm->avail_out = left;
+		ret = inflate(strm, flush == Z_BLOCK ? Z_BLOCK : Z_NO_FLUSH);
+		have -= strm->avail_in;
+		left -= strm->avail_out;
+		if (have) {
+			in->base = (Bytef *)in->base + have;
+			in->len -= have;
+		}
+		if (left) {
+			out->base = (Bytef *)out->base + left;
+			out->len -= left;
+		}
+		if (ret != Z_OK)
+			break;		/* end, error or no progress */
+		progress = 1;
+		if (flush == Z_BLOCK && (strm->data_type & 128))
+			break;		/* stopped at a block boundary */
+	}
+	if (strm->next_in == &dummy)
+		strm->next_in = end_in;
+	if (strm->next_out == &dummy)
+		strm->next_out = end_out;
+	if (ret == Z_BUF_ERROR && progress)
+		ret = Z_OK;
+	if (flush == Z_FINISH && ret == Z_OK)
+		ret = Z_BUF_ERROR;
+	return ret;
+}
+
 int
 inflateEnd(z_streamp strm)
 {
@@ -1057,7 +1277,7 @@ inflateEnd(z_streamp strm)
 	if (strm == Z_NULL || strm->state == Z_NULL || strm->zfree == (free_func) 0)
 		return Z_STREAM_ERROR;
 	state = (struct inflate_state *)strm->state;
-	if (state->window != Z_NULL)
+	if (!ASLEEP(strm) && state->window != Z_NULL)
 		ZFREE(strm, state->window);
 	ZFREE(strm, strm->state);
 	strm->state = Z_NULL;
@@ -1065,6 +1285,502 @@ inflateEnd(z_streamp strm)
 	return Z_OK;
 }
 
+int
+inflateDictionaryInit(z_dictionary *dict, const Bytef *data, uInt len)
+{
+	if (dict == Z_NULL || (data == Z_NULL && len != 0))
+		return Z_STREAM_ERROR;
+	dict->data = data;
+	dict->len = len;
+	dict->id = adler32(adler32(0L, Z_NULL, 0), data, len);
+	return Z_OK;
+}
+
+int
+inflateUseDictionaries(z_streamp strm, const z_dictionary *dicts, unsigned count)
+{
+	struct inflate_state *state;
+
+	if (strm == Z_NULL || strm->state == Z_NULL || (dicts == Z_NULL && count != 0))
+		return Z_STREAM_ERROR;
+	if (ASLEEP(strm) && inflateWake(strm) != Z_OK)
+		return Z_MEM_ERROR;
+	state = (struct inflate_state *)strm->state;
+	state->dicts = dicts;
+	state->ndicts = count;
+	return Z_OK;
+}
+
+/* Find the dictionary with the given Adler-32 id in the table set with
+   inflateUseDictionaries(), or return Z_NULL. */
+static const z_dictionary *
+finddict(struct inflate_state *state, uLong id)
+{
+	unsigned n;
+
+	for (n = 0; n < state->ndicts; n++)
+		if (state->dicts[n].id == id)
+			return state->dicts + n;
+	return Z_NULL;
+}
+
+/*
+   Reference dict as the history preceding the first output byte.  Only the
+   last window size bytes of it can ever be reached by a distance, so only
+   those are kept track of.  Nothing is copied.
+ */
+static void
+usedict(struct inflate_state *state, const z_dictionary *dict)
+{
+	if (dict == Z_NULL)
+		return;
+	state->dictlen = dict->len;
+	if (state->dictlen > 1U << state->wbits)
+		state->dictlen = 1U << state->wbits;
+	state->dict = dict->data + (dict->len - state->dictlen);
+	state->dictid = dict->id;
+	state->havedict = 1;
+	Tracev((stderr, "inflate:   dictionary set\n"));
+}
+
+int
+inflateSetDictionary(z_streamp strm, const z_dictionary *dict)
+{
+	struct inflate_state *state;
+
+	if (strm == Z_NULL || strm->state == Z_NULL || dict == Z_NULL)
+		return Z_STREAM_ERROR;
+	if (ASLEEP(strm) && inflateWake(strm) != Z_OK)
+		return Z_MEM_ERROR;
+	state = (struct inflate_state *)strm->state;
+
+	/* a zlib stream says when it wants one, raw only before any output */
+	if (WRAP(state) != 0 ? state->mode != DICT :
+	    (state->total != 0 || state->whave != 0 || state->havedict))
+		return Z_STREAM_ERROR;
+	if (state->mode == DICT && dict->id != state->check)
+		return Z_DATA_ERROR;
+	usedict(state, dict);
+	return Z_OK;
+}
+
+/* Version byte leading the inflateSerialize() format */
+#define SERIAL_VERSION 2
+
+/* Which code tables inflateDeserialize() must rebuild from code lengths */
+typedef enum {
+	TAB_NONE,		/* no tables in use (between blocks, header) */
+	TAB_FIXED,		/* fixed codes block */
+	TAB_CODES,		/* code length code, while reading CODELENS */
+	TAB_DYN			/* dynamic literal/length and distance codes */
+} tablekind;
+
+static Bytef *
+put32(Bytef *p, unsigned long v)
+{
+	p[0] = (Bytef)v;
+	p[1] = (Bytef)(v >> 8);
+	p[2] = (Bytef)(v >> 16);
+	p[3] = (Bytef)(v >> 24);
+	return p + 4;
+}
+
+static const Bytef *
+get32(const Bytef *p, unsigned long *v)
+{
+	*v = (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+	    ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+	return p + 4;
+}
+
+/* Number of fixed-size words in the serialized header, hold counts two */
+#define SERIAL_WORDS 27
+
+/*
+   Work out which code tables are live in the current mode.  Tables only
+   matter while reading code lengths or inside a compressed block; between
+   blocks the next TYPE will set them up again.
+ */
+static tablekind
+livetables(struct inflate_state *state)
+{
+	switch (state->mode) {
+	case CODELENS:
+		return TAB_CODES;
+	case LEN:
+	case LENEXT:
+	case DIST:
+	case DISTEXT:
+	case MATCH:
+	case LIT:
+		if (state->lencode < state->codes || state->lencode >= state->codes + ENOUGH)
+			return TAB_FIXED;
+		return TAB_DYN;
+	default:
+		return TAB_NONE;
+	}
+}
+
+/* Number of code lengths saved for the given mode and table kind */
+static unsigned
+savedlens(struct inflate_state *state, tablekind kind)
+{
+	switch (kind) {
+	case TAB_CODES:
+		return 19 + state->have;
+	case TAB_DYN:
+		return state->nlen + state->ndist;
+	default:
+		return state->mode == LENLENS ? 19 : 0;
+	}
+}
+
+int
+inflateSerialize(z_streamp strm, Bytef *buf, uInt *len)
+{
+	struct inflate_state *state;
+	struct inflate_sleeper *sleeper;
+	tablekind kind;
+	unsigned nlens, need, i, n;
+	unsigned char clens[19];
+	Bytef *p;
+
+	if (strm == Z_NULL || strm->state == Z_NULL || len == Z_NULL)
+		return Z_STREAM_ERROR;
+	if (ASLEEP(strm)) {
+		sleeper = (struct inflate_sleeper *)strm->state;
+		if (buf != Z_NULL) {
+			if (*len < sleeper->len)
+				return Z_BUF_ERROR;
+			zmemcpy(buf, sleeper->saved, sleeper->len);
+		}
+		*len = sleeper->len;
+		return Z_OK;
+	}
+	state = (struct inflate_state *)strm->state;
+	if (state->mode == MEM)
+		return Z_STREAM_ERROR;
+	kind = livetables(state);
+	nlens = savedlens(state, kind);
+	need = 2 + SERIAL_WORDS * 4 + (nlens + 1) / 2 + (state->wsize ? state->whave : 0);
+	if (buf == Z_NULL) {
+		*len = need;
+		return Z_OK;
+	}
+	if (*len < need)
+		return Z_BUF_ERROR;
+
+	p = buf;
+	*p++ = SERIAL_VERSION;
+	*p++ = (Bytef)kind;
+	p = put32(p, state->mode);
+	p = put32(p, state->last);
+	p = put32(p, state->wrap);
+	p = put32(p, state->havedict);
+	p = put32(p, state->flags);
+	p = put32(p, state->dmax);
+	p = put32(p, state->check);
+	p = put32(p, state->total);
+	p = put32(p, state->wbits);
+	p = put32(p, state->wsize);
+	p = put32(p, state->wsize ? state->whave : 0);
+	p = put32(p, state->hold);
+	p = put32(p, sizeof(state->hold) > 4 ? (state->hold >> 16) >> 16 : 0);
+	p = put32(p, state->bits);
+	p = put32(p, state->length);
+	p = put32(p, state->offset);
+	p = put32(p, state->extra);
+	p = put32(p, state->ncode);
+	p = put32(p, state->nlen);
+	p = put32(p, state->ndist);
+	p = put32(p, state->have);
+	p = put32(p, strm->total_in);
+	p = put32(p, strm->total_out);
+	p = put32(p, strm->adler);
+	p = put32(p, nlens);
+	p = put32(p, state->dictid);
+	p = put32(p, state->dictlen);
+
+	/* code lengths, two per byte -- the code length code is recovered from
+	   its root table since CODELENS overwrites lens[] as it goes */
+	if (kind == TAB_CODES) {
+		for (i = 0; i < 19; i++)
+			clens[i] = 0;
+		for (i = 0; i < (1U << state->lenbits); i++)
+			if (state->lencode[i].op == 0)
+				clens[state->lencode[i].val] = state->lencode[i].bits;
+	}
+	for (i = 0; i < nlens; i++) {
+		if (kind == TAB_CODES)
+			n = i < 19 ? clens[i] : state->lens[i - 19];
+		else
+			n = state->lens[i] & 15;	/* LENLENS may have stale entries */
+		if (i & 1)
+			*p++ |= (Bytef)(n << 4);
+		else
+			*p = (Bytef)n;
+	}
+	if (nlens & 1)
+		p++;
+
+	/* window contents, oldest byte first */
+	if (state->wsize && state->whave) {
+		if (state->whave == state->wsize) {
+			zmemcpy(p, state->window + state->write, state->wsize - state->write);
+			zmemcpy(p + state->wsize - state->write, state->window, state->write);
+		} else
+			zmemcpy(p, state->window, state->whave);
+		p += state->whave;
+	}
+	*len = (uInt)(p - buf);
+	return Z_OK;
+}
+
+/*
+   Load the state saved in buf[0..len-1] into strm.  A dictionary the saved
+   stream refers to is looked up in the table of strm, or else taken from
+   own, which is how a hibernated stream keeps one it was handed with
+   inflateSetDictionary().
+ */
+static int
+restore(z_streamp strm, const Bytef *buf, uInt len, const z_dictionary *own)
+{
+	struct inflate_state *state;
+	unsigned long w[SERIAL_WORDS];
+	unsigned short clens[19];
+	const z_dictionary *dict;
+	const Bytef *p;
+	tablekind kind;
+	unsigned i, nlens;
+	int ret;
+
+	if (strm == Z_NULL || strm->state == Z_NULL || buf == Z_NULL)
+		return Z_STREAM_ERROR;
+	if (ASLEEP(strm)) {
+		ret = inflateWake(strm);
+		if (ret != Z_OK)
+			return ret;
+	}
+	state = (struct inflate_state *)strm->state;
+	if (len < 2 + SERIAL_WORDS * 4 || buf[0] != SERIAL_VERSION || buf[1] > TAB_DYN)
+		return Z_DATA_ERROR;
+	kind = (tablekind)buf[1];
+	p = buf + 2;
+	for (i = 0; i < SERIAL_WORDS; i++)
+		p = get32(p, &w[i]);
+	nlens = w[24];
+
+	/* sanity check everything that is used as an index, size or shift */
+	if (w[0] > BAD || (w[0] >= FLAGS && w[0] <= HCRC) || w[0] == LENGTH ||
+	    w[8] < MIN_WBITS || w[8] > MAX_WBITS || w[9] > 1UL << w[8] ||
+	    (w[9] & (w[9] - 1)) != 0 || (w[9] != 0 && w[9] < 1U << MIN_WBITS) ||
+	    w[10] > w[9] || w[13] >= 8 * sizeof(state->hold) || w[14] > 65535 ||
+	    w[15] > 1UL << MAX_WBITS || w[16] > 15 || w[17] > 19 ||
+	    w[18] > 288 || w[19] > 32 || w[20] > 320 || nlens > 19 + 320 ||
+	    len < 2 + SERIAL_WORDS * 4 + (nlens + 1) / 2 + w[10] || w[26] > 1UL << w[8])
+		return Z_DATA_ERROR;
+	if ((w[0] == LENLENS && (w[17] < 4 || w[20] > 19)) ||
+	    (w[0] == CODELENS && w[20] > w[18] + w[19]))
+		return Z_DATA_ERROR;
+	switch ((inflate_mode)w[0]) {
+	case CODELENS:
+		ret = kind == TAB_CODES;
+		break;
+	case LEN:
+	case LENEXT:
+	case DIST:
+	case DISTEXT:
+	case MATCH:
+	case LIT:
+		ret = kind == TAB_FIXED || kind == TAB_DYN;
+		break;
+	default:
+		ret = kind == TAB_NONE;
+	}
+	if (!ret || nlens != (kind == TAB_CODES ? 19 + w[20] :
+			      kind == TAB_DYN ? w[18] + w[19] :
+			      w[0] == LENLENS ? 19 : 0))
+		return Z_DATA_ERROR;
+
+	/* a dictionary still in reach must be among this stream's */
+	dict = Z_NULL;
+	if (w[26] != 0) {
+		dict = finddict(state, w[25]);
+		if (dict == Z_NULL && own != Z_NULL && own->id == w[25])
+			dict = own;
+		if (dict == Z_NULL || dict->len < w[26]) {
+			strm->adler = w[25];
+			return Z_NEED_DICT;
+		}
+	}
+
+	/* reuse the window only if it has the same size */
+	if (state->window != Z_NULL && state->wsize != w[9]) {
+		ZFREE(strm, state->window);
+		state->window = Z_NULL;
+	}
+	if (w[9] != 0 && state->window == Z_NULL) {
+		state->window = (unsigned char *)
+		    ZALLOC(strm, w[9], sizeof(unsigned char));
+		if (state->window == Z_NULL)
+			return Z_MEM_ERROR;
+	}
+
+	state->mode = (inflate_mode)w[0];
+	state->last = (int)w[1];
+	state->wrap = (int)w[2];
+	state->havedict = (int)w[3];
+	state->flags = (int)w[4];
+	state->dmax = w[5];
+	state->check = w[6];
+	state->total = w[7];
+	state->wbits = w[8];
+	state->wsize = w[9];
+	state->whave = w[10];
+	state->write = state->whave == state->wsize ? 0 : state->whave;
+	state->hold = w[11];
+	if (sizeof(state->hold) > 4)
+		state->hold |= (w[12] << 16) << 16;
+	state->bits = w[13];
+	state->length = w[14];
+	state->offset = w[15];
+	state->extra = w[16];
+	state->ncode = w[17];
+	state->nlen = w[18];
+	state->ndist = w[19];
+	state->have = w[20];
+	strm->total_in = w[21];
+	strm->total_out = w[22];
+	strm->adler = w[23];
+	strm->msg = Z_NULL;
+	state->dictid = w[25];
+	state->dictlen = w[26];
+	state->dict = dict == Z_NULL ? Z_NULL : dict->data + (dict->len - state->dictlen);
+
+	for (i = 0; i < nlens; i++) {
+		if (kind == TAB_CODES && i < 19)
+			clens[i] = (unsigned short)((p[i >> 1] >> ((i & 1) << 2)) & 15);
+		else
+			state->lens[kind == TAB_CODES ? i - 19 : i] =
+			    (unsigned short)((p[i >> 1] >> ((i & 1) << 2)) & 15);
+	}
+	p += (nlens + 1) / 2;
+	if (state->wsize)
+		zmemcpy(state->window, p, state->whave);
+
+	/* rebuild whatever code tables the saved mode depends on */
+	state->next = state->codes;
+	state->lencode = state->distcode = state->codes;
+	ret = 0;
+	switch (kind) {
+	case TAB_FIXED:
+		fixedtables(state);
+		break;
+	case TAB_CODES:
+		state->lenbits = 7;
+		ret = inflate_table(CODES, clens, 19, &(state->next), &(state->lenbits), state->work);
+		break;
+	case TAB_DYN:
+		state->lenbits = 9;
+		ret = inflate_table(LENS, state->lens, state->nlen, &(state->next), &(state->lenbits), state->work);
+		if (ret)
+			break;
+		state->distcode = (code const *)(state->next);
+		state->distbits = 6;
+		ret = inflate_table(DISTS, state->lens + state->nlen, state->ndist, &(state->next), &(state->distbits), state->work);
+		break;
+	default:
+		break;
+	}
+	if (ret) {
+		state->mode = BAD;
+		return Z_DATA_ERROR;
+	}
+	return Z_OK;
+}
+
+int
+inflateDeserialize(z_streamp strm, const Bytef *buf, uInt len)
+{
+	return restore(strm, buf, len, Z_NULL);
+}
+
+int
+inflateHibernate(z_streamp strm)
+{
+	struct inflate_state *state;
+	struct inflate_sleeper *sleeper;
+	uInt len;
+	int ret;
+
+	if (strm == Z_NULL || strm->state == Z_NULL || strm->zfree == (free_func) 0)
+		return Z_STREAM_ERROR;
+	if (ASLEEP(strm))
+		return Z_OK;
+	state = (struct inflate_state *)strm->state;
+	ret = inflateSerialize(strm, Z_NULL, &len);
+	if (ret != Z_OK)
+		return ret;
+	sleeper = (struct inflate_sleeper *)
+	    ZALLOC(strm, 1, sizeof(struct inflate_sleeper) + len);
+	if (sleeper == Z_NULL)
+		return Z_MEM_ERROR;
+	sleeper->len = len;
+	ret = inflateSerialize(strm, sleeper->saved, &sleeper->len);
+	if (ret != Z_OK) {
+		ZFREE(strm, sleeper);
+		return ret;
+	}
+	sleeper->mode = SLEEP;
+	sleeper->dicts = state->dicts;
+	sleeper->ndicts = state->ndicts;
+	sleeper->dict.data = state->dict;
+	sleeper->dict.len = state->dictlen;
+	sleeper->dict.id = state->dictid;
+	if (state->window != Z_NULL)
+		ZFREE(strm, state->window);
+	ZFREE(strm, state);
+	strm->state = (struct internal_state *)sleeper;
+	Tracev((stderr, "inflate: hibernated in %u bytes\n", sleeper->len));
+	return Z_OK;
+}
+
+int
+inflateWake(z_streamp strm)
+{
+	struct inflate_state *state;
+	struct inflate_sleeper *sleeper;
+	int ret;
+
+	if (strm == Z_NULL || strm->state == Z_NULL || strm->zfree == (free_func) 0)
+		return Z_STREAM_ERROR;
+	if (!ASLEEP(strm))
+		return Z_OK;
+	sleeper = (struct inflate_sleeper *)strm->state;
+	state = (struct inflate_state *)
+	    ZALLOC(strm, 1, sizeof(struct inflate_state));
+	if (state == Z_NULL)
+		return Z_MEM_ERROR;
+	state->mode = HEAD;
+	state->window = Z_NULL;
+	state->wsize = 0;
+	state->wbits = 0;
+	state->dicts = sleeper->dicts;
+	state->ndicts = sleeper->ndicts;
+	strm->state = (struct internal_state *)state;
+	ret = restore(strm, sleeper->saved, sleeper->len, &sleeper->dict);
+	if (ret != Z_OK) {
+		if (state->window != Z_NULL)
+			ZFREE(strm, state->window);
+		ZFREE(strm, state);
+		strm->state = (struct internal_state *)sleeper;
+		return ret;
+	}
+	ZFREE(strm, sleeper);
+	Tracev((stderr, "inflate: awake\n"));
+	return Z_OK;
+}
+
 /*
      Update a running Adler-32 checksum with the bytes buf[0..len-1] and
    return the updated checksum. If buf is NULL, this function returns
@@ -1524,6 +2240,8 @@ static void inflate_fast(z_streamp strm, unsigned start)
 	unsigned whave;		/* valid bytes in the window */
 	unsigned write;		/* window write index */
 	unsigned char *window;	/* allocated sliding window, if wsize != 0 */
+	unsigned char *dict;	/* shared dictionary before the window */
+	unsigned dictlen;	/* dictionary bytes in reach */
 	unsigned long hold;	/* local strm->hold */
 	unsigned bits;		/* local strm->bits */
 	code const *lcode;	/* local strm->lencode */
@@ -1548,6 +2266,8 @@ static void inflate_fast(z_streamp strm, unsigned start)
 	whave = state->whave;
 	write = state->write;
 	window = state->window;
+	dict = (unsigned char *)state->dict;
+	dictlen = state->dictlen;
 	hold = state->hold;
 	bits = state->bits;
 	lcode = state->lencode;
@@ -1616,13 +2336,30 @@ static void inflate_fast(z_streamp strm, unsigned start)
 				op = (unsigned)(out - beg);	/* max distance in output */
 				if (dist > op) {	/* see if copy from window */
 					op = dist - op;	/* distance back in window */
-					if (op > whave) {
-						strm->msg = (char *)"invalid distance too far back";
-						state->mode = BAD;
-						break;
-					}
 					from = window - OFF;
-					if (write == 0) {	/* very common case */
+					if (!UZ_WINDOW || op > whave) {	/* reaches into dictionary */
+						op -= whave;
+						if (op > dictlen) {
+							strm->msg = (char *)"invalid distance too far back";
+							state->mode = BAD;
+							break;
+						}
+						from = dict + dictlen - op - OFF;
+						if (op < len) {	/* some from dictionary */
+							len -= op;
+							do {
+								PUP(out) = PUP(from);
+							} while (--op);
+							from = window - OFF;	/* not full, so not wrapped */
+							op = whave;
+							if (op < len) {	/* all of window */
+								len -= op;
+								while (op--)
+									PUP(out) = PUP(from);
+								from = out - dist;	/* rest from output */
+							}
+						}
+					} else if (write == 0) {	/* very common case */
 						from += wsize - op;
 						if (op < len) {	/* some from window */
 							len -= op;
@@ -3,6 +3,12 @@
 #ifndef UZLIB_H
 #define UZLIB_H
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
 typedef unsigned char Byte;
 
 typedef unsigned int uInt;
@@ -41,6 +47,26 @@ typedef struct z_stream_s {
 
 typedef z_stream *z_streamp;
 
+/*
+     A preset dictionary shared read-only by any number of streams.  The
+   data is referenced, never copied, and must stay unchanged and valid for
+   as long as a stream may use it.  Set up with inflateDictionaryInit().
+*/
+typedef struct z_dictionary_s {
+    const Bytef *data;  /* dictionary contents */
+    uInt     len;       /* number of bytes at data */
+    uLong    id;        /* adler32 value of data, as found in the zlib header */
+} z_dictionary;
+
+/*
+     One segment of a scattered input or output buffer for inflatev().  It
+   has the layout of the POSIX struct iovec.
+*/
+typedef struct z_iovec_s {
+    voidp    base;      /* start of the segment */
+    size_t   len;       /* number of bytes at base */
+} z_iovec;
+
                         /* constants */
 
 #define Z_NO_FLUSH      0
@@ -99,7 +125,8 @@ ZEXTERN int ZEXPORT inflateInit OF((z_streamp strm));
    compression method from the zlib header and allocates all data structures
    accordingly; otherwise the allocation will be deferred to the first call of
    inflate.  If zalloc and zfree are set to Z_NULL, inflateInit updates them to
-   use default allocation functions.
+   use default allocation functions: uzAlloc() and uzFree() when the slab
+   allocator is built in, else functions based on malloc() and free().
 
      inflateInit returns Z_OK if success, Z_MEM_ERROR if there was not enough
    memory, Z_VERSION_ERROR if the zlib library version is incompatible with the
@@ -209,6 +236,40 @@ int inflate (z_streamp strm, int flush);
 */
 
 
+int inflatev (z_streamp strm, z_iovec *in, unsigned nin,
+              z_iovec *out, unsigned nout, int flush);
+/*
+     Like inflate(), but takes its input from the segments in[0..nin-1] and
+   writes its output to the segments out[0..nout-1], each list in order,
+   instead of using next_in and next_out.  Segments may be of any size,
+   including zero.  This is a convenience over calling inflate() in a loop:
+   inflatev() calls inflate() once for each step from one segment to the
+   next, and inflate() only takes its fast path within a pair of segments,
+   so many small segments decompress no faster than one inflate() call per
+   segment would.  Codes that straddle input segments and distances that
+   reach back into earlier output segments are handled, the latter through
+   the sliding window, so without one (UZ_WINDOW=0) the output must fit in
+   the first output segment.
+
+     Each segment is updated in place: base is advanced past the bytes
+   consumed or written and len is reduced accordingly, so that segments
+   used up are left with len zero and the caller can call inflatev() again
+   with the same arrays after appending to them.  On return next_in and
+   next_out point at the next byte to be consumed or written, or just past
+   the last segment of a list that is used up, or are left as they were
+   for a list with no segments at all; avail_in and avail_out are what is
+   left of the current segments.
+
+     inflatev() returns as inflate() would for the concatenated segments:
+   Z_OK if some progress has been made, Z_STREAM_END at the end of the
+   stream (with any input after it left in the segments), Z_NEED_DICT,
+   Z_DATA_ERROR, Z_MEM_ERROR, Z_STREAM_ERROR, or Z_BUF_ERROR if no progress
+   was possible or if flush is Z_FINISH and the output segments could not
+   hold the rest of the stream.  With Z_BLOCK it stops at the next block
+   boundary as inflate() does, also when that falls on the end of a segment.
+*/
+
+
 int inflateEnd (z_streamp strm);
 /*
      All dynamically allocated data structures for this stream are freed.
@@ -220,5 +281,159 @@ int inflateEnd (z_streamp strm);
    static string (which must not be deallocated).
 */
 
+int inflateReset (z_streamp strm);
+/*
+     This function is equivalent to inflateEnd followed by inflateInit,
+   but does not free and reallocate all the internal decompression state.
+   The sliding window is kept for the next stream, as is the table given
+   to inflateUseDictionaries().  A hibernated stream is woken up first.
+
+     inflateReset returns Z_OK if success, Z_MEM_ERROR if a hibernated
+   stream could not be woken up, or Z_STREAM_ERROR if the source stream
+   state was inconsistent (such as zalloc or state being NULL).
+*/
+
+
+int inflateDictionaryInit (z_dictionary *dict, const Bytef *data, uInt len);
+/*
+     Initializes dict to refer to data[0..len-1] and computes its id.  This
+   is done once per dictionary; the result can be handed to any number of
+   streams with inflateUseDictionaries() or inflateSetDictionary().
+
+     inflateDictionaryInit returns Z_OK if success, or Z_STREAM_ERROR if a
+   parameter is invalid (such as a null data pointer with a non-zero len).
+*/
+
+int inflateUseDictionaries (z_streamp strm, const z_dictionary *dicts,
+                            unsigned count);
+/*
+     Gives strm a table of count dictionaries to pick from when a zlib
+   header asks for a preset dictionary.  When the id found in the header
+   matches one of the entries, inflate() carries on with that dictionary
+   instead of returning Z_NEED_DICT.  The table is referenced, not copied,
+   so one table may be shared by all streams of an application.  Matching
+   string references are resolved by reading the dictionary in place, and
+   the stream stops referring to it once its window has been filled with
+   output.
+
+     inflateUseDictionaries returns Z_OK if success, Z_MEM_ERROR if a
+   hibernated stream could not be woken up, or Z_STREAM_ERROR if the
+   stream state was inconsistent.
+*/
+
+int inflateSetDictionary (z_streamp strm, const z_dictionary *dict);
+/*
+     Provides the dictionary after inflate() has returned Z_NEED_DICT, for
+   dictionaries not found with inflateUseDictionaries().  For raw inflate it
+   may be called before the first call of inflate().  As above, the
+   dictionary is referenced and not copied.
+
+     inflateSetDictionary returns Z_OK if success, Z_STREAM_ERROR if a
+   parameter is invalid or the stream is not waiting for a dictionary, or
+   Z_DATA_ERROR if the id of dict does not match the one the stream
+   expects.
+*/
+
+int inflateSerialize (z_streamp strm, Bytef *buf, uInt *len);
+/*
+     Captures the complete decompression state of strm between inflate()
+   calls into the flat buffer buf, so that decoding can later be resumed in
+   another stream, thread or process with inflateDeserialize().  The saved
+   state contains the bit accumulator, check value, the valid part of the
+   sliding window and the code lengths needed to rebuild the decoding
+   tables, but no pointers.  Pending input and output are the caller's; the
+   stream resumes at the byte following the last one consumed (next_in).
+
+     On entry *len is the size of buf; on return it is the number of bytes
+   written.  If buf is Z_NULL, *len is set to the size needed and nothing is
+   written.  The size is at most a few hundred bytes plus the window size.
+
+     inflateSerialize returns Z_OK if success, Z_BUF_ERROR if buf is too
+   small, or Z_STREAM_ERROR if the stream state was inconsistent or a
+   memory error has occurred.
+*/
+
+int inflateDeserialize (z_streamp strm, const Bytef *buf, uInt len);
+/*
+     Replaces the state of strm, which must have been initialized with
+   inflateInit(), with the state saved by inflateSerialize() in buf[0..len-1].
+   The next inflate() call then continues exactly where the saved stream
+   would have, producing byte-identical output.  total_in, total_out and
+   adler are restored as well.  A dictionary the saved stream still refers
+   to is looked up by id among those given to strm with
+   inflateUseDictionaries(), which must then be called first.
+
+     inflateDeserialize returns Z_OK if success, Z_MEM_ERROR if the window
+   could not be allocated, Z_NEED_DICT (with adler set to its id) if a
+   needed dictionary is not available, Z_DATA_ERROR if buf is not a valid
+   saved state, or Z_STREAM_ERROR if the stream state was inconsistent.
+*/
+
+int inflateHibernate (z_streamp strm);
+/*
+     Shrinks an idle stream to the minimum needed to resume it later.  The
+   sliding window and the internal state (about 40K together with a 32K
+   window) are freed and replaced by one allocation holding the
+   inflateSerialize() record, i.e. the used part of the window plus a few
+   hundred bytes.  Decoding tables are dropped and rebuilt from their code
+   lengths on wake up.  The record is allocated with zalloc, so an
+   application can direct these small blocks to a separate slab.  A
+   dictionary given with inflateSetDictionary() stays referenced by the
+   hibernated stream and is used again on wake up, so it must remain valid
+   until the stream no longer refers to it, exactly as for an awake stream;
+   unlike inflateDeserialize(), waking up never returns Z_NEED_DICT.
+
+     A hibernated stream wakes up transparently on the next call of
+   inflate(), or explicitly with inflateWake().  inflateEnd() and
+   inflateSerialize() may be used on a hibernated stream without waking it.
+
+     inflateHibernate returns Z_OK if success (or if the stream was already
+   hibernated), Z_MEM_ERROR if there was not enough memory, in which case
+   the stream is left untouched, or Z_STREAM_ERROR if the stream state was
+   inconsistent.
+*/
+
+int inflateWake (z_streamp strm);
+/*
+     Restores a stream hibernated with inflateHibernate() to its full state.
+   There is normally no need to call this, inflate() does it as needed; it
+   is provided to control when the allocation happens.
+
+     inflateWake returns Z_OK if success or if the stream was not asleep,
+   Z_MEM_ERROR if there was not enough memory, in which case the stream stays
+   hibernated, or Z_STREAM_ERROR if the stream state was inconsistent.
+*/
+
+
+                        /* slab allocator */
+
+#define UZ_ALLOC_HUGEPAGES  1 /* back slabs with huge pages when available */
+#define UZ_ALLOC_NUMA_LOCAL 2 /* keep memory on the NUMA node that uses it */
+
+voidp uzAlloc (voidp opaque, uInt items, uInt size);
+void  uzFree  (voidp opaque, voidp address);
+/*
+     Allocation functions for zalloc and zfree, available when uzalloc.c is
+   built in (make -f Makefile.inflate UZALLOC=1, which needs POSIX threads
+   and mmap()).  They are then the default for streams whose zalloc and
+   zfree are Z_NULL, and can also be set explicitly; opaque is not used.
+   Inflate streams allocate only a few kinds of objects, and these are
+   served from size classes in large slabs with per-thread free lists,
+   taking a lock only when a thread's list runs empty or overflows.  Freed
+   memory is kept for reuse and not returned to the system.
+*/
+
+int uzAllocConfig (int flags);
+/*
+     Selects slab placement for uzAlloc(), as a combination of the
+   UZ_ALLOC_* flags.  Must be called before the first allocation.
+
+     uzAllocConfig returns Z_OK if success, or Z_STREAM_ERROR if memory has
+   already been allocated or a flag is unknown.
+*/
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
@@ -1,10 +1,415 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#ifdef UZ_ALLOC
+#include <pthread.h>
+#endif
 
 #include "uzlib.h"
 
+/*
+ * Build configuration, passed to this file as to uzinflate.c; see there.
+ * Without the zlib wrapper the vectors are fed from past their two byte
+ * header and up to their four byte trailer, and z_dict, which can only be
+ * told apart by its dictionary id, is left out.  So are the vectors that
+ * declare a window larger than MAX_WBITS allows.
+ */
+#ifndef UZ_WINDOW
+#  define UZ_WINDOW 1
+#endif
+#ifndef MAX_WBITS
+#  define MAX_WBITS 15
+#endif
+#if MAX_WBITS < 10
+#  error "z_mix needs a 1K window"
+#endif
+#if defined (UZ_WRAP) && UZ_WRAP == 0
+#  define RAW 1
+#  define VECTOR(name, data, dict) { name, data + 2, sizeof (data) - 6, dict }
+#else
+#  define RAW 0
+#  define VECTOR(name, data, dict) { name, data, sizeof (data), dict }
+#endif
+
+/*
+ * Test streams for uzlibtest -t, made with Python's zlib module:
+ *   z_mix     text, binary data and zeros; level 6, 1K window, memLevel 1,
+ *             with a sync flush and a full flush along the way
+ *   z_stored  level 0, 512 byte window
+ *   z_fixed   Z_FIXED strategy
+ *   z_dict    compressed with z_dictionary_text as preset dictionary
+ */
+
+static const unsigned char z_mix[3208] = {
+	0x28, 0x91, 0x3c, 0x4e, 0x41, 0x0e, 0x04, 0x21, 0x08, 0xbb, 0xfb, 0x8a,
+	0xbe, 0xc0, 0x3f, 0xe9, 0x06, 0xa3, 0x87, 0x95, 0xc4, 0x61, 0x62, 0xe6,
+	0xf7, 0x53, 0x64, 0xb3, 0x27, 0x68, 0x69, 0x4b, 0x77, 0x1f, 0x9f, 0x9e,
+	0x53, 0x5b, 0xfa, 0x85, 0x2e, 0x8c, 0x89, 0x7a, 0x1b, 0xb6, 0xb3, 0xe8,
+	0x82, 0xfa, 0xe4, 0x14, 0xc0, 0xba, 0x3c, 0x28, 0x96, 0x13, 0x97, 0x00,
+	0xd4, 0x4e, 0x35, 0x54, 0x41, 0x99, 0xce, 0xe4, 0x54, 0x2e, 0xce, 0x71,
+	0x41, 0x1b, 0x74, 0xc6, 0xba, 0xc9, 0x55, 0x37, 0xe2, 0xd1, 0xdb, 0xcd,
+	0x1e, 0x41, 0x0b, 0x7f, 0x51, 0xc5, 0x08, 0x5e, 0xb8, 0xec, 0x61, 0x1d,
+	0x5b, 0x96, 0x84, 0x8b, 0x0e, 0x37, 0x11, 0x9e, 0x43, 0x8b, 0x66, 0xc3,
+	0x42, 0x42, 0x74, 0x26, 0x25, 0x5e, 0x20, 0x12, 0xbc, 0x96, 0x2e, 0x76,
+	0xb0, 0xe3, 0xa3, 0xe6, 0x30, 0xed, 0x04, 0xb1, 0x97, 0x46, 0x69, 0x27,
+	0x7f, 0x7f, 0xe4, 0x1f, 0x78, 0x5e, 0xbe, 0x44, 0x92, 0x41, 0x0a, 0xc3,
+	0x30, 0x10, 0x03, 0xef, 0x79, 0x45, 0x5f, 0x90, 0x3f, 0x19, 0xdc, 0x52,
+	0x5f, 0x6a, 0x48, 0x9a, 0x42, 0x7e, 0x5f, 0x8d, 0x64, 0x63, 0x08, 0x04,
+	0xd6, 0xeb, 0x5d, 0x69, 0x64, 0x95, 0xfa, 0xbe, 0x49, 0x37, 0xdb, 0xf4,
+	0xa9, 0xf0, 0x2e, 0x3f, 0xcc, 0x55, 0x37, 0xb4, 0x8f, 0x4e, 0x5f, 0xb1,
+	0x5b, 0xed, 0x0b, 0x33, 0xee, 0x66, 0x88, 0xbc, 0xf5, 0x54, 0xf4, 0x0f,
+	0x32, 0xe4, 0x0c, 0x92, 0x0c, 0x82, 0x90, 0x85, 0x82, 0xc5, 0x65, 0x86,
+	0xa8, 0x32, 0x47, 0x69, 0x77, 0xea, 0xd2, 0x95, 0x1b, 0xea, 0x2c, 0xa1,
+	0xac, 0x9f, 0x00, 0xaa, 0x7b, 0xdf, 0x7c, 0xa4, 0xad, 0x6c, 0x96, 0x09,
+	0x2e, 0x1e, 0x4e, 0xcd, 0x73, 0xd8, 0x13, 0x97, 0x49, 0x96, 0xa6, 0x69,
+	0xc3, 0x29, 0x17, 0x13, 0x93, 0x48, 0x8d, 0xd5, 0x30, 0xac, 0x5f, 0x1e,
+	0x91, 0xd2, 0x22, 0xae, 0x2e, 0xbf, 0x05, 0x08, 0x81, 0x54, 0x09, 0x10,
+	0xec, 0xf1, 0x98, 0x8c, 0xa6, 0xb2, 0xea, 0x44, 0x96, 0x51, 0x28, 0x5d,
+	0x21, 0x63, 0xe6, 0x2e, 0x26, 0xd2, 0xf6, 0x0d, 0x65, 0xe7, 0x59, 0xce,
+	0xc0, 0x7d, 0xda, 0x56, 0xf3, 0x23, 0xba, 0x23, 0x09, 0xaf, 0x16, 0x32,
+	0x43, 0xbb, 0x97, 0x27, 0xcb, 0xf7, 0x03, 0x3c, 0xdd, 0xa3, 0xd7, 0x1b,
+	0x12, 0x03, 0x2a, 0xd7, 0x1c, 0xd1, 0x78, 0xda, 0x3a, 0x64, 0x1c, 0x5a,
+	0xd9, 0xd1, 0xff, 0x4c, 0x92, 0x41, 0x0a, 0xc3, 0x30, 0x10, 0x03, 0xef,
+	0x7d, 0x4c, 0xff, 0xe4, 0x40, 0x02, 0xb9, 0x6c, 0x20, 0x0e, 0xf4, 0xfb,
+	0x5d, 0x8d, 0x76, 0xdd, 0x82, 0x89, 0xc1, 0x76, 0x64, 0x59, 0x1a, 0xcc,
+	0x9d, 0xc4, 0x35, 0xe8, 0x5d, 0x20, 0xce, 0x86, 0x6c, 0x41, 0xa7, 0x37,
+	0x69, 0xc6, 0xbd, 0x9a, 0xaa, 0x1a, 0x8a, 0x3a, 0xb9, 0xa4, 0x49, 0xc5,
+	0xe3, 0x0f, 0xc1, 0x65, 0xc4, 0xaa, 0x59, 0x90, 0xe7, 0x9b, 0x9e, 0x56,
+	0xee, 0xa4, 0x38, 0x24, 0x3b, 0x34, 0x9e, 0x72, 0x03, 0x2f, 0x3a, 0x22,
+	0x50, 0x63, 0xed, 0x25, 0xc9, 0xf1, 0x87, 0x89, 0xb0, 0x9b, 0x4d, 0x5e,
+	0xee, 0x09, 0xf1, 0x00, 0x14, 0xa1, 0x09, 0x3b, 0x1e, 0x79, 0x8a, 0x15,
+	0x42, 0x5e, 0x59, 0x48, 0x35, 0x6f, 0xd2, 0xb4, 0x81, 0x8c, 0xeb, 0x90,
+	0x8c, 0xa1, 0x98, 0x7e, 0x67, 0xe7, 0xfa, 0x14, 0x44, 0x19, 0x48, 0x8e,
+	0x8f, 0xa3, 0x32, 0xa4, 0x87, 0xff, 0x10, 0xc6, 0xc9, 0x3c, 0xc0, 0x9b,
+	0x53, 0xdf, 0x62, 0xb9, 0x9b, 0x54, 0x7d, 0xfd, 0xbd, 0x57, 0xce, 0x52,
+	0xaa, 0x4e, 0x91, 0xbc, 0xc2, 0x92, 0x28, 0xe1, 0x50, 0x76, 0x5c, 0x43,
+	0xb1, 0x9d, 0x0b, 0x3c, 0x30, 0xba, 0x9a, 0x42, 0xfd, 0x8c, 0xf7, 0x8b,
+	0x20, 0x30, 0xac, 0xa8, 0x25, 0x08, 0x35, 0x5a, 0x75, 0x67, 0x3f, 0x1c,
+	0x8c, 0xe1, 0x8e, 0xc9, 0xcd, 0x92, 0xbe, 0x19, 0x5c, 0x41, 0x19, 0x43,
+	0x87, 0x9c, 0x9a, 0xa9, 0xf1, 0x25, 0x92, 0xdc, 0x71, 0x18, 0x86, 0x61,
+	0x18, 0xba, 0xf7, 0x30, 0xbd, 0x53, 0x02, 0x78, 0xe8, 0x92, 0x00, 0x85,
+	0x3b, 0xe4, 0xf6, 0x25, 0x1f, 0x25, 0x7b, 0x8c, 0x2d, 0x47, 0xfc, 0xbc,
+	0xae, 0x15, 0x64, 0x71, 0xf0, 0x83, 0x99, 0x0d, 0xba, 0xf6, 0x8c, 0xfc,
+	0x02, 0xd3, 0xde, 0xde, 0x54, 0x68, 0x2e, 0x29, 0xdd, 0x2b, 0xb5, 0xb3,
+	0x15, 0x61, 0x57, 0xe1, 0x43, 0x4f, 0xc7, 0x7a, 0xb4, 0xc9, 0xf2, 0xc9,
+	0x6b, 0x43, 0xc3, 0x6d, 0x85, 0x12, 0x36, 0x0a, 0xfb, 0xb8, 0xb5, 0x42,
+	0x17, 0x99, 0x6e, 0xfd, 0x9e, 0x5c, 0xd3, 0xc2, 0x44, 0xf3, 0xa2, 0xad,
+	0x6a, 0xf4, 0x59, 0xf4, 0xcc, 0x15, 0x84, 0x59, 0x19, 0x29, 0x4a, 0xbb,
+	0xe4, 0x1e, 0xa2, 0xce, 0xb1, 0x09, 0xd2, 0x44, 0xf2, 0x17, 0xd5, 0x68,
+	0x9d, 0x95, 0x27, 0xc5, 0x55, 0xf6, 0xf8, 0xeb, 0x36, 0x24, 0x6b, 0x8b,
+	0xbd, 0x1b, 0xe6, 0x4f, 0x44, 0x99, 0xc2, 0xcb, 0x01, 0xc2, 0x79, 0x95,
+	0xff, 0x7e, 0xa1, 0xbb, 0x43, 0xa4, 0xb5, 0x28, 0xd5, 0x76, 0x67, 0xc0,
+	0x09, 0x42, 0xfd, 0xa5, 0xab, 0x3a, 0x13, 0xec, 0x11, 0xa4, 0xbf, 0x73,
+	0xbd, 0x20, 0xb2, 0x66, 0xc7, 0xa8, 0x25, 0x5a, 0xdb, 0x73, 0x0f, 0x0e,
+	0xd3, 0x7e, 0xf2, 0x5e, 0xed, 0x80, 0xc8, 0x53, 0x60, 0x45, 0xc1, 0x37,
+	0x93, 0x87, 0x9e, 0xbb, 0x9d, 0x0b, 0xe5, 0xb3, 0xb9, 0x9c, 0x3c, 0x09,
+	0x61, 0x6e, 0xb6, 0x65, 0xaa, 0x7a, 0x8f, 0x58, 0xc3, 0x65, 0xf6, 0xfe,
+	0x02, 0x87, 0x33, 0xc8, 0xeb, 0x19, 0xe0, 0x60, 0x06, 0x85, 0x12, 0x2c,
+	0xca, 0x80, 0x06, 0xc3, 0x03, 0xaa, 0x04, 0xac, 0x14, 0xa8, 0x1f, 0xe4,
+	0xea, 0xcc, 0x3c, 0xa8, 0x43, 0xc0, 0x52, 0xe0, 0x84, 0x55, 0x02, 0x49,
+	0xa5, 0xc0, 0x14, 0x04, 0x09, 0x04, 0xa0, 0xfd, 0x99, 0xe0, 0xc8, 0x02,
+	0xbb, 0x31, 0x09, 0x00, 0x00, 0x00, 0xff, 0xff, 0x4c, 0x92, 0x31, 0x0e,
+	0xc2, 0x30, 0x10, 0x04, 0x0b, 0x3a, 0x1e, 0x81, 0xfc, 0x14, 0x7e, 0x41,
+	0x6d, 0x0b, 0x47, 0x49, 0x15, 0x11, 0xc2, 0xbf, 0x78, 0x21, 0xe2, 0x66,
+	0xf7, 0x62, 0x28, 0x92, 0x28, 0xf6, 0x79, 0xbd, 0x37, 0xb7, 0x5e, 0xe4,
+	0x6c, 0x7c, 0xc6, 0x04, 0xa8, 0x17, 0xdf, 0x03, 0x29, 0x05, 0xbf, 0x20,
+	0x3b, 0x0b, 0x1d, 0x2f, 0x32, 0xa8, 0x6c, 0x43, 0x45, 0x9e, 0x95, 0xc2,
+	0xb5, 0xd0, 0xdb, 0xa2, 0xbf, 0x23, 0x01, 0x90, 0x66, 0x84, 0xf6, 0xdb,
+	0x0c, 0x1a, 0x01, 0x8d, 0x60, 0xfe, 0x4f, 0x22, 0x84, 0x5f, 0x23, 0xc7,
+	0x62, 0x72, 0xd7, 0xea, 0xdc, 0x87, 0x33, 0x44, 0x77, 0xd0, 0xc8, 0x52,
+	0xc2, 0xa8, 0xbb, 0x69, 0xaf, 0x4a, 0x6f, 0x93, 0x47, 0xb6, 0xe4, 0x05,
+	0x01, 0x84, 0x72, 0x3c, 0xf4, 0x5b, 0x0d, 0x2d, 0xaa, 0x64, 0x1b, 0xd1,
+	0x58, 0x55, 0xe4, 0x37, 0xc8, 0xe7, 0x7b, 0x2a, 0x66, 0x99, 0x33, 0x4f,
+	0x1d, 0x1e, 0x8b, 0x73, 0x99, 0x47, 0x9a, 0xd2, 0xd1, 0x49, 0x68, 0x86,
+	0x7f, 0x35, 0xec, 0x48, 0x6f, 0x6e, 0xd4, 0x21, 0x88, 0x82, 0xd5, 0xf8,
+	0x20, 0x49, 0xa3, 0x74, 0xae, 0xc0, 0x39, 0xb0, 0x70, 0x68, 0x7d, 0xdc,
+	0x61, 0x50, 0xd6, 0x89, 0xaa, 0xa9, 0x2c, 0xce, 0x15, 0x99, 0xc8, 0x30,
+	0xd7, 0xa7, 0xa2, 0x51, 0xa5, 0xac, 0x4e, 0xe2, 0x08, 0xfb, 0xd0, 0xe0,
+	0x64, 0x86, 0xe1, 0x74, 0xbe, 0x5c, 0x1f, 0xef, 0xcf, 0xed, 0x0b, 0x7f,
+	0x00, 0x80, 0xff, 0xc1, 0x37, 0xbe, 0x51, 0xf1, 0x9f, 0x5e, 0x28, 0x00,
+	0xea, 0xdc, 0xdf, 0xf1, 0x11, 0x3c, 0x7a, 0xc0, 0x19, 0x7f, 0xf2, 0x71,
+	0xff, 0x9c, 0x48, 0x02, 0xca, 0x9e, 0x80, 0x70, 0x71, 0x7f, 0x99, 0xc1,
+	0xf7, 0x3d, 0x90, 0xf3, 0x62, 0xdd, 0x67, 0x01, 0xa8, 0x5c, 0x21, 0xf3,
+	0xcf, 0xbc, 0xb7, 0xc1, 0xd7, 0xfc, 0x30, 0x72, 0xbf, 0x1f, 0x89, 0x03,
+	0x89, 0x1e, 0xc0, 0x72, 0x32, 0xfc, 0xd9, 0xc1, 0xb7, 0xbe, 0xd1, 0xf2,
+	0x1f, 0x5e, 0xa9, 0x00, 0x67, 0xdc, 0x60, 0xf3, 0x90, 0x3e, 0xf9, 0xc2,
+	0x97, 0x7f, 0x72, 0x73, 0x80, 0x9d, 0xc8, 0x02, 0x4a, 0x9f, 0x01, 0x73,
+	0xf0, 0x7d, 0x18, 0xc3, 0x78, 0x3e, 0x12, 0xf1, 0xe1, 0xdc, 0xe8, 0x01,
+	0x28, 0x5f, 0x9f, 0xf3, 0x4f, 0xbd, 0x3a, 0xc1, 0x59, 0xfc, 0xb0, 0x73,
+	0x3f, 0x1d, 0x07, 0x01, 0x09, 0x1e, 0x42, 0x72, 0xb2, 0xfe, 0x00, 0x81,
+	0x00, 0x7e, 0xff, 0x59, 0xc2, 0x38, 0xbe, 0x50, 0xf1, 0xa1, 0x5e, 0x29,
+	0x00, 0xe7, 0xdc, 0xe0, 0xf1, 0x12, 0x3d, 0x77, 0xc3, 0x18, 0x7f, 0xef,
+	0x71, 0x01, 0x9c, 0x48, 0x03, 0xc8, 0x9e, 0x7f, 0x73, 0x71, 0x7e, 0x98,
+	0xc0, 0xf8, 0x3d, 0x92, 0xf3, 0x60, 0xde, 0x6a, 0x02, 0xa7, 0x5c, 0x1f,
+	0xf1, 0xd0, 0xbf, 0xb8, 0xc0, 0xd7, 0xfe, 0x31, 0x73, 0xc0, 0x1c, 0x89,
+	0x03, 0x87, 0x1e, 0xc0, 0x73, 0x32, 0xff, 0xd9, 0xc1, 0xb8, 0xbe, 0xd0,
+	0xf0, 0x21, 0x5f, 0xa8, 0x02, 0x6a, 0xde, 0x60, 0xf3, 0x92, 0x3f, 0xf8,
+	0xc1, 0x98, 0x7e, 0x72, 0x72, 0x82, 0x9c, 0xc7, 0x01, 0x49, 0x9f, 0x00,
+	0x73, 0xf0, 0x7e, 0x19, 0xc3, 0x7a, 0x3c, 0x10, 0xf0, 0xe0, 0xdd, 0xe8,
+	0x03, 0x29, 0x5d, 0x9f, 0xf0, 0x50, 0xbe, 0x39, 0xc2, 0x59, 0xfe, 0xb0,
+	0x73, 0x42, 0x1d, 0x0a, 0x02, 0x0a, 0x1e, 0x40, 0x70, 0xb2, 0xfe, 0x57,
+	0x00, 0x86, 0x00, 0x79, 0xff, 0xc3, 0x38, 0xbc, 0x51, 0xf1, 0xa0, 0x5c,
+	0x29, 0x00, 0xe8, 0xdc, 0xe2, 0xf3, 0x10, 0x3d, 0x79, 0xc1, 0x19, 0x7e,
+	0xf0, 0x73, 0x00, 0x9c, 0x47, 0x00, 0xc9, 0x9f, 0x81, 0x71, 0x70, 0x7c,
+	0x9a, 0xc1, 0xf9, 0x3f, 0x91, 0xf2, 0x62, 0xdd, 0x69, 0x01, 0xa8, 0x5f,
+	0x21, 0xf1, 0xd0, 0xbd, 0xb8, 0xc0, 0xd9, 0xfe, 0x31, 0x73, 0xc1, 0x1d,
+	0x8a, 0x02, 0x89, 0x1f, 0xc0, 0x72, 0x32, 0xfe, 0xda, 0xc0, 0xb7, 0xbf,
+	0xd0, 0xf1, 0x20, 0x5d, 0xa8, 0x03, 0x67, 0xde, 0x61, 0xf0, 0x90, 0x3e,
+	0xfa, 0xc1, 0x99, 0x7f, 0x71, 0x70, 0x81, 0x9c, 0xca, 0x02, 0x48, 0x9e,
+	0x02, 0x73, 0xf1, 0x7d, 0x19, 0xc3, 0x78, 0x3c, 0x11, 0xf0, 0xe2, 0xdf,
+	0xe9, 0x03, 0x28, 0x5f, 0xa0, 0xf0, 0x51, 0xbf, 0x37, 0xc0, 0x59, 0xff,
+	0xaf, 0x73, 0x41, 0x1f, 0x08, 0x03, 0x0a, 0x1d, 0x42, 0x70, 0xaf, 0xfc,
+	0x5a, 0xc1, 0x37, 0xbe, 0x51, 0xf2, 0xa1, 0x00, 0x88, 0x00, 0x77, 0xff,
+	0x5e, 0x28, 0x01, 0xe8, 0xdc, 0xe1, 0xf1, 0x10, 0x3e, 0x79, 0xc2, 0x19,
+	0x7d, 0xef, 0x70, 0x02, 0x9c, 0x47, 0x01, 0xca, 0x9d, 0x80, 0x73, 0x72,
+	0x7e, 0x9a, 0xc1, 0xf8, 0x3e, 0x91, 0xf2, 0x5f, 0xdf, 0x68, 0x00, 0xa9,
+	0x5f, 0x21, 0xf3, 0xd0, 0xbc, 0xb9, 0xc0, 0xd8, 0xfd, 0x2f, 0x73, 0xc1,
+	0x1f, 0x87, 0x01, 0x87, 0x1f, 0xbf, 0x70, 0x31, 0xfc, 0xd9, 0xc2, 0xb7,
+	0xbc, 0xd2, 0xf0, 0x1f, 0x5f, 0xa9, 0x01, 0x69, 0xdf, 0x61, 0xf3, 0x92,
+	0x3c, 0xfa, 0xc0, 0x97, 0x7f, 0x71, 0x73, 0x82, 0x9d, 0xc9, 0x03, 0x47,
+	0x9c, 0x02, 0x70, 0xf2, 0x7f, 0x18, 0xc3, 0x79, 0x3d, 0x11, 0xf0, 0xe1,
+	0xdc, 0xe8, 0x00, 0x29, 0x5f, 0xa0, 0xf0, 0x51, 0xbe, 0x39, 0xc3, 0x59,
+	0xfc, 0xb1, 0x71, 0x41, 0x1d, 0x07, 0x02, 0x0a, 0x1e, 0x42, 0x73, 0xaf,
+	0xff, 0x58, 0xc2, 0x37, 0xbd, 0x51, 0xf1, 0xa1, 0x5f, 0x2a, 0x01, 0xe9,
+	0xdc, 0xe0, 0xf1, 0x11, 0x00, 0x8c, 0x00, 0x73, 0xff, 0x3e, 0x77, 0xc2,
+	0x18, 0x7f, 0xf2, 0x71, 0x01, 0x9c, 0x49, 0x01, 0xc8, 0x9c, 0x82, 0x73,
+	0x72, 0x7c, 0x9a, 0xc3, 0xfa, 0x3c, 0x8f, 0xf3, 0x60, 0xdd, 0x68, 0x03,
+	0xa8, 0x5d, 0x21, 0xf3, 0xd0, 0xbc, 0xb8, 0xc1, 0xd9, 0xff, 0x2f, 0x73,
+	0xbf, 0x1c, 0x8a, 0x02, 0x87, 0x1d, 0xc1, 0x72, 0x30, 0xfc, 0xd7, 0xc0,
+	0xb7, 0xbc, 0xcf, 0xf2, 0x1f, 0x5c, 0xa8, 0x02, 0x67, 0xde, 0x60, 0xf3,
+	0x90, 0x3c, 0xf9, 0xc0, 0x98, 0x7f, 0x6f, 0x73, 0x7f, 0x9f, 0xc7, 0x02,
+	0x47, 0x9c, 0xff, 0x71, 0xef, 0x7d, 0x17, 0xc1, 0x7a, 0x3c, 0x10, 0xf2,
+	0xe0, 0xdc, 0xe7, 0x00, 0x27, 0x5c, 0x9f, 0xf2, 0x4f, 0xbd, 0x38, 0xc0,
+	0x59, 0xfe, 0xb0, 0x70, 0x3f, 0x1e, 0x0a, 0x01, 0x09, 0x1c, 0x40, 0x71,
+	0xb1, 0xfd, 0x5a, 0xc2, 0x37, 0xbf, 0x50, 0xf0, 0x9f, 0x5f, 0x2a, 0x00,
+	0xe8, 0xde, 0xdf, 0xf3, 0x12, 0x3d, 0x79, 0xc0, 0x18, 0x7e, 0xf0, 0x73,
+	0x02, 0x9e, 0x4a, 0x00, 0xc8, 0x44, 0x52, 0x41, 0x0e, 0x02, 0x21, 0x0c,
+	0x8c, 0x57, 0x5e, 0xd1, 0x17, 0xe0, 0x0b, 0x7c, 0x0c, 0x28, 0xa4, 0x1c,
+	0x04, 0x03, 0x28, 0xd9, 0x8b, 0xf1, 0x17, 0x1e, 0xbd, 0xfb, 0x0d, 0x1f,
+	0xb0, 0x67, 0x9f, 0x62, 0xe2, 0xc1, 0x69, 0x77, 0x13, 0x13, 0x9a, 0x94,
+	0x76, 0x98, 0x4e, 0xc3, 0x3c, 0x6e, 0xed, 0x74, 0xbd, 0xbf, 0x3e, 0x3b,
+	0xd9, 0x3f, 0x6d, 0x9e, 0xf8, 0xff, 0x19, 0xfb, 0xbf, 0xbf, 0x5b, 0x58,
+	0xb8, 0xb3, 0x5b, 0x6c, 0x2d, 0x31, 0x60, 0x7a, 0xad, 0x05, 0x72, 0xf9,
+	0x40, 0xb9, 0x74, 0x5c, 0xad, 0x29, 0xd5, 0x9a, 0x84, 0x34, 0x53, 0xa9,
+	0x34, 0x38, 0xed, 0x59, 0xd1, 0xb1, 0x96, 0x23, 0x8d, 0xd4, 0x99, 0x46,
+	0xa8, 0x78, 0x81, 0xf0, 0x67, 0xc0, 0x7b, 0xa1, 0x15, 0x9d, 0x95, 0x4a,
+	0xbb, 0x48, 0x26, 0xf2, 0x81, 0x22, 0x28, 0xd8, 0x5d, 0x02, 0x95, 0x28,
+	0x47, 0xe8, 0x95, 0xc2, 0x4f, 0x4b, 0x59, 0x66, 0x02, 0x26, 0x4a, 0x04,
+	0x9a, 0x9a, 0x35, 0x68, 0xa9, 0xca, 0xce, 0xa9, 0x11, 0x87, 0x55, 0x9e,
+	0x2a, 0xfc, 0x4b, 0xc0, 0x44, 0xc1, 0x2b, 0x3d, 0x60, 0x3f, 0x2a, 0xc9,
+	0xe5, 0x86, 0x41, 0x20, 0x88, 0xa1, 0x77, 0xaa, 0x48, 0x05, 0xf4, 0x04,
+	0x52, 0x50, 0xb8, 0xc0, 0x25, 0x17, 0xba, 0xcf, 0xf3, 0xb3, 0x16, 0x14,
+	0x29, 0x12, 0xec, 0xb0, 0xf6, 0xf8, 0x13, 0xa8, 0xd1, 0xf2, 0x82, 0xe5,
+	0xcc, 0x4d, 0x31, 0x99, 0x97, 0xb3, 0x7c, 0xba, 0x3d, 0x82, 0x8c, 0x9b,
+	0xfd, 0xc8, 0x4f, 0x0d, 0x6a, 0x05, 0xb0, 0x6b, 0xb8, 0x04, 0x5b, 0x42,
+	0x78, 0x14, 0x5e, 0x32, 0x66, 0xc5, 0x23, 0x8d, 0x8b, 0xcc, 0x73, 0xbd,
+	0xa2, 0x81, 0xab, 0x6f, 0x15, 0x33, 0x4f, 0x1e, 0x1a, 0x8b, 0xaf, 0xe3,
+	0xbb, 0x96, 0x20, 0x09, 0x1b, 0x4a, 0xe6, 0x29, 0x49, 0xc6, 0xb8, 0x3a,
+	0x86, 0xbc, 0x6f, 0x65, 0xb1, 0x07, 0x6a, 0x58, 0x32, 0x3c, 0xfb, 0xf8,
+	0xbc, 0x0d, 0x3d, 0xb0, 0x28, 0xa4, 0xb0, 0x4d, 0x95, 0x06, 0xc2, 0x06,
+	0xdb, 0x13, 0xdd, 0x93, 0x81, 0x0d, 0xd5, 0xeb, 0x25, 0x78, 0x84, 0x98,
+	0x54, 0xf7, 0xc3, 0xe0, 0x36, 0x97, 0x21, 0x8a, 0x73, 0x5b, 0x6f, 0xa1,
+	0xe9, 0x11, 0x91, 0x5c, 0x44, 0x79, 0x47, 0xf8, 0x6d, 0x1a, 0xcb, 0x9d,
+	0xf6, 0x68, 0x75, 0x39, 0x62, 0x84, 0x6d, 0xb5, 0x8f, 0x46, 0x3d, 0x42,
+	0x5d, 0x9b, 0x7f, 0xec, 0x92, 0x26, 0xe4, 0xa0, 0x1b, 0x84, 0xcd, 0x65,
+	0x74, 0xf7, 0xbd, 0xe4, 0x5f, 0xe9, 0x36, 0x8f, 0xcd, 0xbe, 0xd5, 0xfb,
+	0x9e, 0x1a, 0x79, 0xfc, 0x04, 0x31, 0x02, 0x14, 0xc9, 0xa0, 0x48, 0x2c,
+	0x02, 0x79, 0x09, 0xea, 0xc2, 0xfc, 0x3c, 0xa4, 0x54, 0x0c, 0x0b, 0xe4,
+	0x0c, 0xa8, 0x67, 0xa1, 0xf1, 0x09, 0x4e, 0x62, 0x00, 0x00, 0x00, 0x00,
+	0xff, 0xff, 0x34, 0x8f, 0x41, 0x0e, 0xc4, 0x20, 0x0c, 0x03, 0xef, 0xbc,
+	0x22, 0x2f, 0xe0, 0x4f, 0x61, 0x05, 0x0a, 0x87, 0x25, 0x52, 0x9b, 0x16,
+	0xf5, 0xf7, 0xeb, 0xb8, 0xda, 0x53, 0x5d, 0x67, 0x64, 0x9b, 0x76, 0x85,
+	0x68, 0xc8, 0xe3, 0x97, 0xcc, 0x33, 0x95, 0x75, 0x19, 0x87, 0x7f, 0xa5,
+	0xe1, 0x60, 0x7a, 0x77, 0x09, 0x17, 0xc3, 0x69, 0xf7, 0xa3, 0x8b, 0x2f,
+	0xd9, 0x7a, 0xbe, 0x80, 0xae, 0x5a, 0x08, 0xc0, 0xd4, 0x45, 0xc6, 0x0f,
+	0x06, 0xe1, 0x33, 0x43, 0x02, 0x49, 0x13, 0x0c, 0x64, 0xeb, 0xb5, 0xf8,
+	0xc8, 0xa4, 0x4c, 0x85, 0x4a, 0x18, 0xf7, 0x47, 0x96, 0x27, 0xa8, 0xdc,
+	0xa0, 0xf4, 0x64, 0xcf, 0x30, 0x0a, 0x45, 0x21, 0x0b, 0x1a, 0x4c, 0x9b,
+	0x1f, 0xcb, 0x1a, 0xc2, 0x99, 0x65, 0x7f, 0x93, 0xfc, 0x40, 0xe7, 0xbb,
+	0xea, 0x64, 0x07, 0xfe, 0x6b, 0x81, 0x06, 0x85, 0x45, 0x6c, 0xe7, 0x03,
+	0x02, 0xcd, 0x98, 0xb4, 0x72, 0x63, 0xe6, 0xff, 0xd8, 0x25, 0x63, 0x1b,
+	0x84, 0x81, 0x20, 0x08, 0x22, 0x11, 0x20, 0x51, 0x04, 0x25, 0x90, 0x13,
+	0xba, 0x04, 0x32, 0x52, 0x23, 0x08, 0x3e, 0xb1, 0xa5, 0xc7, 0x89, 0xdb,
+	0xa1, 0x02, 0x2a, 0x40, 0xa2, 0x23, 0x2a, 0x40, 0xec, 0xec, 0x9d, 0xed,
+	0x94, 0x02, 0xf8, 0xc0, 0xfe, 0xbf, 0xbf, 0xdb, 0xfb, 0xdd, 0x3d, 0x72,
+	0x0d, 0xb3, 0xdf, 0x5a, 0x82, 0xce, 0x91, 0xc1, 0x64, 0xa0, 0x75, 0x21,
+	0xc4, 0x69, 0x02, 0x9a, 0x51, 0x92, 0xe2, 0xc8, 0x9f, 0xbc, 0x78, 0x4c,
+	0x31, 0x8d, 0xf3, 0x08, 0xbe, 0x53, 0x55, 0x9e, 0x37, 0x92, 0x62, 0xc2,
+	0x75, 0x5d, 0x34, 0xd2, 0x46, 0x01, 0x64, 0x10, 0x39, 0xd5, 0x99, 0x9f,
+	0x29, 0xe9, 0x50, 0xba, 0xa0, 0x7c, 0xa5, 0x54, 0x99, 0x7e, 0xcf, 0xb0,
+	0xb4, 0x2a, 0x43, 0x12, 0x42, 0x60, 0x2e, 0x27, 0x4c, 0x11, 0xae, 0x19,
+	0x09, 0x8e, 0x20, 0xdd, 0xcc, 0x38, 0xe5, 0xc5, 0xe9, 0x70, 0x4c, 0xae,
+	0x44, 0xac, 0x5f, 0xe4, 0x0f, 0x5b, 0x92, 0xa8, 0x79, 0xa0, 0x0e, 0x08,
+	0xf2, 0xa8, 0xb7, 0x9c, 0x42, 0xe4, 0x29, 0xdc, 0xb5, 0x16, 0x43, 0x31,
+	0x75, 0xb2, 0xea, 0x94, 0x8a, 0x95, 0x0d, 0xf1, 0x67, 0x56, 0xa1, 0x25,
+	0xa1, 0xda, 0x52, 0x10, 0x19, 0xa6, 0x80, 0x08, 0x11, 0xb3, 0x4b, 0x4e,
+	0x87, 0xd4, 0xe6, 0x31, 0x4a, 0xd2, 0x0e, 0x33, 0x4b, 0x6c, 0x34, 0x77,
+	0x85, 0x21, 0x5c, 0xfd, 0xd7, 0xcf, 0x6b, 0xbd, 0xd9, 0x35, 0xf5, 0xf1,
+	0x39, 0xbd, 0x0e, 0xcf, 0xe3, 0xfb, 0xfe, 0x05, 0x7f, 0x00, 0x80, 0xff,
+	0x5d, 0x27, 0x02, 0xe8, 0xdc, 0xdf, 0xf2, 0x12, 0x3c, 0x77, 0xc3, 0x19,
+	0x7f, 0xf0, 0x70, 0xff, 0x9f, 0x48, 0x00, 0xc7, 0x9f, 0x81, 0x70, 0x71,
+	0x7d, 0x98, 0xc2, 0xf9, 0x3f, 0x92, 0xf0, 0x60, 0xdf, 0x67, 0x03, 0xa9,
+	0x5f, 0x20, 0xf0, 0xd1, 0xbf, 0xb9, 0xc2, 0xd8, 0xfd, 0x31, 0x71, 0xbf,
+	0x1f, 0x87, 0x02, 0x87, 0x1f, 0xc1, 0x72, 0x32, 0xfd, 0xd9, 0xc0, 0xb7,
+	0xbf, 0xd2, 0xf0, 0x20, 0x5c, 0xa7, 0x02, 0x6a, 0xde, 0x5f, 0xf3, 0x91,
+	0x3d, 0xf9, 0xc1, 0x97, 0x7e, 0x6f, 0x71, 0x81, 0x9c, 0xc7, 0x02, 0x49,
+	0x9f, 0x00, 0x73, 0xf1, 0x7d, 0x1a, 0xc3, 0x77, 0x3e, 0x11, 0xf3, 0xe1,
+	0xdc, 0xe8, 0x02, 0x2a, 0x5f, 0x9f, 0xf3, 0x50, 0xbd, 0x37, 0xc3, 0x59,
+	0xff, 0xb1, 0x71, 0x3f, 0x1d, 0x0a, 0x01, 0x0a, 0x1d, 0x41, 0x71, 0xb0,
+	0xff, 0x59, 0xc2, 0x38, 0xbc, 0x52, 0xf2, 0x00, 0x85, 0x00, 0x7a, 0xff,
+	0x9f, 0x5c, 0x2a, 0x00, 0xe9, 0xdf, 0xdf, 0xf2, 0x12, 0x3e, 0x77, 0xc3,
+	0x18, 0x7f, 0xf2, 0x73, 0x01, 0x9c, 0x47, 0x00, 0xc7, 0x9f, 0x82, 0x73,
+	0x71, 0x7f, 0x98, 0xc2, 0xf7, 0x3c, 0x90, 0xf0, 0x61, 0xde, 0x67, 0x01,
+	0xa8, 0x5c, 0x22, 0xf3, 0xd1, 0xbe, 0xb7, 0xc1, 0xd8, 0xfd, 0x2f, 0x73,
+	0xc0, 0x1d, 0x89, 0x01, 0x89, 0x1e, 0xbf, 0x70, 0x31, 0xff, 0xd9, 0xc1,
+	0xba, 0xbd, 0xd0, 0xf0, 0x1f, 0x5f, 0xa7, 0x03, 0x6a, 0xdd, 0x5f, 0xf3,
+	0x91, 0x3c, 0xf9, 0xc3, 0x9a, 0x7e, 0x70, 0x73, 0x7f, 0x9d, 0xc7, 0x01,
+	0x4a, 0x9c, 0x01, 0x72, 0xf1, 0x7c, 0x19, 0xc2, 0x79, 0x3c, 0x0f, 0xf0,
+	0xe0, 0xdc, 0xe7, 0x00, 0x27, 0x5d, 0xa1, 0xf1, 0x50, 0xbf, 0x39, 0xc2,
+	0x5a, 0xfe, 0xb0, 0x73, 0x40, 0x1f, 0x0a, 0x01, 0x08, 0x1e, 0x40, 0x70,
+	0xb1, 0xff, 0x57, 0xc2, 0x39, 0xbc, 0x51, 0xf3, 0xa0, 0x5c, 0x29, 0x03,
+	0xe9, 0xba, 0xfb, 0xe8, 0xb3, 0xa0, 0x7d, 0xd5, 0x61, 0xf1, 0xba, 0x4f,
+	0x45, 0xff, 0xe7, 0x79, 0x30, 0x9e, 0x9c, 0xd7, 0x50, 0x54, 0x04, 0xb4,
+	0xff, 0x97, 0xed, 0xa4, 0x4f, 0x49, 0xf7, 0xb2, 0x18, 0x96, 0xc7, 0x29,
+	0x7e, 0xba, 0xb8, 0x1f, 0x64, 0xbf, 0x41, 0xd1, 0x7e, 0xd9, 0x0e, 0xc6,
+	0x0e, 0xa0, 0xff, 0xf5, 0xff, 0x5d, 0x3f, 0xb0, 0x6b, 0xef, 0xf9, 0x4f,
+	0x0a, 0xf1, 0xab, 0x98, 0x32, 0xef, 0x25, 0x7c, 0x9a, 0x60, 0xff, 0xf3,
+	0xc0, 0xac, 0xda, 0xc2, 0x82, 0x86, 0x79, 0xa7, 0x98, 0xdc, 0xe7, 0x82,
+	0xfc, 0x2f, 0x71, 0xa8, 0xdc, 0x46, 0xe0, 0xc3, 0xfd, 0xfb, 0xaf, 0x18,
+	0xd5, 0xe3, 0xe6, 0x7f, 0x0a, 0xd8, 0x67, 0x75, 0x30, 0xfc, 0xef, 0xfa,
+	0x62, 0x7b, 0x39, 0x76, 0x06, 0x4e, 0x59, 0x87, 0x82, 0x4d, 0x7f, 0x22,
+	0x0e, 0x9a, 0xef, 0x0b, 0xfc, 0xb4, 0x28, 0x5e, 0xb3, 0x24, 0x5f, 0x21,
+	0x2f, 0xbf, 0x44, 0x21, 0xbf, 0x48, 0x8f, 0x0b, 0xc0, 0x24, 0xb5, 0xe4,
+	0x50, 0x08, 0xc2, 0xc0, 0xbd, 0xa7, 0xe8, 0x09, 0xbc, 0x53, 0x79, 0x29,
+	0x69, 0x37, 0x90, 0xf0, 0x50, 0xc3, 0xed, 0x9d, 0x96, 0x2e, 0x4c, 0xc4,
+	0x34, 0x9d, 0xaf, 0x06, 0xbf, 0xea, 0x18, 0x08, 0x2b, 0x5c, 0x6b, 0x6b,
+	0xa4, 0x7c, 0xcb, 0x7e, 0xd9, 0x24, 0x95, 0x20, 0x56, 0x10, 0x56, 0xbf,
+	0xa8, 0x37, 0x7a, 0xd4, 0x7e, 0x4a, 0x45, 0x68, 0x2a, 0x4f, 0xc2, 0x03,
+	0x95, 0xca, 0x47, 0x05, 0x6a, 0x59, 0x49, 0x03, 0x00, 0x18, 0x64, 0xfe,
+	0xe7, 0xe6, 0x91, 0x21, 0x8e, 0x2b, 0xf6, 0xd3, 0xe1, 0x16, 0xe6, 0xe5,
+	0x82, 0xd1, 0x3c, 0x0f, 0x0f, 0xb3, 0xf0, 0x34, 0xaf, 0x17, 0x33, 0x52,
+	0x86, 0x04, 0x5a, 0x04, 0x67, 0x85, 0x60, 0xd7, 0xf7, 0xfc, 0x5e, 0x89,
+	0x5b, 0x18, 0xa0, 0x1d, 0x72, 0xbc, 0xe7, 0xce, 0x8a, 0x89, 0x33, 0xff,
+	0x3c, 0x90, 0x56, 0xfd, 0x8b, 0x37, 0x08, 0x32, 0x94, 0x6e, 0x85, 0x2a,
+	0xfe, 0x1b, 0xb2, 0x50, 0x14, 0xe4, 0x70, 0xf2, 0xd8, 0xd8, 0x67, 0x85,
+	0x34, 0xb7, 0xad, 0x1c, 0xfd, 0x6d, 0x92, 0x0c, 0x76, 0x18, 0x84, 0x61,
+	0x18, 0x7a, 0xdf, 0xc7, 0xec, 0x9f, 0x3a, 0xb1, 0x8a, 0x1e, 0xc6, 0xa4,
+	0x81, 0x84, 0xf8, 0x7b, 0xec, 0xe7, 0xd2, 0x21, 0xed, 0x90, 0x95, 0xc4,
+	0x8e, 0x1d, 0x7f, 0x7a, 0xb3, 0x3a, 0x37, 0x16, 0x53, 0x65, 0x02, 0x55,
+	0x5e, 0xc7, 0xd4, 0x83, 0xbe, 0xaf, 0x04, 0xdc, 0x0b, 0x93, 0xf0, 0x0f,
+	0xfe, 0xee, 0x75, 0xe5, 0xf1, 0x7d, 0x3c, 0x1f, 0xfa, 0xb0, 0xb7, 0x6d,
+	0x46, 0xb3, 0x45, 0x2d, 0x53, 0xca, 0x8a, 0xd8, 0x50, 0x76, 0x06, 0xc9,
+	0xf2, 0xb8, 0x79, 0xbc, 0x7d, 0xb9, 0x0e, 0xd4, 0xb8, 0x4d, 0xae, 0xc2,
+	0x33, 0xfb, 0x6a, 0xdc, 0xff, 0x84, 0x00, 0xbe, 0x31, 0x0c, 0x5e, 0xf0,
+	0x6e, 0x67, 0xfd, 0x9b, 0x7f, 0x9a, 0x9a, 0xff, 0x77, 0x2e, 0x59, 0x04,
+	0x05, 0x6e, 0xcd, 0x4f, 0x03, 0x76, 0x92, 0xcd, 0x0d, 0x2f, 0x6d, 0xf8,
+	0x79, 0x49, 0x00, 0x14, 0xd6, 0x30, 0x1e, 0xc6, 0x21, 0x73, 0x9c, 0x7c,
+	0x8d, 0x85, 0x96, 0x4e, 0x91, 0x08, 0x0e, 0xe3, 0xcb, 0x3d, 0x8e, 0x28,
+	0x08, 0x40, 0x8b, 0xbb, 0x23, 0x08, 0x35, 0x1d, 0x86, 0x4c, 0x92, 0xba,
+	0xdc, 0x1f, 0x19, 0x59, 0x49, 0x46, 0xa4, 0xba, 0xdd, 0x07, 0x59, 0x26,
+	0xdd, 0xfc, 0xeb, 0xd7, 0xe4, 0x3a, 0x3e, 0x2a, 0x1c, 0x5c, 0xf4, 0x04,
+	0x2c, 0x66, 0x92, 0x0c,
+};
+
+static const unsigned char z_stored[511] = {
+	0x18, 0x19, 0x01, 0xf4, 0x01, 0x0b, 0xfe, 0x61, 0x6e, 0x64, 0x20, 0x61,
+	0x72, 0x65, 0x20, 0x77, 0x65, 0x72, 0x65, 0x20, 0x62, 0x79, 0x20, 0x61,
+	0x6e, 0x64, 0x20, 0x61, 0x72, 0x65, 0x20, 0x68, 0x61, 0x76, 0x65, 0x2e,
+	0x0a, 0x62, 0x65, 0x20, 0x79, 0x6f, 0x75, 0x20, 0x68, 0x69, 0x73, 0x20,
+	0x68, 0x69, 0x73, 0x20, 0x68, 0x61, 0x76, 0x65, 0x20, 0x74, 0x68, 0x65,
+	0x2e, 0x0a, 0x69, 0x6e, 0x20, 0x69, 0x73, 0x20, 0x77, 0x65, 0x72, 0x65,
+	0x20, 0x61, 0x6e, 0x64, 0x20, 0x77, 0x69, 0x74, 0x68, 0x20, 0x77, 0x68,
+	0x69, 0x63, 0x68, 0x20, 0x62, 0x75, 0x74, 0x20, 0x6f, 0x66, 0x20, 0x61,
+	0x73, 0x20, 0x69, 0x74, 0x20, 0x68, 0x69, 0x73, 0x20, 0x69, 0x6e, 0x2e,
+	0x0a, 0x62, 0x65, 0x20, 0x68, 0x61, 0x76, 0x65, 0x20, 0x6e, 0x6f, 0x74,
+	0x20, 0x77, 0x61, 0x73, 0x20, 0x62, 0x79, 0x2e, 0x0a, 0x62, 0x65, 0x20,
+	0x61, 0x74, 0x20, 0x77, 0x65, 0x72, 0x65, 0x2e, 0x0a, 0x66, 0x6f, 0x72,
+	0x2e, 0x0a, 0x61, 0x73, 0x20, 0x66, 0x6f, 0x72, 0x20, 0x69, 0x74, 0x20,
+	0x77, 0x68, 0x69, 0x63, 0x68, 0x20, 0x74, 0x68, 0x61, 0x74, 0x20, 0x79,
+	0x6f, 0x75, 0x20, 0x61, 0x6e, 0x20, 0x62, 0x65, 0x20, 0x61, 0x6e, 0x64,
+	0x20, 0x74, 0x6f, 0x20, 0x74, 0x68, 0x65, 0x20, 0x69, 0x74, 0x20, 0x68,
+	0x61, 0x76, 0x65, 0x20, 0x66, 0x72, 0x6f, 0x6d, 0x20, 0x74, 0x68, 0x69,
+	0x73, 0x20, 0x69, 0x74, 0x20, 0x61, 0x6e, 0x20, 0x69, 0x6e, 0x20, 0x74,
+	0x68, 0x65, 0x20, 0x77, 0x69, 0x74, 0x68, 0x20, 0x74, 0x68, 0x61, 0x74,
+	0x2e, 0x0a, 0x61, 0x74, 0x20, 0x74, 0x68, 0x69, 0x73, 0x2e, 0x0a, 0x61,
+	0x6e, 0x64, 0x20, 0x61, 0x74, 0x20, 0x6f, 0x66, 0x20, 0x66, 0x72, 0x6f,
+	0x6d, 0x20, 0x74, 0x68, 0x65, 0x20, 0x68, 0x69, 0x73, 0x2e, 0x0a, 0x62,
+	0x79, 0x20, 0x68, 0x69, 0x73, 0x20, 0x61, 0x74, 0x20, 0x77, 0x69, 0x74,
+	0x68, 0x20, 0x69, 0x73, 0x20, 0x6f, 0x6e, 0x20, 0x69, 0x6e, 0x2e, 0x0a,
+	0x77, 0x68, 0x69, 0x63, 0x68, 0x20, 0x79, 0x6f, 0x75, 0x20, 0x69, 0x6e,
+	0x20, 0x66, 0x6f, 0x72, 0x20, 0x61, 0x6e, 0x02, 0x08, 0x1e, 0x40, 0x72,
+	0xb0, 0xfc, 0x58, 0xc3, 0x38, 0xbc, 0x50, 0xf0, 0xa1, 0x5e, 0x2a, 0x03,
+	0xea, 0xde, 0xe2, 0xf2, 0x12, 0x3f, 0x7a, 0xc2, 0x18, 0x7d, 0xf2, 0x72,
+	0xff, 0x9f, 0x49, 0x03, 0xc8, 0x9e, 0x80, 0x73, 0x72, 0x7e, 0x98, 0xc1,
+	0xfa, 0x3f, 0x91, 0xf2, 0x61, 0xdd, 0x67, 0x02, 0xa8, 0x5d, 0x21, 0xf2,
+	0xcf, 0xbe, 0xb7, 0xc1, 0xd8, 0xfe, 0x30, 0x71, 0xc1, 0x1d, 0x87, 0x03,
+	0x89, 0x1c, 0xc0, 0x73, 0x30, 0xfe, 0xd8, 0xc2, 0xba, 0xbe, 0xd0, 0xf0,
+	0x1f, 0x5f, 0xaa, 0x01, 0x69, 0xdc, 0x62, 0xf0, 0x8f, 0x3c, 0xfa, 0xc2,
+	0x97, 0x7e, 0x70, 0x71, 0x82, 0x9f, 0xca, 0x00, 0x4a, 0x9e, 0x00, 0x71,
+	0xef, 0x7e, 0x1a, 0xc3, 0x77, 0x3d, 0x12, 0xf2, 0xdf, 0xdd, 0xe9, 0x02,
+	0x2a, 0x5f, 0xa1, 0xf0, 0x50, 0xbc, 0x37, 0xc3, 0x58, 0xfe, 0xb0, 0x70,
+	0x41, 0x1e, 0x09, 0x03, 0x07, 0x1d, 0x3f, 0x72, 0xaf, 0xfc, 0x5a, 0xc1,
+	0x39, 0xbd, 0x4f, 0xf2, 0xa0, 0x5c, 0x28, 0x02, 0xe8, 0xdc, 0xe2, 0xf3,
+	0x0f, 0x3e, 0x7a, 0xc0, 0x19, 0x7f, 0xef, 0x70, 0x02, 0x9e, 0x49, 0x00,
+	0xca, 0x9c, 0x7f, 0x73, 0x70, 0x7c, 0x9a, 0xc0, 0xf9, 0x3e, 0x92, 0xf1,
+	0x62, 0xdc, 0x6a, 0x01, 0xaa, 0x5d, 0x20, 0xf2, 0xd0, 0xbd, 0xb7, 0xc3,
+	0xd7, 0xfe, 0x30, 0x71, 0xbf, 0x1f, 0x89, 0x03, 0x88, 0x1f, 0xc2, 0x72,
+	0x2f, 0xfc, 0xd7, 0x15, 0x45, 0xcc, 0xe1,
+};
+
+#if MAX_WBITS >= 15
+static const unsigned char z_fixed[230] = {
+	0x78, 0x01, 0xcb, 0x48, 0x55, 0xc8, 0x2c, 0x56, 0x28, 0x4f, 0x2c, 0x56,
+	0x48, 0x2b, 0xca, 0xcf, 0x55, 0x48, 0x2c, 0xd1, 0xe3, 0x4a, 0x2c, 0x4a,
+	0x55, 0xc8, 0x2f, 0xd2, 0xe3, 0x02, 0x0b, 0x24, 0x55, 0x02, 0xd9, 0x0a,
+	0x25, 0x19, 0x40, 0x45, 0x40, 0x1a, 0x88, 0x32, 0x12, 0xcb, 0x52, 0x21,
+	0x6a, 0xc1, 0x82, 0x89, 0x79, 0x0a, 0x49, 0xa5, 0x25, 0x0a, 0x99, 0x79,
+	0x60, 0x33, 0xca, 0x33, 0x32, 0x93, 0x33, 0x80, 0x12, 0x89, 0x25, 0x0a,
+	0x19, 0xa9, 0x60, 0x91, 0xc4, 0xbc, 0x14, 0xa8, 0x68, 0x5e, 0x3e, 0x58,
+	0x10, 0xac, 0xa9, 0x18, 0xa8, 0x26, 0x55, 0x8f, 0x0b, 0xac, 0x30, 0x3f,
+	0x0d, 0x2c, 0x06, 0x32, 0xa5, 0x24, 0x1f, 0x64, 0x43, 0x66, 0x09, 0x54,
+	0x27, 0xd0, 0x54, 0x3d, 0xae, 0xca, 0xfc, 0x52, 0xb0, 0x12, 0x90, 0xb5,
+	0x40, 0x79, 0xa0, 0x45, 0xf9, 0x79, 0x20, 0xdd, 0xc8, 0x76, 0x01, 0xb5,
+	0x83, 0xe5, 0x41, 0x2e, 0x47, 0x78, 0x25, 0x0f, 0x6c, 0x79, 0x26, 0x58,
+	0x1a, 0xac, 0x2c, 0x0d, 0x68, 0x78, 0x12, 0xd0, 0x5a, 0xa0, 0x19, 0x20,
+	0x1b, 0x41, 0x0e, 0x82, 0x18, 0x02, 0x76, 0x0f, 0x50, 0x24, 0x0d, 0xe6,
+	0x55, 0x90, 0xa5, 0x40, 0x8d, 0x40, 0x2e, 0x48, 0x11, 0xcc, 0x3f, 0x30,
+	0x25, 0x60, 0xf3, 0x52, 0x2b, 0x41, 0xaa, 0x20, 0xa1, 0x05, 0x31, 0x05,
+	0xec, 0x33, 0xb0, 0x26, 0xa8, 0xe1, 0x20, 0x53, 0x40, 0x4e, 0x80, 0x07,
+	0x0c, 0x50, 0x2a, 0x11, 0x6a, 0xa7, 0x1e, 0x17, 0xd8, 0xfa, 0xd4, 0x22,
+	0x70, 0x30, 0xa4, 0x56, 0xea, 0x71, 0x41, 0x94, 0x00, 0x00, 0x21, 0xd7,
+	0x88, 0xdd,
+};
+
+#  if !RAW
+static const unsigned char z_dict[129] = {
+	0x78, 0xf9, 0x35, 0xa5, 0x88, 0x91, 0xcd, 0x92, 0xcb, 0x0d, 0xc0, 0x20,
+	0x0c, 0x43, 0x37, 0xea, 0x50, 0x95, 0x5a, 0xc1, 0x25, 0x3d, 0x94, 0xfd,
+	0x85, 0x3f, 0x69, 0x60, 0x84, 0x1e, 0x01, 0x63, 0xcc, 0x73, 0xb8, 0x85,
+	0x55, 0x0f, 0xf0, 0x7e, 0x2a, 0xbf, 0x16, 0xa7, 0xb1, 0x51, 0x10, 0x7e,
+	0x2d, 0x05, 0x2e, 0xc0, 0x78, 0xcd, 0xd8, 0x6f, 0x7c, 0xe5, 0xe8, 0xb6,
+	0x44, 0x1b, 0x72, 0x23, 0xf4, 0xf7, 0x9b, 0xf8, 0x2d, 0x2f, 0x54, 0x98,
+	0x0e, 0xe4, 0x80, 0x23, 0x79, 0x32, 0xbb, 0xa6, 0x02, 0x89, 0xb3, 0x87,
+	0xaa, 0x71, 0xd8, 0xa7, 0xbf, 0xc9, 0x8e, 0x1a, 0x82, 0xa1, 0x1e, 0x29,
+	0x88, 0xef, 0x66, 0x7f, 0x2b, 0x58, 0x59, 0xe1, 0x33, 0xbe, 0x72, 0x49,
+	0xa3, 0xe9, 0xf0, 0xa0, 0x55, 0x01, 0x6d, 0x83, 0x4e, 0x9a, 0x4a, 0x15,
+	0xc7, 0x3f, 0xe7, 0x6a, 0x02, 0xc6, 0x01, 0x9a, 0x1b,
+};
+#  endif
+#endif
+
+static const char z_dictionary_text[] =
+	"on on an by which.\nhave with by are which.\nthe are with.\nin "
+	"is for that by be and it you an in the in or the.\nyou have h"
+	"is have which were not by on by the be or as but an he on ar"
+	"e and and.\nhis were as for to was and are have was for are t"
+	"hey of or.\nby is his to not that you.\nfrom you they an of or"
+	" was is to was at you by were was the at are with in were fo"
+	"r not was which they for but his was an "
+;
+
 static voidp
 my_calloc (voidp opaque, unsigned items, unsigned size)
 {
@@ -16,6 +421,584 @@ my_free (voidp opaque, voidp ptr)
 	free (ptr);
 }
 
+/* inflate modes as numbered in uzinflate.c; a serialized record holds the
+ * mode of its stream in the third byte */
+enum {
+	HEAD = 0, DICTID = 9, DICT, TYPE, TYPEDO, STORED, COPY, TABLE, LENLENS,
+	CODELENS, LEN, LENEXT, DIST, DISTEXT, MATCH, LIT, CHECK, LENGTH, DONE
+};
+
+struct vector {
+	const char *name;
+	const unsigned char *data;
+	unsigned len;
+	int dict;		/* compressed with z_dictionary_text */
+};
+
+static const struct vector vectors[] = {
+	VECTOR ("mix", z_mix, 0),		/* 1K window */
+	VECTOR ("stored", z_stored, 0),		/* 512 byte window */
+#if MAX_WBITS >= 15
+	VECTOR ("fixed", z_fixed, 0),		/* 32K window */
+#  if !RAW
+	VECTOR ("dict", z_dict, 1),		/* 32K window */
+#  endif
+#endif
+};
+#define NVECTORS (sizeof (vectors) / sizeof (vectors[0]))
+
+#define OUTMAX 8192
+
+typedef int (*step_func) (z_stream **z, z_stream **spare);
+
+static voidp dirty_calloc (voidp opaque, unsigned items, unsigned size);
+
+static z_dictionary dictionary;
+static unsigned char record[40000];
+static int failures;
+static alloc_func test_alloc = dirty_calloc;
+static free_func test_free = my_free;
+
+/* Hands out memory full of garbage, so that state the library forgets to
+ * set does not happen to read as zero. */
+static voidp
+dirty_calloc (voidp opaque, unsigned items, unsigned size)
+{
+	voidp p = malloc (items * size);
+
+	(void) opaque;
+	if (p)
+		memset (p, 0xa5, items * size);
+	return p;
+}
+
+static void
+fail (const char *name, const char *what, unsigned at, int ret)
+{
+	printf ("FAIL %s: %s at input byte %u (%d)\n", name, what, at, ret);
+	failures++;
+}
+
+static int
+init (z_stream *z, int usetable)
+{
+	z->zalloc = test_alloc;
+	z->zfree = test_free;
+	z->opaque = Z_NULL;
+	z->next_in = Z_NULL;
+	z->avail_in = 0;
+	if (inflateInit (z) != Z_OK)
+		return Z_MEM_ERROR;
+	if (usetable)
+		return inflateUseDictionaries (z, &dictionary, 1);
+	return Z_OK;
+}
+
+/* Decompresses v in one call; returns the length or -1. */
+static int
+straight (const struct vector *v, unsigned char *out)
+{
+	z_stream z;
+	int ret;
+
+	if (init (&z, v->dict) != Z_OK)
+		return -1;
+	z.next_in = (Bytef *) v->data;
+	z.avail_in = v->len;
+	z.next_out = out;
+	z.avail_out = OUTMAX;
+	ret = inflate (&z, Z_FINISH);
+	inflateEnd (&z);
+	return ret == Z_STREAM_END ? (int) (OUTMAX - z.avail_out) : -1;
+}
+
+#if UZ_WINDOW
+static unsigned long modes;	/* one bit per mode a stream was saved in */
+
+/* Notes the mode a stream was left in. */
+static int
+note_mode (z_stream *z)
+{
+	uInt len = sizeof (record);
+	int ret;
+
+	ret = inflateSerialize (z, record, &len);
+	if (ret == Z_OK)
+		modes |= 1UL << record[2];
+	return ret;
+}
+
+/* Puts *z to sleep; every other time it is woken up right away, else it
+ * is left for inflate() to wake.  The stream stays the same, so spare is
+ * not needed. */
+static int
+hibernate (z_stream **z, z_stream **spare)
+{
+	static unsigned n;
+	int ret;
+
+	(void) spare;
+	ret = note_mode (*z);
+	if (ret == Z_OK)
+		ret = inflateHibernate (*z);
+	if (ret == Z_OK)
+		ret = inflateHibernate (*z);
+	if (ret == Z_OK && n++ & 1)
+		ret = inflateWake (*z);
+	return ret;
+}
+
+/* Carries the state of *z over to *spare through a serialized record and
+ * swaps the two. */
+static int
+reserialize (z_stream **z, z_stream **spare)
+{
+	z_stream *t;
+	uInt len = sizeof (record);
+	int ret;
+
+	ret = inflateSerialize (*z, record, &len);
+	if (ret != Z_OK)
+		return ret;
+	modes |= 1UL << record[2];
+	ret = inflateDeserialize (*spare, record, len);
+	if (ret == Z_NEED_DICT && (*spare)->adler == dictionary.id) {
+		/* given to *z with inflateSetDictionary() */
+		ret = inflateUseDictionaries (*spare, &dictionary, 1);
+		if (ret == Z_OK)
+			ret = inflateDeserialize (*spare, record, len);
+	}
+	if (ret != Z_OK)
+		return ret;
+	t = *z;
+	*z = *spare;
+	*spare = t;
+	return Z_OK;
+}
+
+/*
+ * Decompresses v one input byte and a few output bytes per call, passing
+ * the stream through step after every call, and checks that the output is
+ * the same as in one go.  With usetable the dictionary is made available
+ * up front, else it is given when inflate() asks for it.
+ */
+static void
+stepwise (const struct vector *v, const char *test, step_func step,
+	  int usetable)
+{
+	unsigned char want[OUTMAX], out[OUTMAX];
+	z_stream a, b, *z = &a, *spare = &b;
+	unsigned in = 0, got = 0, n = 0, room;
+	int len, ret, r;
+
+	len = straight (v, want);
+	if (len < 0) {
+		fail (v->name, "straight inflate", 0, len);
+		return;
+	}
+	if (init (&a, usetable) != Z_OK || init (&b, usetable) != Z_OK) {
+		fail (v->name, "inflateInit", 0, Z_MEM_ERROR);
+		return;
+	}
+	for (;;) {
+		room = 1 + n++ % 7;
+		z->next_in = (Bytef *) v->data + in;
+		z->avail_in = in < v->len;
+		z->next_out = out + got;
+		z->avail_out = room < OUTMAX - got ? room : OUTMAX - got;
+		ret = inflate (z, Z_NO_FLUSH);
+		in = z->next_in - v->data;
+		got = z->next_out - out;
+		if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_NEED_DICT &&
+		    !(ret == Z_BUF_ERROR && in < v->len)) {
+			fail (v->name, test, in, ret);
+			break;
+		}
+		if ((r = step (&z, &spare)) != Z_OK) {
+			fail (v->name, test, in, r);
+			break;
+		}
+		if (ret == Z_STREAM_END) {
+			if (got != (unsigned) len || memcmp (out, want, len))
+				fail (v->name, test, in, Z_DATA_ERROR);
+			break;
+		}
+		if (ret == Z_NEED_DICT &&
+		    (r = inflateSetDictionary (z, &dictionary)) != Z_OK) {
+			fail (v->name, test, in, r);
+			break;
+		}
+	}
+	inflateEnd (&a);
+	inflateEnd (&b);
+}
+
+#define MAXSEGS 2048
+#define MAXSTOPS 64
+
+/* Cuts len bytes at base into segments of 0 to 12 bytes, cut at the offsets
+ * in stop[0..nstop-1] as well; returns the number of segments. */
+static unsigned
+cut (unsigned char *base, unsigned len, const unsigned long *stop,
+     unsigned nstop, z_iovec *seg)
+{
+	unsigned pos = 0, next, n = 0, k = 0;
+
+	while (pos < len) {
+		next = pos + n % 13;
+		while (k < nstop && stop[k] <= pos)
+			k++;
+		if (k < nstop && stop[k] < next)
+			next = stop[k];
+		if (next > len)
+			next = len;
+		seg[n].base = base + pos;
+		seg[n++].len = next - pos;
+		pos = next;
+	}
+	return n;
+}
+
+/* Decompresses z_mix with inflatev() from scattered input into scattered
+ * output, all at once and then with Z_BLOCK, where segments end right at
+ * the block boundaries and every call must still stop at the next one. */
+static void
+scattered (void)
+{
+	unsigned char want[OUTMAX], out[OUTMAX];
+	unsigned long stop_in[MAXSTOPS], stop_out[MAXSTOPS];
+	static z_iovec in[MAXSEGS], outv[MAXSEGS];
+	unsigned nstop = 0, nin, nout, k;
+	const struct vector *v = &vectors[0];
+	z_stream z;
+	int len, ret;
+
+	len = straight (v, want);
+	if (len < 0 || init (&z, 0) != Z_OK) {
+		fail ("mix", "inflatev", 0, Z_MEM_ERROR);
+		return;
+	}
+	z.next_in = (Bytef *) v->data;
+	z.avail_in = v->len;
+	do {
+		z.next_out = out + z.total_out;
+		z.avail_out = OUTMAX - z.total_out;
+		ret = inflate (&z, Z_BLOCK);
+		if (ret == Z_OK && nstop < MAXSTOPS) {
+			stop_in[nstop] = z.total_in;
+			stop_out[nstop++] = z.total_out;
+		}
+	} while (ret == Z_OK);
+	if (ret != Z_STREAM_END || nstop < 4 || nstop == MAXSTOPS)
+		fail ("mix", "inflate with Z_BLOCK", z.total_in, ret);
+
+	nin = cut ((unsigned char *) v->data, v->len, stop_in, nstop, in);
+	nout = cut (out, len, stop_out, nstop, outv);
+	memset (out, 0, sizeof (out));
+	inflateReset (&z);
+	ret = inflatev (&z, in, nin, outv, nout, Z_NO_FLUSH);
+	if (ret != Z_STREAM_END || memcmp (out, want, len))
+		fail ("mix", "inflatev", z.total_in, ret);
+
+	/* with every segment used up, the stream is left at their ends */
+	ret = inflatev (&z, in, nin, outv, nout, Z_NO_FLUSH);
+	if (ret != Z_STREAM_END || z.next_in != v->data + v->len ||
+	    z.next_out != out + len)
+		fail ("mix", "inflatev pointers", z.total_in, ret);
+
+	nin = cut ((unsigned char *) v->data, v->len, stop_in, nstop, in);
+	nout = cut (out, len, stop_out, nstop, outv);
+	memset (out, 0, sizeof (out));
+	inflateReset (&z);
+	for (k = 0; k <= nstop; k++) {
+		ret = inflatev (&z, in, nin, outv, nout, Z_BLOCK);
+		if (ret != (k < nstop ? Z_OK : Z_STREAM_END) ||
+		    (k < nstop && (z.total_in != stop_in[k] ||
+				   z.total_out != stop_out[k]))) {
+			fail ("mix", "inflatev with Z_BLOCK", z.total_in, ret);
+			break;
+		}
+	}
+	if (memcmp (out, want, len))
+		fail ("mix", "inflatev with Z_BLOCK", z.total_in, Z_DATA_ERROR);
+	inflateEnd (&z);
+}
+#endif
+
+#define MAXWINDOWS 16
+
+static unsigned nwindows, window_size[MAXWINDOWS];
+
+/* Records the size of every window allocated, the only blocks asked for
+ * in bytes rather than as one structure. */
+static voidp
+window_calloc (voidp opaque, unsigned items, unsigned size)
+{
+	if (size == 1 && nwindows < MAXWINDOWS)
+		window_size[nwindows++] = items;
+	return dirty_calloc (opaque, items, size);
+}
+
+/* Decompresses v with at most chunk output bytes per call, or in one call
+ * if chunk is 0, and checks the windows allocated on the way: 256 bytes at
+ * first, each twice the last, ending at last bytes. */
+static void
+window_sizes (const struct vector *v, unsigned chunk, unsigned last)
+{
+	unsigned char out[OUTMAX];
+	z_stream z;
+	unsigned i;
+	int ret;
+
+	nwindows = 0;
+	test_alloc = window_calloc;
+	ret = init (&z, 0);
+	test_alloc = dirty_calloc;
+	if (ret != Z_OK) {
+		fail (v->name, "inflateInit", 0, ret);
+		return;
+	}
+	z.next_in = (Bytef *) v->data;
+	z.avail_in = v->len;
+	z.next_out = out;
+	do {
+		z.avail_out = chunk ? chunk : OUTMAX;
+		ret = inflate (&z, chunk ? Z_NO_FLUSH : Z_FINISH);
+	} while (ret == Z_OK);
+	if (ret != Z_STREAM_END)
+		fail (v->name, "lazy window", z.total_in, ret);
+	for (i = 0; i < nwindows; i++)
+		if (window_size[i] != (i ? 2 * window_size[i - 1] : 256))
+			break;
+	if (i < nwindows || (nwindows ? window_size[nwindows - 1] : 0) != last)
+		fail (v->name, "lazy window", nwindows,
+		      nwindows ? (int) window_size[nwindows - 1] : 0);
+	inflateEnd (&z);
+}
+
+/* Checks that the window is only allocated once output has to be kept, is
+ * no larger than the output so far and never outgrows the header, or
+ * 2^MAX_WBITS for raw streams, which have none. */
+static void
+lazy_window (void)
+{
+	window_sizes (&vectors[0], 0, 0);	/* 6200 bytes in one call */
+#if UZ_WINDOW
+	window_sizes (&vectors[0], 100,		/* 6200 bytes, 1K declared */
+		      RAW && MAX_WBITS < 13 ? 1U << MAX_WBITS :
+		      RAW ? 8192 : 1024);
+#  if MAX_WBITS >= 15
+	window_sizes (&vectors[2], 100, 512);	/* 400 bytes, 32K declared */
+#  endif
+#endif
+}
+
+/* Checks that inflateDeserialize() turns down damaged records. */
+static void
+bad_records (void)
+{
+	z_stream a, b;
+	unsigned char out[OUTMAX];
+	unsigned char *w;
+	uInt len = sizeof (record);
+	int ret;
+
+	if (init (&a, 0) != Z_OK || init (&b, 0) != Z_OK) {
+		fail ("mix", "inflateInit", 0, Z_MEM_ERROR);
+		return;
+	}
+	a.next_in = (Bytef *) vectors[0].data;
+	a.avail_in = 100;
+	a.next_out = out;
+	a.avail_out = sizeof (out);
+	inflate (&a, Z_NO_FLUSH);
+	if (inflateSerialize (&a, record, &len) != Z_OK ||
+	    inflateDeserialize (&b, record, len) != Z_OK)
+		fail ("mix", "record", 100, Z_STREAM_ERROR);
+	w = record + 2;
+	w[4 * 13] = 64;			/* bits */
+	if ((ret = inflateDeserialize (&b, record, len)) != Z_DATA_ERROR)
+		fail ("mix", "bits out of range accepted", 100, ret);
+	w[4 * 13] = 0;
+	w[4 * 16] = 16;			/* extra */
+	if ((ret = inflateDeserialize (&b, record, len)) != Z_DATA_ERROR)
+		fail ("mix", "extra out of range accepted", 100, ret);
+	w[4 * 16] = 0;
+	record[1] ^= 1;			/* kind of decoding tables */
+	if ((ret = inflateDeserialize (&b, record, len)) != Z_DATA_ERROR)
+		fail ("mix", "wrong table kind accepted", 100, ret);
+	inflateEnd (&a);
+	inflateEnd (&b);
+}
+
+#ifdef UZ_ALLOC
+#define NBLOCKS 64
+
+/* Allocates blocks of sizes across all classes and beyond, fills each with
+ * its own byte and checks none was overwritten by another before freeing
+ * them all; if arg is not null, the blocks there are freed first. */
+static void *
+churn (void *arg)
+{
+	unsigned char *block[NBLOCKS];
+	unsigned size[NBLOCKS];
+	unsigned i, round;
+	unsigned char **theirs = arg;
+
+	for (i = 0; theirs && i < NBLOCKS; i++)
+		uzFree (Z_NULL, theirs[i]);
+	for (round = 0; round < 20; round++) {
+		for (i = 0; i < NBLOCKS; i++) {
+			size[i] = 1 + (i * 2654435761U + round * 40503U) %
+				(i & 7 ? 60000 : 300000);
+			block[i] = uzAlloc (Z_NULL, 1, size[i]);
+			if (block[i] == Z_NULL) {
+				fail ("uzAlloc", "out of memory", size[i], 0);
+				return Z_NULL;
+			}
+			memset (block[i], i, size[i]);
+		}
+		for (i = 0; i < NBLOCKS; i++) {
+			if (block[i][0] != i || block[i][size[i] - 1] != i ||
+			    block[i][size[i] / 2] != i)
+				fail ("uzAlloc", "block overwritten", size[i], i);
+			uzFree (Z_NULL, block[i]);
+		}
+	}
+	return Z_NULL;
+}
+
+/* Exercises the uzAlloc() pool from several threads, with blocks freed by
+ * another thread than the one that got them, and then runs the hibernate
+ * tests on top of it, given explicitly and by default. */
+static void
+pool (void)
+{
+	unsigned char *block[4][NBLOCKS];
+	pthread_t thread[4];
+	unsigned i, t;
+	voidp p, q;
+	z_stream z;
+
+	if (uzAllocConfig (UZ_ALLOC_HUGEPAGES) != Z_OK)
+		fail ("uzAllocConfig", "refused", 0, Z_STREAM_ERROR);
+	for (t = 0; t < 4; t++)
+		for (i = 0; i < NBLOCKS; i++)
+			block[t][i] = uzAlloc (Z_NULL, 1, 1000 + i * 1000);
+	for (t = 0; t < 4; t++)
+		pthread_create (&thread[t], NULL, churn, block[t]);
+	for (t = 0; t < 4; t++)
+		pthread_join (thread[t], NULL);
+	if (uzAllocConfig (0) != Z_STREAM_ERROR)
+		fail ("uzAllocConfig", "accepted after first allocation", 0, 0);
+
+	/* a freed block is the next one handed out in its class */
+	p = uzAlloc (Z_NULL, 32768, 1);
+	uzFree (Z_NULL, p);
+	q = uzAlloc (Z_NULL, 1, 32768);
+	if (p != q)
+		fail ("uzAlloc", "freed window not reused", 32768, 0);
+	uzFree (Z_NULL, q);
+
+#if UZ_WINDOW
+	test_alloc = uzAlloc;
+	test_free = uzFree;
+	for (i = 0; i < NVECTORS; i++)
+		stepwise (&vectors[i], "uzAlloc", hibernate, vectors[i].dict);
+#endif
+
+	/* and again with the allocator inflateInit() picks by default */
+	test_alloc = (alloc_func) 0;
+	test_free = (free_func) 0;
+	if (init (&z, 0) != Z_OK || z.zalloc != uzAlloc || z.zfree != uzFree)
+		fail ("uzAlloc", "not the default", 0, Z_STREAM_ERROR);
+	inflateEnd (&z);
+#if UZ_WINDOW
+	for (i = 0; i < NVECTORS; i++)
+		stepwise (&vectors[i], "default uzAlloc", hibernate,
+			  vectors[i].dict);
+#else
+	for (i = 0; i < NVECTORS; i++)
+		if (straight (&vectors[i], record) < 0)
+			fail (vectors[i].name, "default uzAlloc", 0, -1);
+#endif
+	test_alloc = dirty_calloc;
+	test_free = my_free;
+}
+#endif
+
+#if UZ_WINDOW
+/* the modes raw streams, and the vectors the build leaves out, never stop
+ * in */
+static const unsigned long skipped =
+#  if RAW
+	1UL << HEAD | 1UL << CHECK |
+#  endif
+#  if RAW || MAX_WBITS < 15
+	1UL << DICTID | 1UL << DICT | 1UL << LENEXT |
+#  endif
+	0;
+
+/* Checks that every mode an inflate() call can return in, but those in
+ * skip, has been seen. */
+static void
+check_modes (const char *test, unsigned long skip)
+{
+	static const int want[] = {
+		HEAD, DICTID, DICT, TYPE, STORED, COPY, TABLE,
+		LENLENS, CODELENS, LEN, LENEXT, DIST, DISTEXT, MATCH, LIT,
+		CHECK, DONE
+	};
+	unsigned i;
+
+	for (i = 0; i < sizeof (want) / sizeof (want[0]); i++)
+		if (!((modes | skip) & (1UL << want[i]))) {
+			printf ("FAIL %s: never stopped in mode %d\n", test,
+				want[i]);
+			failures++;
+		}
+	modes = 0;
+}
+#endif
+
+/* Runs every test the build configuration allows.  Without a window only
+ * whole streams can be inflated, so the tests that split the output across
+ * calls are left out. */
+static int
+selftest (void)
+{
+	unsigned char out[OUTMAX];
+	unsigned i;
+
+	inflateDictionaryInit (&dictionary, (const Bytef *) z_dictionary_text,
+			       sizeof (z_dictionary_text) - 1);
+	for (i = 0; i < NVECTORS; i++)
+		if (straight (&vectors[i], out) < 0)
+			fail (vectors[i].name, "straight inflate", 0, -1);
+#if UZ_WINDOW
+	for (i = 0; i < NVECTORS; i++) {
+		stepwise (&vectors[i], "serialize", reserialize, 0);
+		if (vectors[i].dict)
+			stepwise (&vectors[i], "serialize", reserialize, 1);
+	}
+	check_modes ("serialize", skipped);
+	for (i = 0; i < NVECTORS; i++) {
+		stepwise (&vectors[i], "hibernate", hibernate, 0);
+		if (vectors[i].dict)
+			stepwise (&vectors[i], "hibernate", hibernate, 1);
+	}
+	check_modes ("hibernate", skipped);
+	scattered ();
+#endif
+	bad_records ();
+	lazy_window ();
+#ifdef UZ_ALLOC
+	pool ();
+#endif
+	printf ("%s\n", failures ? "FAILED" : "ok");
+	return failures != 0;
+}
+
 
 int
 main (int argc, char **argv)
@@ -25,6 +1008,9 @@ main (int argc, char **argv)
 	unsigned char obuf[4096];
 	int ret, i;
 
+	if (argc > 1 && strcmp (argv[1], "-t") == 0)
+		return selftest ();
+
 	z.zalloc = my_calloc;
 	z.zfree = my_free;
 	z.avail_in = 0;
@@ -190,9 +190,15 @@ typedef gz_header FAR *gz_headerp;
 #define Z_HUFFMAN_ONLY        2
 #define Z_RLE                 3
 #define Z_FIXED               4
+#define Z_QUICK               5
 #define Z_DEFAULT_STRATEGY    0
 /* compression strategy; see deflateInit2() below for details */
 
+#define Z_HASH_DEFAULT        0
+#define Z_HASH_MULTIPLY       1
+#define Z_HASH_CRC32C         2
+/* match finder hash; see deflateHash() below for details */
+
 #define Z_BINARY   0
 #define Z_TEXT     1
 #define Z_ASCII    Z_TEXT   /* for compatibility with 1.2.2 and earlier */
@@ -527,7 +533,14 @@ ZEXTERN int ZEXPORT deflateInit2 OF((z_streamp strm,
    parameter only affects the compression ratio but not the correctness of the
    compressed output even if it is not set appropriately.  Z_FIXED prevents the
    use of dynamic Huffman codes, allowing for a simpler decoder for special
-   applications.
+   applications.  Z_QUICK is for when speed matters far more than the last
+   few percent of compression: each string is looked up once in a hash table
+   without chains, a match of four bytes or more is taken at once, and the
+   symbols are written out with the fixed Huffman codes as they are found, so
+   nothing is buffered and no code trees are built.  It is about twice as fast
+   as level 1, at the cost of a larger output, and ignores the level except
+   for level 0.  Incompressible data can grow by an eighth, which
+   deflateBound() allows for.
 
       deflateInit2 returns Z_OK if success, Z_MEM_ERROR if there was not enough
    memory, Z_STREAM_ERROR if a parameter is invalid (such as an invalid
@@ -621,7 +634,9 @@ ZEXTERN int ZEXPORT deflateParams OF((z_streamp strm,
 
      deflateParams returns Z_OK if success, Z_STREAM_ERROR if the source
    stream state was inconsistent or if a parameter was invalid, Z_BUF_ERROR
-   if strm->avail_out was zero.
+   if strm->avail_out was zero.  When leaving Z_QUICK, Z_BUF_ERROR also means
+   that there was not enough output space to end its block; the parameters
+   are then unchanged, and deflateParams should be called again with more.
 */
 
 ZEXTERN int ZEXPORT deflateTune OF((z_streamp strm,
@@ -641,6 +656,49 @@ ZEXTERN int ZEXPORT deflateTune OF((z_streamp strm,
    returns Z_OK on success, or Z_STREAM_ERROR for an invalid deflate stream.
  */
 
+ZEXTERN int ZEXPORT deflateHash OF((z_streamp strm,
+                                    int method));
+/*
+     Select the hash function deflate uses to find candidate strings.  The
+   default, Z_HASH_DEFAULT, is a rolling hash of three bytes.  Z_HASH_MULTIPLY
+   hashes four bytes with a single multiplication, which spreads structured
+   binary data far better over the hash table and so keeps the hash chains
+   short.  Matches of only three bytes are then found less often, which costs
+   a little compression on some text.  Z_HASH_CRC32C hashes the four bytes
+   with the CRC-32C instruction where the compiler targets one (SSE4.2 or
+   ARMv8 CRC), and is the same as Z_HASH_MULTIPLY elsewhere.  The compressed
+   data differs with the hash, but is a valid deflate stream either way.
+
+     deflateHash() must be called after deflateInit(), deflateInit2() or
+   deflateReset(), and before deflateSetDictionary() and the first call of
+   deflate().  The method is kept by deflateReset().  It returns Z_OK on
+   success, or Z_STREAM_ERROR if the stream state is inconsistent, the
+   method is invalid, or it was called too late.
+*/
+
+ZEXTERN int ZEXPORT deflatePooled OF((z_streamp strm));
+/*
+     Make strm compress each message on its own, without the history of the
+   previous ones (no context takeover), and keep its window, hash tables and
+   pending buffer only while it compresses a message. They are freed now.
+   At each message they are borrowed from a pool kept by the calling thread,
+   and are given back to it when deflate() completes a Z_SYNC_FLUSH,
+   Z_FULL_FLUSH or Z_FINISH with all the input consumed and all the output
+   delivered. Between messages the stream then takes about 6K instead of
+   about 256K with the default memLevel and windowBits, which suits servers
+   holding many mostly idle streams, such as WebSocket connections with
+   per-message deflate. The pool memory is allocated with malloc(), not with
+   zalloc, and a message may end on a different thread than it began.
+
+     deflatePooled() must be called after deflateInit(), deflateInit2() or
+   deflateReset(), and before the first call of deflate(). It stays in
+   effect after deflateReset(). deflateSetDictionary() is not allowed on a
+   pooled stream. deflatePooled() returns Z_OK on success, or
+   Z_STREAM_ERROR if the stream state is inconsistent, it was called too
+   late, or pools are not supported on this system (they need POSIX
+   threads).
+*/
+
 ZEXTERN uLong ZEXPORT deflateBound OF((z_streamp strm,
                                        uLong sourceLen));
 /*
@@ -1044,6 +1102,32 @@ ZEXTERN uLong ZEXPORT compressBound OF((uLong sourceLen));
    a compress() or compress2() call to allocate the destination buffer.
 */
 
+ZEXTERN int ZEXPORT compressArena OF((Bytef *dest,   uLongf *destLen,
+                                      const Bytef *source, uLong sourceLen,
+                                      int level, voidpf arena,
+                                      uLong arenaLen));
+/*
+     Same as compress2, for many small buffers. The window and the internal
+   tables are sized to sourceLen instead of the deflateInit() defaults, and
+   they are allocated from the arenaLen bytes at arena, which the caller
+   can reuse as soon as compressArena returns. If arena is Z_NULL, the
+   memory is allocated and freed as for compress2. When destLen is at least
+   compressBound(sourceLen), the compressed data is written straight into
+   dest, without going through an internal buffer.
+     The zlib header may announce a window smaller than 32K, and so the
+   output can differ from that of compress2.
+
+     compressArena returns the same as compress2, and also Z_MEM_ERROR if
+   arenaLen is less than compressArenaSize(sourceLen).
+*/
+
+ZEXTERN uLong ZEXPORT compressArenaSize OF((uLong sourceLen));
+/*
+     compressArenaSize() returns the arena size needed by compressArena()
+   for sourceLen bytes: 9K for a hundred bytes, 22K for a kilobyte, and 262K
+   from 16K on.
+*/
+
 ZEXTERN int ZEXPORT uncompress OF((Bytef *dest,   uLongf *destLen,
                                    const Bytef *source, uLong sourceLen));
 /*
@@ -1077,6 +1161,11 @@ ZEXTERN gzFile ZEXPORT gzopen  OF((const char *path, const char *mode));
      gzopen can be used to read a file which is not in gzip format; in this
    case gzread will directly read from the file without decompression.
 
+     On Unix systems a regular file opened for reading is mapped into
+   memory, and inflate reads the compressed data in place instead of through
+   an intermediate buffer. The file must not be truncated while it is open.
+   Compile gzio.c with -DNO_GZMMAP to always read through stdio.
+
      gzopen returns NULL if the file could not be opened or if there was
    insufficient memory to allocate the (de)compression state; errno
    can be checked to distinguish the two cases (if errno is zero, the
@@ -1148,6 +1237,20 @@ ZEXTERN char * ZEXPORT gzgets OF((gzFile file, char *buf, int len));
       gzgets returns buf, or Z_NULL in case of error.
 */
 
+ZEXTERN const char * ZEXPORT gzgetline OF((gzFile file, unsigned *len));
+/*
+      Reads the next line from the compressed file without copying it.
+   gzgetline returns a pointer to the line in an internal buffer of file and
+   sets *len to its length, including the terminating newline if there is
+   one (the last line of the file may not have one). The line is not null
+   terminated, and remains valid only until the next operation on file.
+      gzgetline returns Z_NULL at end of file or in case of error; gzerror
+   can be used to tell the two apart.
+
+      gzgets, gzgetline, gzread and gzgetc may be freely mixed on the same
+   file: bytes decompressed ahead by one are returned by the next.
+*/
+
 ZEXTERN int ZEXPORT    gzputc OF((gzFile file, int c));
 /*
       Writes c, converted to an unsigned char, into the compressed file.
@@ -1188,9 +1291,9 @@ ZEXTERN z_off_t ZEXPORT    gzseek OF((gzFile file,
    uncompressed data stream. The whence parameter is defined as in lseek(2);
    the value SEEK_END is not supported.
      If the file is opened for reading, this function is emulated but can be
-   extremely slow. If the file is opened for writing, only forward seeks are
-   supported; gzseek then compresses a sequence of zeroes up to the new
-   starting position.
+   extremely slow, unless access points are recorded with gzindex. If the
+   file is opened for writing, only forward seeks are supported; gzseek then
+   compresses a sequence of zeroes up to the new starting position.
 
       gzseek returns the resulting offset location as measured in bytes from
    the beginning of the uncompressed stream, or -1 in case of error, in
@@ -1205,6 +1308,46 @@ ZEXTERN int ZEXPORT    gzrewind OF((gzFile file));
    gzrewind(file) is equivalent to (int)gzseek(file, 0L, SEEK_SET)
 */
 
+ZEXTERN int ZEXPORT    gzindex OF((gzFile file, z_off_t span, uLong limit));
+/*
+     Starts recording access points in a file opened for reading. While the
+   file is read, a point is recorded at the end of the first deflate block
+   at least span uncompressed bytes after the previous one, together with
+   the 32K of uncompressed data before it. gzseek then resumes decompression
+   from the last point before the requested position instead of from the
+   start of the file. Points are only recorded for data read with index
+   enabled, so gzindex is best called right after gzopen.
+     At most about limit bytes are used for the points. When that is
+   reached, every other point is dropped and span is doubled. A span of zero
+   stops recording and frees the points. Recording makes each read return
+   at every block boundary and copies the output once more, so it costs a
+   few percent of decompression speed.
+
+     gzindex returns Z_OK if success, Z_STREAM_ERROR if the file is not
+   opened for reading or limit is too small for a single point, or
+   Z_MEM_ERROR if there was not enough memory.
+*/
+
+ZEXTERN int ZEXPORT    gzsaveindex OF((gzFile file, const char *path));
+ZEXTERN int ZEXPORT    gzloadindex OF((gzFile file, const char *path));
+/*
+     gzsaveindex writes the access points recorded so far to the file path,
+   and gzloadindex replaces the access points of file with those saved in
+   path, so that the index built while reading a file once can be reused
+   the next time it is opened. gzindex must have been called on file before
+   gzloadindex; the saved span replaces the one given to gzindex, and
+   recording continues after the last loaded point. The index must have been
+   saved for the same compressed file: only the size of its gzip header is
+   checked.
+
+     Both return Z_OK if success, Z_STREAM_ERROR if the file is not opened
+   for reading, or Z_ERRNO if path cannot be opened or written. gzloadindex
+   returns Z_DATA_ERROR if path is not a valid index for file, Z_BUF_ERROR if
+   it holds more points than the limit given to gzindex, or Z_MEM_ERROR if
+   there was not enough memory; the file may then be left with no access
+   points.
+*/
+
 ZEXTERN z_off_t ZEXPORT    gztell OF((gzFile file));
 /*
      Returns the starting position for the next gzread or gzwrite on the
@@ -1249,6 +1392,138 @@ ZEXTERN void ZEXPORT gzclearerr OF((gzFile file));
    file that is being written concurrently.
 */
 
+                        /* checksum functions */
+
+/*
+     These functions are not related to compression but are exported
+   anyway because they might be useful in applications using the
+   compression library.
+*/
+
+ZEXTERN uLong ZEXPORT adler32 OF((uLong adler, const Bytef *buf, uInt len));
+/*
+     Update a running Adler-32 checksum with the bytes buf[0..len-1] and
+   return the updated checksum. If buf is NULL, this function returns
+   the required initial value for the checksum.
+   An Adler-32 checksum is almost as reliable as a CRC32 but can be computed
+   much faster. Usage example:
+
+     uLong adler = adler32(0L, Z_NULL, 0);
+
+     while (read_buffer(buffer, length) != EOF) {
+       adler = adler32(adler, buffer, length);
+     }
+     if (adler != original_adler) error();
+*/
+
+ZEXTERN uLong ZEXPORT adler32_combine OF((uLong adler1, uLong adler2,
+                                          z_off_t len2));
+/*
+     Combine two Adler-32 checksums into one.  For two sequences of bytes, seq1
+   and seq2 with lengths len1 and len2, Adler-32 checksums were calculated for
+   each, adler1 and adler2.  adler32_combine() returns the Adler-32 checksum of
+   seq1 and seq2 concatenated, requiring only adler1, adler2, and len2.
+*/
+
+ZEXTERN uLong ZEXPORT crc32   OF((uLong crc, const Bytef *buf, uInt len));
+/*
+     Update a running CRC-32 with the bytes buf[0..len-1] and return the
+   updated CRC-32. If buf is NULL, this function returns the required initial
+   value for the for the crc. Pre- and post-conditioning (one's complement) is
+   performed within this function so it shouldn't be done by the application.
+   Usage example:
+
+     uLong crc = crc32(0L, Z_NULL, 0);
+
+     while (read_buffer(buffer, length) != EOF) {
+       crc = crc32(crc, buffer, length);
+     }
+     if (crc != original_crc) error();
+*/
+
+ZEXTERN uLong ZEXPORT crc32_combine OF((uLong crc1, uLong crc2, z_off_t len2));
+
+/*
+     Combine two CRC-32 check values into one.  For two sequences of bytes,
+   seq1 and seq2 with lengths len1 and len2, CRC-32 check values were
+   calculated for each, crc1 and crc2.  crc32_combine() returns the CRC-32
+   check value of seq1 and seq2 concatenated, requiring only crc1, crc2, and
+   len2.
+*/
+
+ZEXTERN uLong ZEXPORT crc32_combine_multi OF((uLong crc, const uLongf *crcs,
+                                              const z_off_t FAR *lens,
+                                              unsigned n));
+/*
+     Combine the CRC-32 check values crcs[0..n-1] of n consecutive pieces of
+   a sequence, of lengths lens[0..n-1], onto crc, the CRC-32 of what precedes
+   them, and return the CRC-32 of the whole. It gives the same result as n
+   calls of crc32_combine(), but consecutive pieces of the same length cost
+   only one multiplication modulo the CRC polynomial each.
+*/
+
+ZEXTERN uLong ZEXPORT adler32_combine_multi OF((uLong adler,
+                                                const uLongf *adlers,
+                                                const z_off_t FAR *lens,
+                                                unsigned n));
+/*
+     The same for Adler-32 check values, as n calls of adler32_combine().
+*/
+
+                        /* parallel compression */
+
+/*
+     The following functions compress a stream on several threads at once.
+   The output is one ordinary zlib, gzip or raw deflate stream, which any
+   inflate can decompress; it is at most a fraction of a percent larger than
+   that of deflate, mostly from the four bytes added at each block boundary.
+   These functions are in pdeflate.c and need POSIX threads.
+*/
+
+typedef voidp pzStream;
+
+typedef int (*pz_out_func) OF((voidp opaque, const Bytef *buf, unsigned len));
+/*
+     Called with each piece of compressed data, in order, from the thread
+   calling pzopen, pzwrite or pzclose. It must return 0 on success, or
+   non-zero for an error, after which nothing more is written.
+*/
+
+ZEXTERN pzStream ZEXPORT pzopen OF((pz_out_func out, voidp opaque,
+                                    int level, int windowBits,
+                                    int threads, uLong blockSize));
+/*
+     Opens a parallel compression stream that writes its output through out,
+   which is passed opaque with each call. level and windowBits are as for
+   deflateInit2: windowBits 8..15 gives a zlib stream, 16 more a gzip
+   stream, and its negative a raw deflate stream. The stream is compressed
+   with the default memLevel and strategy.
+
+     The input is cut into blocks of blockSize bytes (128K if 0, at least the
+   window size) that are compressed on threads threads (one per processor if
+   0). Each block is compressed with the end of the previous one as preset
+   dictionary, and so needs up to 2*threads+1 blocks of memory as input
+   besides the deflate state of each thread.
+
+     pzopen writes the header and returns NULL if there was not enough
+   memory, if a parameter is invalid, if no thread could be started, or if
+   out failed.
+*/
+
+ZEXTERN int ZEXPORT pzwrite OF((pzStream pz, voidpc buf, unsigned len));
+/*
+     Compresses len bytes from buf. Compressed data is written as blocks
+   are done; pzwrite waits when too many blocks are in flight. Returns len,
+   or 0 for an error, in which case the stream must still be closed.
+*/
+
+ZEXTERN int ZEXPORT pzclose OF((pzStream pz));
+/*
+     Compresses the rest of the input, writes the trailer, stops the threads
+   and frees the stream. Returns Z_OK, Z_MEM_ERROR if there was not enough
+   memory, Z_ERRNO if out failed, or Z_STREAM_ERROR if pz is NULL.
+*/
+
                         /* various hacks, don't look :) */
 
 /* deflateInit and inflateInit are macros to allow checking the zlib version